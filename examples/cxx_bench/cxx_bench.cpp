@@ -0,0 +1,163 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+#include <gpi_cp.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+
+#define SUCCESS_OR_DIE(f...)                                    \
+  do                                                            \
+    {                                                           \
+      gaspi_return_t const r = f;                               \
+      if (r != GASPI_SUCCESS)                                   \
+        {                                                       \
+          fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__     \
+                  , gaspi_error_str (r));                       \
+          exit (EXIT_FAILURE);                                  \
+        }                                                       \
+    } while (0)
+
+static double
+now_us (void)
+{
+  return std::chrono::duration<double, std::micro>
+    (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+/* slowest rank's time per checkpoint (start + commit) of iterations
+   checkpoints */
+template <class Checkpoint>
+static double
+time_checkpoints (Checkpoint& checkpoint, int iterations)
+{
+  SUCCESS_OR_DIE (gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  double const t0 = now_us ();
+
+  for (int i = 0; i < iterations; i++)
+    checkpoint (i);
+
+  double elapsed = (now_us () - t0) / iterations;
+  double slowest;
+
+  SUCCESS_OR_DIE (gaspi_allreduce ( &elapsed, &slowest, 1
+                                  , GASPI_OP_MAX, GASPI_TYPE_DOUBLE
+                                  , GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  return slowest;
+}
+
+/* overhead of the C++ interface over the C calls
+
+   all ranks checkpoint a small region in place, through gpi_cp_start
+   and gpi_cp_commit and through gpi_cp::checkpoint, alternately in
+   several rounds; prints the best time per checkpoint of each. Small
+   regions make the calls themselves show.
+
+   usage: cxx_bench.bin [KiB per rank (4)] [checkpoints per round (2000)]
+*/
+int
+main (int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init (GASPI_BLOCK));
+
+  gaspi_rank_t myrank, nranks;
+  SUCCESS_OR_DIE (gaspi_proc_rank (&myrank));
+  SUCCESS_OR_DIE (gaspi_proc_num (&nranks));
+
+  gaspi_size_t const size = (argc > 1 ? atol (argv[1]) : 4) * 1024;
+  int const iterations = argc > 2 ? atoi (argv[2]) : 2000;
+  int const rounds = 5;
+
+  const gaspi_segment_id_t segment_id_checkpoint = 0;
+
+  SUCCESS_OR_DIE (gaspi_segment_create ( segment_id_checkpoint
+                                       , size
+                                       , GASPI_GROUP_ALL
+                                       , GASPI_BLOCK
+                                       , GASPI_MEM_INITIALIZED
+                                       ));
+
+  std::span<char> const data =
+    gpi_cp::segment_span<char> (segment_id_checkpoint, 0, size);
+
+  double best_c = 0.0;
+  double best_cxx = 0.0;
+
+  for (int round = 0; round < rounds; round++)
+    {
+      // the C interface
+      {
+        gpi_cp_description_t description = GPI_CP_DESCRIPTION_INITIALIZER ();
+
+        SUCCESS_OR_DIE (gpi_cp_init ( segment_id_checkpoint, 0, size, 0
+                                    , GPI_CP_POLICY_RING, GASPI_GROUP_ALL
+                                    , description, GASPI_BLOCK));
+
+        auto c = [&] (int i)
+          {
+            data[0] = (char) i;
+            SUCCESS_OR_DIE (gpi_cp_start (description, GASPI_BLOCK));
+            SUCCESS_OR_DIE (gpi_cp_commit (description, GASPI_BLOCK));
+          };
+
+        double const t = time_checkpoints (c, iterations);
+        best_c = (round == 0 || t < best_c) ? t : best_c;
+
+        SUCCESS_OR_DIE (gpi_cp_finalize (description, GASPI_BLOCK));
+        free (description);
+      }
+
+      // the C++ interface
+      {
+        gpi_cp::checkpoint<std::span<char>> checkpoint
+          (data, segment_id_checkpoint, 0, 0, GASPI_GROUP_ALL);
+
+        auto cxx = [&] (int i)
+          {
+            data[0] = (char) i;
+            SUCCESS_OR_DIE (checkpoint.start ());
+            SUCCESS_OR_DIE (checkpoint.commit ());
+          };
+
+        double const t = time_checkpoints (cxx, iterations);
+        best_cxx = (round == 0 || t < best_cxx) ? t : best_cxx;
+
+        SUCCESS_OR_DIE (checkpoint.finalize ());
+      }
+    }
+
+  if (myrank == 0)
+    {
+      printf ("# ranks  KiB/rank  C [us]  C++ [us]  C++/C\n");
+      printf ("%7u  %8lu  %6.3f  %8.3f  %5.3f\n"
+              , nranks, (unsigned long) (size >> 10)
+              , best_c, best_cxx, best_cxx / best_c);
+    }
+
+  SUCCESS_OR_DIE (gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK));
+  SUCCESS_OR_DIE (gaspi_proc_term (GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
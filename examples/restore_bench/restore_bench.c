@@ -0,0 +1,190 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define SUCCESS_OR_DIE(f...)                                    \
+  do                                                            \
+    {                                                           \
+      gaspi_return_t const r = f;                               \
+      if (r != GASPI_SUCCESS)                                   \
+        {                                                       \
+          fprintf(stderr, "%s:%i: %s\n", __FILE__, __LINE__     \
+                  , gaspi_error_str (r));                       \
+          exit (EXIT_FAILURE);                                  \
+        }                                                       \
+    } while (0)
+
+/* group of the ranks below nranks, except avoid */
+static gaspi_group_t
+create_group (gaspi_rank_t nranks, gaspi_rank_t avoid)
+{
+  gaspi_group_t g;
+
+  SUCCESS_OR_DIE (gaspi_group_create (&g));
+
+  gaspi_rank_t i;
+  for (i = 0; i < nranks; i++)
+    {
+      if (i != avoid)
+        SUCCESS_OR_DIE (gaspi_group_add (g, i));
+    }
+
+  SUCCESS_OR_DIE (gaspi_group_commit (g, GASPI_BLOCK));
+
+  return g;
+}
+
+static double
+now_ms (void)
+{
+  struct timeval t;
+  gettimeofday (&t, NULL);
+
+  return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+}
+
+/* recovery time against rank count
+
+   for n = 4, 8, ... up to the number of ranks: ranks 0 to n-2
+   checkpoint, rank n-2 fails, rank n-1 joins as spare. Prints the
+   slowest gpi_cp_restore of the n-1 ranks of the new group.
+
+   usage: restore_bench.bin [MiB per rank (8)] [stripes (0: ring)]
+                            [restore queues (1, 0: all)]
+*/
+int
+main (int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init (GASPI_BLOCK));
+
+  gaspi_rank_t myrank, nranks;
+  SUCCESS_OR_DIE (gaspi_proc_rank (&myrank));
+  SUCCESS_OR_DIE (gaspi_proc_num (&nranks));
+
+  gaspi_size_t const size = (argc > 1 ? atol (argv[1]) : 8) * 1024 * 1024;
+  gaspi_number_t const stripes = argc > 2 ? atoi (argv[2]) : 0;
+  gaspi_number_t const queues = argc > 3 ? atoi (argv[3]) : 1;
+  gpi_cp_policy_t const policy = stripes > 0 ? GPI_CP_POLICY_STRIPED : GPI_CP_POLICY_RING;
+
+  const gaspi_segment_id_t segment_id_checkpoint = 0;
+
+  SUCCESS_OR_DIE (gaspi_segment_create ( segment_id_checkpoint
+                                       , size
+                                       , GASPI_GROUP_ALL
+                                       , GASPI_BLOCK
+                                       , GASPI_MEM_INITIALIZED
+                                       )
+                  );
+
+  gaspi_pointer_t data;
+  SUCCESS_OR_DIE (gaspi_segment_ptr (segment_id_checkpoint, &data));
+  memset (data, myrank + 1, size);
+
+  if (myrank == 0)
+    printf ("# ranks  MiB/rank  stripes  restore [ms]\n");
+
+  gaspi_rank_t n = (nranks < 4) ? nranks : 4;
+
+  for (;; n = (2 * n < nranks) ? 2 * n : nranks)
+    {
+      // a spare, and more ranks than stripes before the failure
+      if (n < 3 || (stripes > 0 && stripes + 1 >= n))
+        {
+          if (n == nranks)
+            break;
+          continue;
+        }
+
+      gaspi_rank_t const spare = n - 1;
+      gaspi_rank_t const culprit = n - 2;
+
+      gpi_cp_description_t description = GPI_CP_DESCRIPTION_INITIALIZER ();
+
+      if (stripes > 0)
+        SUCCESS_OR_DIE (gpi_cp_set_stripes (description, stripes));
+      SUCCESS_OR_DIE (gpi_cp_set_restore_queues (description, queues));
+
+      gaspi_group_t g_init = GASPI_GROUP_ALL;
+      gaspi_group_t g_new = GASPI_GROUP_ALL;
+
+      if (myrank < spare)
+        {
+          g_init = create_group (spare, spare);
+
+          SUCCESS_OR_DIE (gpi_cp_init ( segment_id_checkpoint, 0, size, 0
+                                      , policy, g_init, description, GASPI_BLOCK));
+          SUCCESS_OR_DIE (gpi_cp_start (description, GASPI_BLOCK));
+          SUCCESS_OR_DIE (gpi_cp_commit (description, GASPI_BLOCK));
+        }
+
+      if (myrank < n && myrank != culprit)
+        g_new = create_group (n, culprit);
+
+      SUCCESS_OR_DIE (gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK));
+
+      double elapsed = 0.0;
+
+      if (myrank < n && myrank != culprit)
+        {
+          double const t0 = now_ms ();
+
+          SUCCESS_OR_DIE (gpi_cp_restore ( segment_id_checkpoint, 0, size, 0
+                                         , policy, g_new, description, GASPI_BLOCK));
+
+          elapsed = now_ms () - t0;
+
+          double slowest;
+          SUCCESS_OR_DIE (gaspi_allreduce ( &elapsed, &slowest, 1
+                                          , GASPI_OP_MAX, GASPI_TYPE_DOUBLE
+                                          , g_new, GASPI_BLOCK));
+
+          if (myrank == 0)
+            printf ("%7u  %8lu  %7u  %12.3f\n"
+                    , n, (unsigned long) (size >> 20), stripes, slowest);
+
+          SUCCESS_OR_DIE (gaspi_barrier (g_new, GASPI_BLOCK));
+          SUCCESS_OR_DIE (gpi_cp_finalize (description, GASPI_BLOCK));
+        }
+
+      // the culprit "failed": it keeps its mirror, no finalize
+      SUCCESS_OR_DIE (gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK));
+
+      if (g_init != GASPI_GROUP_ALL)
+        SUCCESS_OR_DIE (gaspi_group_delete (g_init));
+      if (g_new != GASPI_GROUP_ALL)
+        SUCCESS_OR_DIE (gaspi_group_delete (g_new));
+
+      free (description);
+
+      if (n == nranks)
+        break;
+    }
+
+  SUCCESS_OR_DIE (gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK));
+  SUCCESS_OR_DIE (gaspi_proc_term (GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -142,21 +142,15 @@ main(void)
 	      /* Commit previously started checkpoint */
 	      SUCCESS_OR_DIE (gpi_cp_commit (checkpoint_description, GASPI_BLOCK));
 	      
-	      /* Save data to be checkpointed */
-	      memcpy(checkpoint_seg_ptr, work_seg_ptr, size);
-	      
-	      /* Start a new checkpoint */
-	      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+	      /* Save data to be checkpointed and start a new checkpoint */
+	      SUCCESS_OR_DIE ( gpi_cp_snapshot_copy (checkpoint_description, work_seg_ptr, size, true, GASPI_BLOCK) );
 	    }
 #elif WITH_CHECKPOINT == 2
 	  /* VARIANT 2: high-pressure and more synchronous */
 	  if( !gpi_cp_get_state_in_progress(checkpoint_description))
 	    {
-	      /* Save data to be checkpointed */
-	      memcpy(checkpoint_seg_ptr, work_seg_ptr, size);
-	      
-	      /* Start a new checkpoint */
-	      SUCCESS_OR_DIE (gpi_cp_start(checkpoint_description, GASPI_BLOCK));
+	      /* Save data to be checkpointed and start a new checkpoint */
+	      SUCCESS_OR_DIE (gpi_cp_snapshot_copy(checkpoint_description, work_seg_ptr, size, true, GASPI_BLOCK));
 	    }
 	  else
 	    {
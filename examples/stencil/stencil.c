@@ -541,11 +541,10 @@ main(int argc, char *argv[])
   	  /* Commit previously started checkpoint */
           SUCCESS_OR_DIE (gpi_cp_commit, checkpoint_description, GASPI_BLOCK);
 
-          /* Save data to be checkpointed */
-          memcpy(checkpoint_seg_ptr, buffer[from], size_global_x * (size_local_y + 2 * stencil_height()) * sizeof (element_type));
-          
-          /* Start a new checkpoint */
-          SUCCESS_OR_DIE ( gpi_cp_start, checkpoint_description, GASPI_BLOCK ) ;
+          /* Save data to be checkpointed and start a new checkpoint */
+          SUCCESS_OR_DIE ( gpi_cp_snapshot_copy, checkpoint_description, buffer[from]
+                         , size_global_x * (size_local_y + 2 * stencil_height()) * sizeof (element_type)
+                         , true, GASPI_BLOCK ) ;
         }
       }
 #endif
@@ -637,11 +636,10 @@ main(int argc, char *argv[])
 	      /* Commit previously started checkpoint */
 	      SUCCESS_OR_DIE (gpi_cp_commit, checkpoint_description, GASPI_BLOCK);
 
-	      /* Save data to be checkpointed */
-	      memcpy(checkpoint_seg_ptr, buffer[from], size_global_x * (size_local_y + 2 * stencil_height()) * sizeof (element_type));
-
-	      /* Start a new checkpoint */
-	      SUCCESS_OR_DIE ( gpi_cp_start, checkpoint_description, GASPI_BLOCK ) ;
+	      /* Save data to be checkpointed and start a new checkpoint */
+	      SUCCESS_OR_DIE ( gpi_cp_snapshot_copy, checkpoint_description, buffer[from]
+	                     , size_global_x * (size_local_y + 2 * stencil_height()) * sizeof (element_type)
+	                     , true, GASPI_BLOCK ) ;
 	    }
 #endif
 
@@ -48,9 +48,60 @@ extern "C"
  */
     typedef enum
     {
-        GPI_CP_POLICY_RING = 1 /* simple ring communication  */
+        GPI_CP_POLICY_RING = 1, /* simple ring communication  */
+        GPI_CP_POLICY_STRIPED = 2 /* one copy, split over the next ranks */
     }  gpi_cp_policy_t;
 
+/**
+ * Element types of lossy compression.
+ *
+ */
+    typedef enum
+    {
+        GPI_CP_FLOAT = 1, /* IEEE 754 single precision */
+        GPI_CP_DOUBLE = 2 /* IEEE 754 double precision */
+    }  gpi_cp_float_type_t;
+
+/**
+ * Flags of gpi_cp_register.
+ *
+ */
+    typedef enum
+    {
+        GPI_CP_VARIABLE_MARKED = 0, /* changed when marked by gpi_cp_mark_dirty */
+        GPI_CP_VARIABLE_ALWAYS = 1 /* changed at every checkpoint */
+    }  gpi_cp_variable_flags_t;
+
+/**
+ * Part of the data of a failed rank that a survivor takes over in
+ * gpi_cp_restore_shrinking.
+ *
+ */
+    typedef struct
+    {
+        gaspi_offset_t offset; /* within the checkpoint of the failed rank */
+        gaspi_size_t size; /* 0: nothing for this survivor */
+        gaspi_segment_id_t segment_id; /* where it goes on the survivor */
+        gaspi_offset_t segment_offset;
+    } gpi_cp_part_t;
+
+/**
+ * Chooses the part of the failed_index-th failed rank (in the order of
+ * the ring) that the survivor at position takes over. In gpi_cp_expand:
+ * the part of the member at failed_index in the ring that the new rank
+ * at position takes over.
+ *
+ */
+    typedef gaspi_return_t (*gpi_cp_redistribution_t)
+      ( const gaspi_rank_t failed
+      , const gaspi_number_t failed_index
+      , const gaspi_size_t size
+      , const gaspi_number_t position
+      , const gaspi_number_t number_of_survivors
+      , gpi_cp_part_t* const part
+      , void* context
+      );
+
 /**
  * Functions return type.
  * 
@@ -83,7 +134,18 @@ extern "C"
 
 /** Initialise checkpoint
  *
- * will create a segment of size '2 * size' (locally to allow buddies to store data)
+ * will create a segment of size '2 * size' (locally to allow buddies to store data),
+ * '3 * size' for pipelined descriptions. Its segment id is the same on
+ * all ranks: the lowest one no rank of the group (and of the spare
+ * pool) uses, agreed on in one allreduce of gaspi_segment_max values
+ *
+ * The notification ids of the mirror segment follow each other:
+ * ranks * snapshots for the snapshots, as many for the confirmations
+ * of the neighbourhood commit, 3 * ranks + 1 for a spare pool, ranks
+ * for block elimination; an option needs all ids up to its own. If
+ * gaspi_notification_num (at most 65536) is smaller, gpi_cp_init (and
+ * gpi_cp_restore, gpi_cp_expand) fail instead of letting the ids
+ * alias each other.
  *
  * \todo integrate with gaspi_error_str
  * \note global operation
@@ -135,12 +197,72 @@ extern "C"
     gpi_cp_start ( gpi_cp_description_t
                  , const gaspi_timeout_t timeout_ms
                  );
+
+/** copy the data into the checkpointed region, and start checkpointing
+ *
+ * replaces the memcpy into [offset, offset + size) before
+ * gpi_cp_start: a team of threads (gpi_cp_set_copy_threads) copies in
+ * chunks with non-temporal stores, thread i the i-th contiguous share
+ * on the i-th of the CPUs of the process spread evenly, which matches
+ * data first touched in a static schedule. With start, every chunk is
+ * written to the receiver as soon as it is copied, so copying and
+ * transfer overlap; with checksums, compression, deltas or block
+ * elimination the copy completes first. Bytes of the region behind
+ * size are sent as they are.
+ *
+ * \note with start like gpi_cp_start, otherwise not while a checkpoint
+ *       is in progress
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param data:
+ *             the data of the application
+ * \param size:
+ *             bytes at data, at most the size of the region
+ * \param start:
+ *             start checkpointing as well
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_snapshot_copy ( gpi_cp_description_t description
+                         , const void* data
+                         , const gaspi_size_t size
+                         , const bool start
+                         , const gaspi_timeout_t timeout_ms
+                         );
+
+/** pack the registered variables that changed, and start checkpointing
+ *
+ * copies every variable (gpi_cp_register) that changed and is due
+ * into its range of the region, and stamps it with the epoch of the
+ * checkpoint. Only the directory of the variables and those the slot
+ * on the receiver does not hold yet are sent, so static data is sent
+ * once per slot instead of every time; with checksums, compression,
+ * deltas or block elimination the whole region is sent.
+ *
+ * \note like gpi_cp_start; the region holds the variables only, it is
+ *       not changed otherwise
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_checkpoint_variables ( gpi_cp_description_t description
+                                , const gaspi_timeout_t timeout_ms
+                                );
  
 /** Commit checkpointing
  *
  * wait for the current checkpoint to be created and make sure
  * that the corresponding data has been copied.
  *
+ * On GASPI_TIMEOUT in the global part the commit stays pending and is
+ * continued by the next call. A pipelined description may start the
+ * next checkpoint meanwhile.
+ *
  * \note global operation
  * \post the last checkpoint_start has been finished on all ranks
  *       => there is a complete snapshot available
@@ -158,9 +280,22 @@ extern "C"
  
  /** Restore checkpoint
  *
+ * two allreduces: the first, of a fixed size, agrees on the newest
+ * epoch the survivors started, with which all continue, and gives
+ * joiners the segment id of the mirrors (the same on all ranks); the
+ * second follows the registration of the new mirrors and carries
+ * bitmaps of the joiners and of the stripes joining spares keep in
+ * shadows, 'stripes' + 1 bits per rank. Mirror slots are stamped
+ * with the epoch of their stripes: joiners read the newest epoch all
+ * their receivers hold, survivors refill the mirrors of joiners and
+ * of receivers whose stamp lags behind with their local copy of the
+ * epoch (gpi_cp_set_local_copy); without one such a receiver holds
+ * their data again after the next checkpoint. No passive messages.
  *
- * \note global operation, call from every member in the new_group
- * \todo probably fails in case two consecutive nodes (wrt topology) failed
+ * \note global operation, call from every member in the new_group;
+ *       a joiner takes the place of the failed rank in the order of
+ *       the group
+ * \todo fails in case two consecutive nodes (wrt topology) failed
  * \param segment_id_checkpoint:
  *            is a local value, possibly different on different ranks
  *            size (segment_id_checkpoint) >= size, or else undefined
@@ -181,12 +316,14 @@ extern "C"
  *            used in gpi_cp_init but of the same size
  * \param description is IN and OUT
  *            - on survivors: put in the old description and get updates
- *            - on joiners: put in an empty description like in init
+ *            - on joiners: put in an empty description like in init,
+ *              configured like the one of the survivors (e.g. pipelined)
  * \param gaspi_timeout_t:
  *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
  * \post - description up to data (== checkpointing works again)
- *       - data from the last consistent snapshots (== successful commit)
- *         has been restored into the provided memory region
+ *       - data from the newest complete snapshot (== local part of a
+ *         commit done on the receiver) has been restored into the
+ *         provided memory region
  */
     gaspi_return_t
     gpi_cp_restore ( const gaspi_segment_id_t segment_id_checkpoint
@@ -199,6 +336,114 @@ extern "C"
                    , const gaspi_timeout_t timeout_ms
                    );
 
+/** Restore on fewer ranks, without spares
+ *
+ * the survivors take over the data of the failed ranks in parts, as
+ * chosen by redistribution, and continue as new_group. Every survivor
+ * reads its parts from the mirrors of the receivers of the failed
+ * ranks, all in parallel and in chunks over several queues. Then the
+ * checkpoint starts over with the new memory region (which usually
+ * holds the parts as well): the receivers hold nothing until the next
+ * checkpoint, which every survivor should take right away.
+ *
+ * \note global operation, call from every member in the new_group,
+ *       which holds survivors only; not with a spare pool
+ * \param segment_id_checkpoint, offset, size, queue:
+ *            the checkpoint from now on, as in gpi_cp_init (size the
+ *            same on all ranks)
+ * \param new_group:
+ *            the survivors
+ * \param redistribution:
+ *            chooses the parts, e.g. gpi_cp_block_redistribution;
+ *            called once per failed rank on every survivor
+ * \param context:
+ *            passed to redistribution
+ * \param description is IN and OUT: the old description
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
+ * \post - the parts of the newest snapshot the receivers of a failed
+ *         rank hold complete are in place
+ *       - description up to date (== checkpointing works again)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+ *         error (e.g. a failed rank and its receiver).
+ */
+    gaspi_return_t
+    gpi_cp_restore_shrinking ( const gaspi_segment_id_t segment_id_checkpoint
+                             , const gaspi_offset_t offset
+                             , const gaspi_size_t size
+                             , const gaspi_queue_id_t queue
+                             , const gaspi_group_t new_group
+                             , gpi_cp_redistribution_t redistribution
+                             , void* context
+                             , gpi_cp_description_t description
+                             , const gaspi_timeout_t timeout_ms
+                             );
+
+/** block distribution for gpi_cp_restore_shrinking
+ *
+ * survivor i gets the i-th of number_of_survivors blocks of
+ * ceil (size / number_of_survivors) bytes (the last ones may be
+ * shorter or empty). context points to a gpi_cp_part_t with the
+ * segment and offset of the first block; the block of the next failed
+ * rank follows after a whole block size.
+ */
+    gaspi_return_t
+    gpi_cp_block_redistribution ( const gaspi_rank_t failed
+                                , const gaspi_number_t failed_index
+                                , const gaspi_size_t size
+                                , const gaspi_number_t position
+                                , const gaspi_number_t number_of_survivors
+                                , gpi_cp_part_t* const part
+                                , void* context
+                                );
+
+/** Add ranks to the checkpoint, without a restart
+ *
+ * the new ranks follow the members in the ring, in rank order, so only
+ * the partners next to the seam change: a member keeps its mirror and
+ * refills just the receivers that changed (from its local copy, see
+ * gpi_cp_restore), a new rank has no snapshot before the next
+ * checkpoint. With a redistribution the new ranks first take
+ * over parts of the newest snapshot of the members, read from the
+ * mirrors of their receivers, e.g. to give the new ranks some of the
+ * work.
+ *
+ * \note global operation, call from every member and every new rank in
+ *       the new_group; not with a spare pool
+ * \param segment_id_checkpoint, offset, size, queue, policy:
+ *            on new ranks the checkpoint, as in gpi_cp_init; on members
+ *            size and policy as before, the rest is ignored
+ * \param new_group:
+ *            the members and the new ranks
+ * \param redistribution:
+ *            chooses the parts, called once per member on every new
+ *            rank; NULL: none
+ * \param context:
+ *            passed to redistribution
+ * \param description is IN and OUT
+ *            - on members: the description, it gets updated
+ *            - on new ranks: an empty description like in init,
+ *              configured like the one of the members
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
+ * \post - the parts are in place on the new ranks
+ *       - description up to date, the new ranks checkpoint as members
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+ *         error (e.g. a size that differs).
+ */
+    gaspi_return_t
+    gpi_cp_expand ( const gaspi_segment_id_t segment_id_checkpoint
+                  , const gaspi_offset_t offset
+                  , const gaspi_size_t size
+                  , const gaspi_queue_id_t queue
+                  , const gpi_cp_policy_t policy
+                  , const gaspi_group_t new_group
+                  , gpi_cp_redistribution_t redistribution
+                  , void* context
+                  , gpi_cp_description_t description
+                  , const gaspi_timeout_t timeout_ms
+                  );
+
 /** frees checkpoint segment
  *
  * \note undefined behavior when checkpoint_start still in progress
@@ -236,7 +481,8 @@ extern "C"
  *
  * \param gpi_cp_description_t:
  *             description of the checkpoint memory layout
- * \return true if checkpointing in progress, false otherwise
+ * \return true if checkpointing in progress (no gpi_cp_start possible),
+ *         false otherwise
  */
     bool
     gpi_cp_get_state_in_progress( const gpi_cp_description_t description );
@@ -260,6 +506,755 @@ extern "C"
     gpi_cp_get_receiver_ptr( const gpi_cp_description_t description );
 
 
+/** pipeline consecutive checkpoints
+ *
+ * keeps a third snapshot slot on the receiver, so that gpi_cp_start of
+ * epoch n+1 may be called while the barrier of epoch n is still
+ * outstanding (gpi_cp_commit returned GASPI_TIMEOUT)
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same value on all ranks
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param pipelined:
+ *             true for three snapshot slots, false (default) for two
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_pipelined( gpi_cp_description_t description
+                        , const bool pipelined );
+
+/** commit with the partners instead of the whole group
+ *
+ * gpi_cp_commit ends in a barrier over the group by default. With an
+ * agreement interval n > 0 a rank instead confirms the snapshots it
+ * received to its senders (notifications) and waits until its
+ * receivers confirmed its own, so a slow rank only delays its
+ * neighbours. Every n commits an allreduce of the minimum committed
+ * epoch is started and progressed by the following commits without
+ * blocking; gpi_cp_get_global_epoch returns its last result.
+ * gpi_cp_restore continues with the newest epoch of the survivors and
+ * refills the mirrors that lag behind.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same value on all ranks; the application must not run
+ *       collectives of its own on the group of the description while
+ *       an agreement may be running (until gpi_cp_finalize)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param agreement_interval:
+ *             commits between agreements, 0 to commit with a barrier
+ *             (default)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_neighbourhood_commit( gpi_cp_description_t description
+                                   , const gaspi_number_t agreement_interval );
+
+/** newest epoch known to be committed on all ranks
+ *
+ * the number of commits with a barrier; with the neighbourhood commit
+ * the result of the last agreement (or restore)
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return number of the epoch, 0 before the first commit
+ */
+    unsigned long
+    gpi_cp_get_global_epoch( const gpi_cp_description_t description );
+
+/** number of stripes of the striped policy
+ *
+ * with GPI_CP_POLICY_STRIPED the data of a rank is split into
+ * 'stripes' parts of equal size, part j is mirrored on the (j+1)-th
+ * rank after it in the group. Every rank keeps as much mirror memory as
+ * with the ring, but checkpoints use 'stripes' links and a joiner
+ * restores from 'stripes' ranks at once. Partners are bound with two
+ * allreduces instead of passive messages.
+ *
+ * The options that expect the whole snapshot of one sender in a slot
+ * are not combined with the striped policy yet; gpi_cp_init fails with
+ * persistent copies (gpi_cp_set_persistent_path), mirror files
+ * (gpi_cp_set_mirror_path), checksums (gpi_cp_set_checksums), the lazy
+ * restore (gpi_cp_set_lazy_restore), compression
+ * (gpi_cp_set_compression, gpi_cp_set_lossy_compression), deltas
+ * (gpi_cp_set_delta) and block elimination
+ * (gpi_cp_set_block_elimination).
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same value on all ranks; the group must have more than
+ *       'stripes' members
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param stripes:
+ *             1 to GPI_CP_STRIPES_MAX (16), default 2
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_stripes( gpi_cp_description_t description
+                      , const gaspi_number_t stripes );
+
+/** keep persistent copies of committed snapshots
+ *
+ * after every commit a background writer streams the committed
+ * snapshot held in the local mirror (i.e. the data of the sender) to
+ * 'path/gpi_cp.<sender>.<epoch % 2>.snapshot', using large aligned
+ * O_DIRECT writes (io_uring when built with WITH_LIBURING). A file is
+ * replaced atomically, so it always contains a complete snapshot; the
+ * format (header, per-chunk CRC32C, index) is described in the README.
+ * A commit waits for the previous copy before the slot can be reused.
+ * A failed copy (e.g. no space left on the device) is returned as
+ * GASPI_ERROR by the next gpi_cp_commit, gpi_cp_restore, gpi_cp_recover
+ * or gpi_cp_finalize, which can then be called again.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param path:
+ *             local directory or burst buffer, NULL to disable (default)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_persistent_path( gpi_cp_description_t description
+                              , const char* path );
+
+/** restore joiners lazily
+ *
+ * gpi_cp_restore on a joiner returns without waiting for the snapshot:
+ * the pages of the checkpoint region are dropped and filled from the
+ * mirror on first touch (userfaultfd), a background thread streams
+ * the rest. gpi_cp_start, gpi_cp_read_buddy, gpi_cp_restore and
+ * gpi_cp_finalize wait until the region is complete. Falls back to
+ * reading eagerly if userfaultfd is not available (see
+ * gpi_cp_get_state_lazy_restore).
+ *
+ * Replacing the pages is only safe if the network does not pin them:
+ * a pinned segment keeps the old pages registered and the next
+ * gpi_cp_start would send those. Only declare memory that is
+ * registered with on-demand paging; pinned regions are restored
+ * eagerly.
+ *
+ * \note call before gpi_cp_restore (joiners)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param on_demand_paging:
+ *             true if the checkpoint segment is not pinned (on-demand
+ *             paging), which enables the lazy restore; false (default)
+ *             to restore eagerly
+ * \param queue:
+ *             queue of the background thread, not the one given to
+ *             gpi_cp_restore, which the application keeps using (with
+ *             that one the joiner restores eagerly)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_lazy_restore( gpi_cp_description_t description
+                           , const bool on_demand_paging
+                           , const gaspi_queue_id_t queue );
+
+/** whether a lazy restore is still running
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return true on a joiner after gpi_cp_restore took the lazy path,
+ *         until the next call that waits for the region
+ */
+    bool
+    gpi_cp_get_state_lazy_restore( const gpi_cp_description_t description );
+
+/** number of queues used to restore a snapshot
+ *
+ * restores (joiners, gpi_cp_read_buddy, gpi_cp_restart_from_files)
+ * split the snapshot into chunks and read them round robin over the
+ * queues queue, queue + 1, ... (modulo the number of queues), so that
+ * several reads are in flight at once. By default only the queue of
+ * the description is used.
+ *
+ * \note may be called at any time, takes effect with the next restore;
+ *       operations the application posted to the additional queues
+ *       are waited for as well
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param number_of_queues:
+ *             1 for a single queue (default), 0 for all queues
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_restore_queues( gpi_cp_description_t description
+                             , const gaspi_number_t number_of_queues );
+
+/** end-to-end checksums of snapshots
+ *
+ * gpi_cp_start computes a CRC32C (SSE4.2 where available) of the data
+ * and writes it, with the epoch the snapshot becomes, next to the slot
+ * on the receiver. The receiver checks the data in the background
+ * after the local part of gpi_cp_commit. The results are agreed on in
+ * place of the barrier of the commit: a mismatch anywhere rejects the
+ * epoch, gpi_cp_commit returns GASPI_ERROR on all ranks and the
+ * previous epoch stays committed; the next gpi_cp_start sends the
+ * snapshot again. Joiners check the data they restored.
+ *
+ * Checksums need the barrier commit and two snapshots: gpi_cp_init
+ * fails with the neighbourhood commit (gpi_cp_set_neighbourhood_commit,
+ * a receiver could reject an epoch its sender already confirmed) and
+ * pipelined (gpi_cp_set_pipelined, an epoch could be started on top of
+ * a rejected one). They are not combined with the striped policy,
+ * compression, deltas or block elimination either, see their setters.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same value on all ranks
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param checksums:
+ *             true to enable, false (default) to disable
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_checksums( gpi_cp_description_t description
+                        , const bool checksums );
+
+/** back the mirror segment with a file
+ *
+ * the snapshot slots kept for the sender are a shared mapping of
+ * 'path/gpi_cp.<rank>.mirror' (MAP_SYNC on DAX file systems), bound
+ * to the mirror segment with gaspi_segment_bind: remote writes land
+ * in the file directly. A commit flushes the slot it received and,
+ * after the barrier, records epoch and committed slot in a state block
+ * behind the slots. No separate copy pass is needed, and
+ * gpi_cp_restart_from_files can continue from the file.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param path:
+ *             directory on a pmem/DAX or tmpfs file system, NULL to
+ *             use anonymous memory (default)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_mirror_path( gpi_cp_description_t description
+                          , const char* path );
+
+/** compress snapshots losslessly
+ *
+ * gpi_cp_start compresses the data in chunks into a staging segment
+ * and writes every chunk as soon as it is compressed, so that the
+ * transfer overlaps with the compression of the next one. A chunk is
+ * byte shuffled first (byte k of all elements of element_size bytes
+ * together, which makes floating point data compress well), then LZ
+ * compressed; one that does not get smaller is sent as it is. The
+ * receiver keeps the compressed snapshot in a slot of capacity bytes,
+ * joiners decompress after reading it. gpi_cp_read_buddy reads the
+ * compressed slot.
+ *
+ * The options that expect the data in the slot as it is are not
+ * combined with compression yet; gpi_cp_init fails with persistent
+ * copies (gpi_cp_set_persistent_path), mirror files
+ * (gpi_cp_set_mirror_path), checksums (gpi_cp_set_checksums), the lazy
+ * restore (gpi_cp_set_lazy_restore), spare shadows
+ * (gpi_cp_set_spare_shadows), deltas (gpi_cp_set_delta, which compress
+ * on their own), block elimination (gpi_cp_set_block_elimination) and
+ * the striped policy. gpi_cp_restore_shrinking and gpi_cp_expand fail
+ * where they would move parts of a snapshot.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same values on all ranks
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param element_size:
+ *             bytes per element of the data (e.g. 8 for double), 1 for
+ *             no shuffle, 0 to disable compression (default)
+ * \param capacity:
+ *             bytes per slot on the receiver, 0 for as much as data that
+ *             does not compress takes. gpi_cp_start returns GASPI_ERROR
+ *             (and starts no epoch) if a snapshot does not fit.
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_compression( gpi_cp_description_t description
+                          , const gaspi_size_t element_size
+                          , const gaspi_size_t capacity );
+
+/** compress snapshots of floating point data with a bounded error
+ *
+ * like gpi_cp_set_compression with the element size of type, but each
+ * element is rounded to the fewest mantissa bits that keep its
+ * relative error within relative_error before the shuffle, so that the
+ * low order bytes become zeros and compress away. A restored value r
+ * of a normal number x satisfies |r - x| <= relative_error * |x|;
+ * infinities and NaNs are kept, denormals only within the absolute
+ * error of their exponent. Data that is not of type must not use it.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same values on all ranks; the restrictions of
+ *       gpi_cp_set_compression apply. The data of the application is
+ *       not changed, only the copy on the receiver.
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param type:
+ *             GPI_CP_FLOAT or GPI_CP_DOUBLE
+ * \param relative_error:
+ *             bound of the error, > 0 (e.g. 1e-6); 2^-24 (float) or
+ *             2^-53 (double) and below keep all bits
+ * \param capacity:
+ *             as for gpi_cp_set_compression
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_lossy_compression( gpi_cp_description_t description
+                                , const gpi_cp_float_type_t type
+                                , const double relative_error
+                                , const gaspi_size_t capacity );
+
+/** send snapshots as deltas to the previous one
+ *
+ * gpi_cp_start XORs the data with the snapshot it sent before (kept in
+ * local memory), which leaves zeros wherever the data did not change
+ * and in the high order bytes of slowly changing floating point
+ * values, and compresses the result like gpi_cp_set_compression. The
+ * receiver applies it onto the slot of the previous snapshot during
+ * gpi_cp_commit, so the slots hold the data as usual and restores are
+ * not affected. The first snapshot, the first one after a restore and
+ * any whose delta is not smaller than the data are sent as they are.
+ *
+ * gpi_cp_init fails with deltas and compression (gpi_cp_set_compression,
+ * gpi_cp_set_lossy_compression; deltas are compressed already),
+ * checksums (gpi_cp_set_checksums, which would have to be of the data
+ * after the delta is applied), block elimination
+ * (gpi_cp_set_block_elimination) or the striped policy.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same value on all ranks. Takes about 2 * size bytes of local
+ *       memory for the previous snapshot and the staging buffer.
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param element_size:
+ *             bytes per element of the data for the shuffle (e.g. 8 for
+ *             double), 1 for no shuffle, 0 to disable deltas (default)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_delta( gpi_cp_description_t description
+                    , const gaspi_size_t element_size );
+
+/** do not send blocks the receiver can fill in itself
+ *
+ * gpi_cp_start splits the data into blocks of block_size bytes and
+ * skips those that are all zero; the receiver zeroes them in its slot
+ * during gpi_cp_commit, unless the slot holds zeros there already.
+ * With deduplicate every rank also hashes its blocks (64 bit) and
+ * hands the hashes to its sender, which then skips blocks equal to the
+ * block of its receiver at the same offset (e.g. replicated tables);
+ * the receiver copies them from its own data. This makes gpi_cp_start
+ * wait for the hashes of the receiver, i.e. for its gpi_cp_start.
+ *
+ * Deduplication is probabilistic: blocks count as equal if their
+ * hashes are, and the sender never sees the bytes of the receiver to
+ * compare them. Two different blocks at the same offset whose 63 bit
+ * hashes collide (for unrelated data about one in 2^63 per block and
+ * snapshot, the hash is not cryptographic) are restored wrongly and
+ * silently, checksums are not available to catch it. Leave
+ * deduplicate off where that is not acceptable, e.g. for data an
+ * adversary controls.
+ *
+ * gpi_cp_init fails with block elimination and compression
+ * (gpi_cp_set_compression, gpi_cp_set_lossy_compression) or deltas
+ * (gpi_cp_set_delta), which lay out the slots and the staging segment
+ * on their own, and with checksums (gpi_cp_set_checksums) or the
+ * striped policy, which are not implemented for it yet.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners), with the
+ *       same values on all ranks
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param block_size:
+ *             bytes per block (e.g. 65536), 0 to disable (default)
+ * \param deduplicate:
+ *             skip blocks equal to those of the receiver as well
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_block_elimination( gpi_cp_description_t description
+                                , const gaspi_size_t block_size
+                                , const bool deduplicate );
+
+/** bytes not sent thanks to block elimination
+ *
+ * summed over all snapshots this rank sent since gpi_cp_init
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param zero:
+ *             output: bytes of zero blocks, may be NULL
+ * \param duplicate:
+ *             output: bytes of blocks equal to those of the receiver,
+ *             may be NULL
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_get_saved_bytes( const gpi_cp_description_t description
+                          , gaspi_size_t* const zero
+                          , gaspi_size_t* const duplicate );
+
+/** bytes of the last compressed snapshot or delta sent
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return the size with header, 0 without compression or deltas
+ */
+    gaspi_size_t
+    gpi_cp_get_compressed_size( const gpi_cp_description_t description );
+
+/** threads of gpi_cp_snapshot_copy
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param threads:
+ *             at least 1 (default), the caller posts the transfers
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_copy_threads( gpi_cp_description_t description
+                           , const gaspi_number_t threads );
+
+/** allocate from the checkpointed data
+ *
+ * the region [offset, offset + size) becomes a heap whose bookkeeping
+ * lives in the region itself, so the objects of the application are
+ * checkpointed in place, without a copy, and a restore brings back a
+ * usable heap. The region is formatted by the first call, its data is
+ * lost then. Objects may be mapped at another address after a
+ * restore: refer to them by offsets from the root
+ * (gpi_cp_set_root), not by pointers.
+ *
+ * \note not while a checkpoint is in progress, nor may the objects
+ *       change then
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param bytes:
+ *             size of the object
+ * \param align:
+ *             alignment, a power of two up to 4096 (0: 16)
+ * \return the object, NULL if there is no room or in case of error.
+ */
+    void*
+    gpi_cp_alloc( gpi_cp_description_t description
+                , const gaspi_size_t bytes
+                , const gaspi_size_t align );
+
+/** return an object to the heap in the checkpointed data
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param pointer:
+ *             as returned by gpi_cp_alloc
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_free( gpi_cp_description_t description
+               , void* const pointer );
+
+/** the object to find the others from after a restore
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param pointer:
+ *             an object from gpi_cp_alloc, NULL for none
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_root( gpi_cp_description_t description
+                   , void* const pointer );
+
+/** the root object of the heap in the checkpointed data
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return the object, NULL if there is none.
+ */
+    void*
+    gpi_cp_get_root( gpi_cp_description_t description );
+
+/** register a variable of the application under name
+ *
+ * the variable gets its own range of the region, behind a directory
+ * of up to 256 variables (16 KiB), and is packed by
+ * gpi_cp_checkpoint_variables. A variable changes at every checkpoint
+ * with GPI_CP_VARIABLE_ALWAYS, otherwise only when marked
+ * (gpi_cp_mark_dirty); it is packed at the first checkpoint after its
+ * registration in any case. Joiners register the same names (in any
+ * order) after gpi_cp_restore, then call gpi_cp_restore_variables.
+ *
+ * \note call after gpi_cp_init or gpi_cp_restore; do not mix with
+ *       other uses of the region
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param name:
+ *             unique, at most 39 characters
+ * \param pointer:
+ *             the variable, stays in place while registered
+ * \param bytes:
+ *             its size
+ * \param flags:
+ *             GPI_CP_VARIABLE_MARKED or GPI_CP_VARIABLE_ALWAYS
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error
+ *         (e.g. the name is taken or the region is full).
+ */
+    gaspi_return_t
+    gpi_cp_register( gpi_cp_description_t description
+                   , const char* name
+                   , void* const pointer
+                   , const gaspi_size_t bytes
+                   , const unsigned int flags );
+
+/** checkpoint frequency of a variable
+ *
+ * a changed variable is packed at most every interval-th call of
+ * gpi_cp_checkpoint_variables; until then the snapshots hold its
+ * older data.
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param name:
+ *             of a registered variable
+ * \param interval:
+ *             at least 1 (default)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_variable_interval( gpi_cp_description_t description
+                                , const char* name
+                                , const gaspi_number_t interval );
+
+/** the variable changed since the last checkpoint
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param name:
+ *             of a registered variable
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_mark_dirty( gpi_cp_description_t description
+                     , const char* name );
+
+/** copy the registered variables back from the region, by name
+ *
+ * after gpi_cp_restore (or gpi_cp_rollback): every registered
+ * variable gets the data of its name in the restored snapshot and
+ * keeps its range of the region from then on. Variables of the
+ * snapshot that are not registered are dropped by the next
+ * checkpoint.
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error
+ *         (e.g. a variable is not in the snapshot, or with another
+ *         size; then no variable is changed).
+ */
+    gaspi_return_t
+    gpi_cp_restore_variables( gpi_cp_description_t description );
+
+/** the epoch the data of a variable is from
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param name:
+ *             of a registered variable
+ * \return the epoch of the checkpoint that packed it last (or of the
+ *         restored data), 0 if it was not packed yet or is unknown.
+ */
+    unsigned long
+    gpi_cp_get_variable_epoch( gpi_cp_description_t description
+                             , const char* name );
+
+/** bytes of the variables packed by the last
+ *  gpi_cp_checkpoint_variables
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return the size without the directory.
+ */
+    gaspi_size_t
+    gpi_cp_get_packed_size( const gpi_cp_description_t description );
+
+/** keep a local copy of every snapshot for gpi_cp_rollback
+ *
+ * gpi_cp_start copies the data into one of as many local buffers as
+ * there are slots (2, or 3 when pipelined) with non-temporal stores,
+ * so the copy does not evict the data of the application from the
+ * caches. Takes that many times size bytes of local memory. A
+ * restore refills the mirrors of new or lagging receivers from the
+ * copy of the current epoch.
+ *
+ * \note call before gpi_cp_init and gpi_cp_restore (joiners)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param local_copy:
+ *             keep the copies (default: false)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_local_copy( gpi_cp_description_t description
+                         , const bool local_copy );
+
+/** roll the data back to the newest snapshot committed on all ranks
+ *
+ * without a failure, e.g. after the computation diverged: the ranks
+ * agree on the epoch in one allreduce and copy their local copy of it
+ * back into the checkpointed data. A pending commit is completed
+ * first. The snapshots on the receivers stay as they are, the next
+ * checkpoint replaces them as usual.
+ *
+ * \note collective on the group, needs gpi_cp_set_local_copy; ranks
+ *       that joined have no copies of the snapshots before, nor has
+ *       any rank after gpi_cp_restore_shrinking
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
+ * \return GASPI_SUCCESS in case of success, GASPI_TIMEOUT in case of
+ *         timeout, GASPI_ERROR in case of error (e.g. a checkpoint is
+ *         in progress, or a rank has no copy of the epoch; then the
+ *         data is unchanged on all ranks).
+ */
+    gaspi_return_t
+    gpi_cp_rollback( gpi_cp_description_t description
+                   , const gaspi_timeout_t timeout_ms );
+
+/** Restart from persistent copies
+ *
+ * like gpi_cp_init, but afterwards the data of the newest epoch that
+ * is complete on all ranks is read back: every rank loads the copy it
+ * keeps for its sender into its mirror and its own data from its own
+ * file if visible (shared file system), otherwise from the mirror of
+ * its receiver. All ranks read in parallel, every chunk is checked.
+ * With a mirror path (gpi_cp_set_mirror_path) the copy for the sender
+ * is taken from the mirror file instead, if its state block records
+ * that epoch.
+ *
+ * \note global operation, the description needs a persistent path
+ *       (gpi_cp_set_persistent_path) or a mirror path, and the same
+ *       group size, policy and size as the one that wrote the files
+ * \param parameters: as for gpi_cp_init
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+ *         error (e.g. no complete set of valid files).
+ */
+    gaspi_return_t
+    gpi_cp_restart_from_files ( const gaspi_segment_id_t segment_id_checkpoint
+                              , const gaspi_offset_t offset
+                              , const gaspi_size_t size
+                              , const gaspi_queue_id_t queue
+                              , const gpi_cp_policy_t policy
+                              , const gaspi_group_t group
+                              , gpi_cp_description_t description
+                              , const gaspi_timeout_t timeout_ms
+                              );
+
+/** spare ranks that replace failed members in gpi_cp_recover
+ *
+ * the spares call gpi_cp_init (and gpi_cp_finalize) like the members
+ * and wait in gpi_cp_recover. gpi_cp_init registers the mirrors of
+ * members and spares with each other once, they share their segment
+ * id; a spare keeps an empty mirror until it is needed. Enables gpi_cp_heartbeat and gpi_cp_recover.
+ *
+ * \note call before gpi_cp_init on members and spares, configured
+ *       alike (e.g. pipelined, stripes)
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param spares:
+ *             the spare ranks, disjoint from the group of gpi_cp_init;
+ *             they are used in rank order (see gpi_cp_set_spare_shadows)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_spares( gpi_cp_description_t description
+                     , const gaspi_group_t spares );
+
+/** spares keep shadows of the checkpoints
+ *
+ * the spares share the ring positions of the members in contiguous
+ * blocks; gpi_cp_start writes all of the data of a member to the spare
+ * of its position as well, once more per snapshot. gpi_cp_recover gives
+ * a failed position to its spare if it is still in the pool: the data
+ * of the failed member and the stripes of its senders are local then,
+ * the restore only rebinds the group.
+ *
+ * \note call before gpi_cp_init on members and spares, with
+ *       gpi_cp_set_spares. A spare needs the memory of number of
+ *       snapshots times size per position of its block.
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param shadows:
+ *             whether the spares keep shadows (default: false)
+ * \return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+ */
+    gaspi_return_t
+    gpi_cp_set_spare_shadows( gpi_cp_description_t description
+                            , const bool shadows );
+
+/** failure detector
+ *
+ * sends a heartbeat to the receivers and waits for the one of the
+ * senders. A sender that stays silent for timeout_ms is looked up in
+ * gaspi_state_vec_get. Reports a failure as well if GASPI knows of a
+ * failed member, or another member started gpi_cp_recover.
+ *
+ * \note members only, needs gpi_cp_set_spares
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST)
+ * \return GASPI_SUCCESS if all is well, GASPI_TIMEOUT if a sender was
+ *         silent but is not known to have failed, GASPI_ERROR in case
+ *         of a failure: call gpi_cp_recover.
+ */
+    gaspi_return_t
+    gpi_cp_heartbeat( gpi_cp_description_t description
+                    , const gaspi_timeout_t timeout_ms );
+
+/** replace failed members by spares and restore
+ *
+ * the surviving members agree on the set of failed ones by exchanging
+ * their views in rounds (one-sided, on a dedicated notification
+ * range), checking the state of a member they wait for every 100 ms.
+ * Every failed member gets the next spare (or the one with its shadow)
+ * in its place of the ring, the first survivor tells the spares. All build the new group and
+ * restore as in gpi_cp_restore, the spares as joiners.
+ *
+ * \note call on all surviving members once one of them found a failure
+ *       (gpi_cp_heartbeat, or an error of a commit), and on the spares.
+ *       Failures during the recovery are not covered.
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \param new_group:
+ *             output: the new group, created by gpi_cp_recover; the
+ *             application deletes the old one. Untouched on a spare
+ *             that was released.
+ * \param gaspi_timeout_t:
+ *             timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST); on a
+ *             spare a timeout can be continued, on a member it ends the
+ *             recovery unsuccessfully
+ * \return GASPI_SUCCESS once the members work again, or a spare was
+ *         released by gpi_cp_finalize of the members (see
+ *         gpi_cp_get_state_spare); GASPI_ERROR e.g. if no spare is left.
+ */
+    gaspi_return_t
+    gpi_cp_recover( gpi_cp_description_t description
+                  , gaspi_group_t* const new_group
+                  , const gaspi_timeout_t timeout_ms );
+
+/** whether the rank waits as a spare
+ *
+ * \param gpi_cp_description_t:
+ *             description of the checkpoint memory layout
+ * \return true for a spare that was not recruited by gpi_cp_recover
+ */
+    bool
+    gpi_cp_get_state_spare( const gpi_cp_description_t description );
+
+
 /**
  * Utility functions.
  * 
@@ -0,0 +1,479 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp.hpp
+ *
+ * @brief  The C++ interface: RAII checkpoints of typed regions.
+ *
+ * Header only, over gpi_cp.h; needs C++20 (std::span). The policy and
+ * the transfer strategy are template parameters, their calls are
+ * inline forwarders to the C functions.
+ */
+
+#ifndef _GPI_CP_HPP_
+#define _GPI_CP_HPP_
+
+#include <gpi_cp.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace gpi_cp
+{
+
+/**
+ * Error of a constructor, with the return value of the C function.
+ *
+ */
+  class error : public std::runtime_error
+  {
+  public:
+    explicit error (gaspi_return_t code)
+      : std::runtime_error (gaspi_error_str (code))
+      , _code (code)
+    {}
+
+    gaspi_return_t code () const noexcept { return _code; }
+
+  private:
+    gaspi_return_t _code;
+  };
+
+/**
+ * Communication policies.
+ *
+ */
+  /* simple ring communication */
+  struct ring
+  {
+    static constexpr gpi_cp_policy_t value = GPI_CP_POLICY_RING;
+
+    static gaspi_return_t configure (gpi_cp_description_t) noexcept
+    {
+      return GASPI_SUCCESS;
+    }
+  };
+
+  /* one copy, split over the next Stripes ranks */
+  template <gaspi_number_t Stripes = 2>
+  struct striped
+  {
+    static_assert (Stripes >= 1 && Stripes <= 16, "1 to GPI_CP_STRIPES_MAX (16) stripes");
+
+    static constexpr gpi_cp_policy_t value = GPI_CP_POLICY_STRIPED;
+
+    static gaspi_return_t configure (gpi_cp_description_t description) noexcept
+    {
+      return gpi_cp_set_stripes (description, Stripes);
+    }
+  };
+
+/**
+ * Transfer strategies: where the region lives and how a snapshot of
+ * it gets to the receiver.
+ *
+ */
+  /* the region is the checkpointed data in the segment, sent as it is */
+  struct in_place
+  {
+    static constexpr bool copies = false;
+
+    template <class T>
+    static gaspi_return_t configure (gpi_cp_description_t) noexcept
+    {
+      return GASPI_SUCCESS;
+    }
+
+    static gaspi_return_t start ( gpi_cp_description_t description
+                                , const void*
+                                , gaspi_size_t
+                                , gaspi_timeout_t timeout_ms
+                                ) noexcept
+    {
+      return gpi_cp_start (description, timeout_ms);
+    }
+  };
+
+  /* the region is data of the application, copied into the segment by
+     Threads threads while it is sent (gpi_cp_snapshot_copy) */
+  template <gaspi_number_t Threads = 1>
+  struct copy
+  {
+    static_assert (Threads >= 1, "at least one copy thread");
+
+    static constexpr bool copies = true;
+
+    template <class T>
+    static gaspi_return_t configure (gpi_cp_description_t description) noexcept
+    {
+      return gpi_cp_set_copy_threads (description, Threads);
+    }
+
+    static gaspi_return_t start ( gpi_cp_description_t description
+                                , const void* data
+                                , gaspi_size_t size
+                                , gaspi_timeout_t timeout_ms
+                                ) noexcept
+    {
+      return gpi_cp_snapshot_copy (description, data, size, true, timeout_ms);
+    }
+  };
+
+  /* in place, compressed with the element size of the region as the
+     shuffle (gpi_cp_set_compression); ring policy only */
+  struct compressed : in_place
+  {
+    template <class T>
+    static gaspi_return_t configure (gpi_cp_description_t description) noexcept
+    {
+      return gpi_cp_set_compression (description, sizeof (T), 0);
+    }
+  };
+
+  /* in place, as deltas to the previous snapshot (gpi_cp_set_delta);
+     ring policy only */
+  struct delta : in_place
+  {
+    template <class T>
+    static gaspi_return_t configure (gpi_cp_description_t description) noexcept
+    {
+      return gpi_cp_set_delta (description, sizeof (T));
+    }
+  };
+
+/**
+ * Tag of the constructor of joiners: gpi_cp_restore instead of
+ * gpi_cp_init.
+ *
+ */
+  struct join_t
+  {
+    explicit join_t () = default;
+  };
+
+  inline constexpr join_t join {};
+
+/**
+ * No configuration beyond policy and transfer strategy.
+ *
+ */
+  struct no_setup
+  {
+    gaspi_return_t operator() (gpi_cp_description_t) const noexcept
+    {
+      return GASPI_SUCCESS;
+    }
+  };
+
+/** the count elements of type T at offset in a segment, a region for
+ *  in-place strategies
+ *
+ * \throw error if the segment does not exist
+ */
+  template <class T>
+  std::span<T>
+  segment_span ( gaspi_segment_id_t segment_id
+               , gaspi_offset_t offset
+               , std::size_t count
+               )
+  {
+    gaspi_pointer_t pointer;
+    gaspi_return_t const ret = gaspi_segment_ptr (segment_id, &pointer);
+
+    if (ret != GASPI_SUCCESS)
+      throw error (ret);
+
+    return std::span<T> (reinterpret_cast<T*> (static_cast<char*> (pointer) + offset), count);
+  }
+
+/**
+ * A checkpointed region, e.g. checkpoint<std::span<double>>.
+ *
+ * Owns its description: the constructor initializes it (gpi_cp_init,
+ * or gpi_cp_restore for joiners), finalize (collective) finalizes it.
+ * The destructor runs no collective, so that an exception on a single
+ * rank does not block it forever: it only frees the description, and
+ * a build without NDEBUG reports a checkpoint that was not finalized
+ * or released. Move only. With an in-place strategy the region must be the data at
+ * offset in the segment (segment_span), with copy it is memory of the
+ * application and the segment needs room for it at offset; copy does
+ * not go with lazy restore, the region is filled in right after the
+ * restore.
+ *
+ */
+  template < class Region
+           , class Policy = ring
+           , class Transfer = in_place
+           >
+  class checkpoint
+  {
+  public:
+    using region_type = Region;
+    using element_type = typename Region::element_type;
+    using policy_type = Policy;
+    using transfer_type = Transfer;
+
+    static_assert ( std::is_trivially_copyable_v<element_type>
+                  && !std::is_const_v<element_type>
+                  , "checkpointed elements are restored as bytes"
+                  );
+
+    /** gpi_cp_init, collective on group
+     *
+     * \param setup:
+     *             called with the description before gpi_cp_init, for
+     *             further configuration (e.g. gpi_cp_set_pipelined)
+     * \throw error in case of error
+     */
+    template <class Setup = no_setup>
+    checkpoint ( Region data
+               , gaspi_segment_id_t segment_id
+               , gaspi_offset_t offset
+               , gaspi_queue_id_t queue
+               , gaspi_group_t group
+               , gaspi_timeout_t timeout_ms = GASPI_BLOCK
+               , Setup setup = Setup {}
+               )
+      : checkpoint (data, segment_id, offset, queue)
+    {
+      construct (&gpi_cp_init, group, timeout_ms, setup);
+    }
+
+    /** gpi_cp_restore of a joiner, collective on new_group; copies the
+     *  restored data into the region
+     *
+     * \throw error in case of error
+     */
+    template <class Setup = no_setup>
+    checkpoint ( join_t
+               , Region data
+               , gaspi_segment_id_t segment_id
+               , gaspi_offset_t offset
+               , gaspi_queue_id_t queue
+               , gaspi_group_t new_group
+               , gaspi_timeout_t timeout_ms = GASPI_BLOCK
+               , Setup setup = Setup {}
+               )
+      : checkpoint (data, segment_id, offset, queue)
+    {
+      construct (&gpi_cp_restore, new_group, timeout_ms, setup);
+      copy_out ();
+    }
+
+    checkpoint (checkpoint&& other) noexcept
+      : _description (std::exchange (other._description, nullptr))
+      , _data (other._data)
+      , _segment_id (other._segment_id)
+      , _offset (other._offset)
+      , _queue (other._queue)
+    {}
+
+    checkpoint&
+    operator= (checkpoint&& other) noexcept
+    {
+      if (this != &other)
+        {
+          destroy ();
+
+          _description = std::exchange (other._description, nullptr);
+          _data = other._data;
+          _segment_id = other._segment_id;
+          _offset = other._offset;
+          _queue = other._queue;
+        }
+
+      return *this;
+    }
+
+    checkpoint (const checkpoint&) = delete;
+    checkpoint& operator= (const checkpoint&) = delete;
+
+    ~checkpoint () { destroy (); }
+
+    /** gpi_cp_start (gpi_cp_snapshot_copy with copy) */
+    [[nodiscard]] gaspi_return_t
+    start (gaspi_timeout_t timeout_ms = GASPI_BLOCK) noexcept
+    {
+      return Transfer::start (_description, _data.data (), _data.size_bytes (), timeout_ms);
+    }
+
+    /** gpi_cp_commit */
+    [[nodiscard]] gaspi_return_t
+    commit (gaspi_timeout_t timeout_ms = GASPI_BLOCK) noexcept
+    {
+      return gpi_cp_commit (_description, timeout_ms);
+    }
+
+    /** gpi_cp_restore of a survivor, collective on new_group; the
+     *  region stays as it is */
+    [[nodiscard]] gaspi_return_t
+    restore (gaspi_group_t new_group, gaspi_timeout_t timeout_ms = GASPI_BLOCK) noexcept
+    {
+      return gpi_cp_restore ( _segment_id, _offset, _data.size_bytes (), _queue
+                            , Policy::value, new_group, _description, timeout_ms
+                            );
+    }
+
+    /** gpi_cp_finalize, collective; the destructor does nothing then */
+    [[nodiscard]] gaspi_return_t
+    finalize (gaspi_timeout_t timeout_ms = GASPI_BLOCK) noexcept
+    {
+      gaspi_return_t const ret = gpi_cp_finalize (_description, timeout_ms);
+
+      std::free (std::exchange (_description, nullptr));
+
+      return ret;
+    }
+
+    /** give up the description without gpi_cp_finalize (e.g. of a
+     *  failed rank); the caller frees it */
+    [[nodiscard]] gpi_cp_description_t
+    release () noexcept
+    {
+      return std::exchange (_description, nullptr);
+    }
+
+    Region data () const noexcept { return _data; }
+
+    /** the description, for the rest of the C interface */
+    gpi_cp_description_t get () const noexcept { return _description; }
+
+    explicit operator bool () const noexcept { return _description != nullptr; }
+
+  private:
+    using init_function_t = gaspi_return_t (*)
+      ( gaspi_segment_id_t, gaspi_offset_t, gaspi_size_t, gaspi_queue_id_t
+      , gpi_cp_policy_t, gaspi_group_t, gpi_cp_description_t, gaspi_timeout_t
+      );
+
+    checkpoint ( Region data
+               , gaspi_segment_id_t segment_id
+               , gaspi_offset_t offset
+               , gaspi_queue_id_t queue
+               )
+      : _description (GPI_CP_DESCRIPTION_INITIALIZER ())
+      , _data (data)
+      , _segment_id (segment_id)
+      , _offset (offset)
+      , _queue (queue)
+    {
+      if (_description == nullptr)
+        throw std::bad_alloc ();
+    }
+
+    template <class Setup>
+    void
+    construct ( init_function_t init
+              , gaspi_group_t group
+              , gaspi_timeout_t timeout_ms
+              , Setup& setup
+              )
+    {
+      gaspi_return_t ret = check_region ();
+
+      if (ret == GASPI_SUCCESS)
+        ret = Policy::configure (_description);
+      if (ret == GASPI_SUCCESS)
+        ret = Transfer::template configure<element_type> (_description);
+      if (ret == GASPI_SUCCESS)
+        ret = setup (_description);
+      if (ret == GASPI_SUCCESS)
+        ret = init ( _segment_id, _offset, _data.size_bytes (), _queue
+                   , Policy::value, group, _description, timeout_ms
+                   );
+
+      // not initialized, nothing to finalize
+      if (ret != GASPI_SUCCESS)
+        {
+          std::free (std::exchange (_description, nullptr));
+          throw error (ret);
+        }
+    }
+
+    // in place: the region is the data in the segment
+    gaspi_return_t
+    check_region () const noexcept
+    {
+      if constexpr (Transfer::copies)
+        {
+          return GASPI_SUCCESS;
+        }
+      else
+        {
+          gaspi_pointer_t pointer;
+          gaspi_return_t const ret = gaspi_segment_ptr (_segment_id, &pointer);
+
+          if (ret != GASPI_SUCCESS)
+            return ret;
+
+          return (static_cast<const void*> (_data.data ())
+                  == static_cast<char*> (pointer) + _offset)
+            ? GASPI_SUCCESS : GASPI_ERROR;
+        }
+    }
+
+    // copy: the restored data into the region
+    void
+    copy_out () noexcept
+    {
+      if constexpr (Transfer::copies)
+        {
+          gaspi_pointer_t pointer;
+
+          if (gaspi_segment_ptr (_segment_id, &pointer) == GASPI_SUCCESS)
+            std::memcpy ( _data.data ()
+                        , static_cast<char*> (pointer) + _offset
+                        , _data.size_bytes ()
+                        );
+        }
+    }
+
+    // no gpi_cp_finalize, it is collective
+    void
+    destroy () noexcept
+    {
+      if (_description != nullptr)
+        {
+#ifndef NDEBUG
+          std::fprintf ( stderr
+                       , "gpi_cp::checkpoint destroyed without finalize or release\n"
+                       );
+#endif
+          std::free (std::exchange (_description, nullptr));
+        }
+    }
+
+    gpi_cp_description_t _description;
+    Region _data;
+    gaspi_segment_id_t _segment_id;
+    gaspi_offset_t _offset;
+    gaspi_queue_id_t _queue;
+  };
+
+} // namespace gpi_cp
+
+#endif //_GPI_CP_HPP_
@@ -0,0 +1,349 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_async.hpp
+ *
+ * @brief  The C++ interface: checkpoints as C++20 coroutines.
+ *
+ * co_await on gpi_cp::async_checkpoint::start and ::commit instead of
+ * blocking calls. A commit is called with GASPI_TEST until it no
+ * longer times out: the suspended coroutines are resumed by a
+ * gpi_cp::progress_engine that the runtime polls between its tasks,
+ * so no thread waits for the barrier of gpi_cp_commit. Some waits
+ * remain, see start and commit.
+ */
+
+#ifndef _GPI_CP_ASYNC_HPP_
+#define _GPI_CP_ASYNC_HPP_
+
+#include <gpi_cp.hpp>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace gpi_cp
+{
+
+/**
+ * A split-phase call in flight, completed when it no longer returns
+ * GASPI_TIMEOUT.
+ *
+ */
+  class operation_base
+  {
+  public:
+    /** call again with GASPI_TEST unless complete
+     *
+     * \return whether the call is complete
+     */
+    virtual bool test () noexcept = 0;
+
+    /** GASPI_TIMEOUT until complete, then the result of the call */
+    gaspi_return_t result () const noexcept { return _result; }
+
+  protected:
+    ~operation_base () = default;
+
+    gaspi_return_t _result = GASPI_TIMEOUT;
+  };
+
+/**
+ * Resumes the coroutines waiting for operations, from the thread that
+ * polls it; not thread safe.
+ *
+ * Operations are tested in the order they were awaited. Commits are
+ * collective: of the checkpoints of a group only one may commit at a
+ * time, as with the blocking calls.
+ *
+ */
+  class progress_engine
+  {
+  public:
+    progress_engine () = default;
+    progress_engine (const progress_engine&) = delete;
+    progress_engine& operator= (const progress_engine&) = delete;
+
+    /** test every waiting operation once and resume the coroutines of
+     *  the complete ones
+     *
+     * \return the number of operations still waiting
+     */
+    std::size_t
+    poll ()
+    {
+      std::vector<waiting_t> waiting;
+      waiting.swap (_waiting);
+
+      for (waiting_t const& w : waiting)
+        {
+          if (w.first->test ())
+            _complete.push_back (w);
+          else
+            _waiting.push_back (w);
+        }
+
+      // they may wait for further operations, or destroy tasks that
+      // are about to be resumed (withdraw)
+      for (std::size_t i = 0; i < _complete.size (); ++i)
+        {
+          if (_complete[i].second)
+            _complete[i].second.resume ();
+        }
+
+      _complete.clear ();
+
+      return _waiting.size ();
+    }
+
+    /** poll until no operation is waiting */
+    void
+    run ()
+    {
+      while (poll () > 0)
+        ;
+    }
+
+    bool empty () const noexcept { return _waiting.empty (); }
+
+    /** resume handle once operation is complete */
+    void
+    post (operation_base* operation, std::coroutine_handle<> handle)
+    {
+      _waiting.emplace_back (operation, handle);
+    }
+
+    /** forget operation, its coroutine is destroyed */
+    void
+    withdraw (operation_base* operation) noexcept
+    {
+      std::erase_if (_waiting, [operation] (waiting_t const& w)
+                               {
+                                 return w.first == operation;
+                               });
+
+      for (waiting_t& w : _complete)
+        {
+          if (w.first == operation)
+            w.second = nullptr;
+        }
+    }
+
+  private:
+    using waiting_t = std::pair<operation_base*, std::coroutine_handle<>>;
+
+    std::vector<waiting_t> _waiting;
+    std::vector<waiting_t> _complete; // being resumed by poll
+  };
+
+/**
+ * The operation of Call, a callable taking the timeout. Awaitable:
+ * co_await returns the result, the coroutine is suspended (and
+ * resumed by the engine) only if the first call times out. Without a
+ * coroutine, test () until it is complete. If the coroutine is
+ * destroyed while suspended, the operation is withdrawn from the
+ * engine.
+ *
+ */
+  template <class Call>
+  class operation final : public operation_base
+  {
+  public:
+    operation (progress_engine& engine, Call call)
+      : _engine (&engine)
+      , _call (std::move (call))
+    {}
+
+    ~operation ()
+    {
+      if (_posted)
+        _engine->withdraw (this);
+    }
+
+    bool
+    test () noexcept override
+    {
+      if (_result == GASPI_TIMEOUT)
+        _result = _call (GASPI_TEST);
+
+      return _result != GASPI_TIMEOUT;
+    }
+
+    bool await_ready () noexcept { return test (); }
+
+    void
+    await_suspend (std::coroutine_handle<> handle)
+    {
+      _engine->post (this, handle);
+      _posted = true;
+    }
+
+    gaspi_return_t
+    await_resume () noexcept
+    {
+      _posted = false;
+      return _result;
+    }
+
+  private:
+    progress_engine* _engine;
+    Call _call;
+    bool _posted = false; // waiting in the engine
+  };
+
+/**
+ * A checkpoint (gpi_cp::checkpoint) with awaitable start and commit.
+ *
+ * Owns the checkpoint, move only like it. The operations refer to it,
+ * they must be complete before it is moved or destroyed.
+ *
+ */
+  template <class Checkpoint>
+  class async_checkpoint
+  {
+  public:
+    async_checkpoint (Checkpoint&& checkpoint, progress_engine& engine)
+      : _checkpoint (std::move (checkpoint))
+      , _engine (&engine)
+    {}
+
+    /** start checkpointing
+     *
+     * complete at once: calls gpi_cp_start with GASPI_BLOCK, which may
+     * not be repeated after a timeout. It posts the writes and blocks
+     * the task until there is room in the queue (and a lazy restore
+     * is complete).
+     */
+    auto
+    start ()
+    {
+      return make_operation ([this] (gaspi_timeout_t)
+                             {
+                               return _checkpoint.start (GASPI_BLOCK);
+                             });
+    }
+
+    /** commit, with GASPI_TEST until complete
+     *
+     * every retry still waits without a timeout for the background
+     * writer of persistent copies and, with checksums, the verifier
+     * of the last snapshot: with those a task can block in it
+     */
+    auto
+    commit ()
+    {
+      return make_operation ([this] (gaspi_timeout_t timeout_ms)
+                             {
+                               return _checkpoint.commit (timeout_ms);
+                             });
+    }
+
+    Checkpoint& checkpoint () noexcept { return _checkpoint; }
+    const Checkpoint& checkpoint () const noexcept { return _checkpoint; }
+
+  private:
+    template <class Call>
+    operation<Call>
+    make_operation (Call call)
+    {
+      return operation<Call> (*_engine, std::move (call));
+    }
+
+    Checkpoint _checkpoint;
+    progress_engine* _engine;
+  };
+
+/**
+ * A coroutine that returns a gaspi_return_t (co_return), e.g. the
+ * checkpointing of a time step. It runs at once up to its first
+ * suspension; the destructor destroys it, complete or not (the
+ * operation it waits for is withdrawn from the engine).
+ *
+ */
+  class task
+  {
+  public:
+    struct promise_type
+    {
+      gaspi_return_t result = GASPI_TIMEOUT;
+
+      task
+      get_return_object () noexcept
+      {
+        return task (std::coroutine_handle<promise_type>::from_promise (*this));
+      }
+
+      std::suspend_never initial_suspend () noexcept { return {}; }
+      std::suspend_always final_suspend () noexcept { return {}; }
+
+      void return_value (gaspi_return_t value) noexcept { result = value; }
+
+      void unhandled_exception () noexcept { std::terminate (); }
+    };
+
+    task (task&& other) noexcept
+      : _handle (std::exchange (other._handle, nullptr))
+    {}
+
+    task& operator= (task&& other) noexcept
+    {
+      if (this != &other)
+        {
+          if (_handle)
+            _handle.destroy ();
+
+          _handle = std::exchange (other._handle, nullptr);
+        }
+
+      return *this;
+    }
+
+    task (const task&) = delete;
+    task& operator= (const task&) = delete;
+
+    ~task ()
+    {
+      if (_handle)
+        _handle.destroy ();
+    }
+
+    bool done () const noexcept { return !_handle || _handle.done (); }
+
+    /** GASPI_TIMEOUT until done */
+    gaspi_return_t
+    result () const noexcept
+    {
+      return (_handle && _handle.done ()) ? _handle.promise ().result : GASPI_TIMEOUT;
+    }
+
+  private:
+    explicit task (std::coroutine_handle<promise_type> handle) noexcept
+      : _handle (handle)
+    {}
+
+    std::coroutine_handle<promise_type> _handle;
+  };
+
+} // namespace gpi_cp
+
+#endif //_GPI_CP_ASYNC_HPP_
@@ -26,6 +26,15 @@ along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
 #include <GASPI.h>
 #include <gpi_cp.h>
 
+#include "gpi_cp_arena.h"
+#include "gpi_cp_checksum.h"
+#include "gpi_cp_compress.h"
+#include "gpi_cp_copy.h"
+#include "gpi_cp_delta.h"
+#include "gpi_cp_io.h"
+#include "gpi_cp_lazy.h"
+#include "gpi_cp_registry.h"
+
 #define CP_STATS 1
 
 #ifdef CP_STATS
@@ -46,6 +55,7 @@ along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 #define MAX(a,b) (((a)>(b))?(a):(b))
+#define MIN(a,b) (((a)<(b))?(a):(b))
 
 #define GASPI_SUCCESS_OR_RETURN(f...)                          \
   do                                                           \
@@ -69,6 +79,16 @@ along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
        }                                                       \
     } while (0)
 
+#define GPI_CP_STRIPES_MAX (16)
+
+/* waits of the failure detector check the state of the ranks that
+   often */
+#define GPI_CP_HEARTBEAT_MS (100)
+
+/* notification values of the recruitment of a spare */
+#define GPI_CP_RECRUITED (1)
+#define GPI_CP_RELEASED (2)
+
 struct gpi_cp_description
 {
   gaspi_offset_t offset;
@@ -76,17 +96,124 @@ struct gpi_cp_description
   gaspi_segment_id_t segment_id_local_client_source;
   gaspi_queue_id_t queue;
   gaspi_group_t group;
+  gpi_cp_policy_t policy;
 
-  gaspi_rank_t sender;
+  // stripe j of our data goes to receivers[j], senders[j] sends us its
+  // stripe j; the ring has a single stripe
+  gaspi_number_t stripes; // requested for the striped policy
+  gaspi_number_t number_of_stripes;
+  gaspi_size_t stripe_size;
+
+  gaspi_rank_t senders[GPI_CP_STRIPES_MAX];
   gaspi_segment_id_t segment_id_local_for_sender;
+  gaspi_number_t stripes_received; // in the current commit
+
+  gaspi_rank_t receivers[GPI_CP_STRIPES_MAX];
+  gaspi_segment_id_t segment_ids_remote_on_receivers[GPI_CP_STRIPES_MAX];
+
+  // neighbourhood commit: receivers confirm our snapshot on our mirror,
+  // we confirm theirs on the mirrors of the senders
+  gaspi_number_t agreement_interval; // 0: commit with a barrier
+  gaspi_segment_id_t segment_ids_remote_on_senders[GPI_CP_STRIPES_MAX];
+  gaspi_number_t acks_received; // in the current commit
+  bool agreement_in_progress;
+  unsigned long agreement_epoch; // of the last agreement started
+  unsigned long agreement_contribution; // buffers of the allreduce
+  unsigned long agreement_result;
+  unsigned long global_epoch; // committed on all ranks
+
+  // ring order of the group, a spare takes the place of a failed
+  // member in it
+  gaspi_rank_t* members;
+  gaspi_number_t number_of_members;
 
-  gaspi_rank_t receiver;
-  gaspi_segment_id_t segment_id_remote_on_receiver;
+  // spare pool: spares wait in gpi_cp_recover until they replace failed
+  // members; the mirrors of the pool share their segment id
+  bool spare_pool;
+  gaspi_group_t spare_group;
+  gaspi_rank_t* spares; // the unused ones from spares_used on
+  gaspi_number_t number_of_spares;
+  gaspi_number_t spares_used;
+  bool spare; // waiting in the pool
 
-  gaspi_offset_t active_snapshot; // toggles between 0 and size
+  // shadows: spare i of the pool keeps a copy of the checkpoints of
+  // the members in the i-th block of shadow_capacity ring positions
+  bool shadows;
+  gaspi_rank_t* shadow_spares; // the pool in rank order, not reordered
+  gaspi_number_t shadow_capacity;
+
+  gaspi_number_t number_of_snapshots; // 2, or 3 when pipelined
+  gaspi_offset_t active_snapshot; // cycles through 0, size, ...
+  gaspi_offset_t committed_snapshot; // last committed slot, the newest
+                                     // complete one with the
+                                     // neighbourhood commit
+  gaspi_offset_t pending_snapshot; // locally complete, barrier outstanding
+  gaspi_offset_t source_snapshot; // joiner: our slot on the receiver
   bool state_in_progress;
+  bool state_commit_pending;
   bool state_initialized;
 
+  char* persistent_path; // NULL: in-memory only
+  gpi_cp_drain_t* drain;
+  char* mirror_path; // NULL: anonymous memory
+  gpi_cp_mirror_t mirror;
+  bool checksums;
+  gpi_cp_verifier_t* verifier;
+  bool pending_corrupt; // the check of the pending snapshot failed here
+  bool lazy_restore; // the region is not pinned (on-demand paging)
+  gaspi_queue_id_t lazy_queue; // of the fetching thread
+  gpi_cp_lazy_t* lazy; // joiner: restore still running
+  gaspi_segment_id_t segment_id_staging;
+  gaspi_number_t restore_queues; // 0: all queues
+
+  // compression: our snapshots go through a staging segment, byte
+  // shuffled by elements of compression bytes and LZ compressed, into
+  // slots of compression_capacity bytes
+  gaspi_size_t compression; // 0: none
+  gaspi_size_t compression_capacity; // 0: enough for any data
+  // lossy compression: float or double elements lose that many
+  // mantissa bits, rounded, before the shuffle
+  unsigned int lossy_dropped_bits;
+  gaspi_segment_id_t segment_id_compressed;
+  gaspi_size_t compressed_buffer_size; // 0: not allocated yet
+  void* compression_scratch;
+  gaspi_size_t compressed_size; // of our last snapshot
+
+  // delta: we send the XOR with our previous snapshot, compressed
+  // like above; receivers apply it onto the slot of base_epoch
+  gaspi_size_t delta; // element size of the shuffle, 0: none
+  unsigned long delta_base_epoch; // 0: send the data as it is
+  void* delta_previous; // what we sent in delta_base_epoch
+  uint32_t* delta_table;
+
+  // block elimination: our blocks of block_size bytes that are zero,
+  // or with deduplicate equal to the block of our receiver at the same
+  // offset, are not sent; the receiver fills them in
+  gaspi_size_t block_size; // 0: off
+  bool deduplicate;
+  unsigned char* slot_maps; // per slot the map of the blocks in it
+  gaspi_size_t zero_bytes_saved;
+  gaspi_size_t duplicate_bytes_saved;
+
+  // local copies: every snapshot is kept here as well, in the copy of
+  // its epoch modulo number_of_snapshots, for gpi_cp_rollback
+  bool local_copy;
+  void* local_copies; // NULL: not allocated yet
+  unsigned long local_copy_epochs[3]; // by copy, 0: none
+
+  // gpi_cp_snapshot_copy: a team of copy_threads threads copies the
+  // data in, the chunks are sent as soon as they are copied
+  gaspi_number_t copy_threads;
+  gpi_cp_copy_team_t* copy_team; // NULL: not started yet
+
+  // named variables: gpi_cp_checkpoint_variables packs the changed
+  // ones into our data and sends those a slot does not hold yet
+  gpi_cp_registry_t registry;
+  unsigned long variable_slot_epochs[3]; // by slot, 0: send them all
+  gaspi_size_t packed_size; // by the last gpi_cp_checkpoint_variables
+
+  unsigned long epoch; // number of globally committed snapshots
+
 #ifdef CP_STATS
   /* Timings for benchmarking */
   struct timeval in_init;
@@ -104,10 +231,10 @@ void gpi_cp_description_print(gpi_cp_description_t description)
               description->segment_id_local_client_source,
               description->queue,
               description->group,
-              description->sender,
+              description->senders[0],
               description->segment_id_local_for_sender,
-              description->receiver,
-              description->segment_id_remote_on_receiver,
+              description->receivers[0],
+              description->segment_ids_remote_on_receivers[0],
               description->active_snapshot,
               description->size,
               description->state_in_progress,
@@ -119,8 +246,63 @@ gpi_cp_description_t GPI_CP_DESCRIPTION_INITIALIZER()
   gpi_cp_description_t description = malloc( sizeof ( struct gpi_cp_description));
   if (description != NULL)
     {
+      description->number_of_snapshots = 2;
+      description->stripes = 2;
+      description->number_of_stripes = 1;
+      description->stripes_received = 0;
       description->state_in_progress = false;
+      description->state_commit_pending = false;
       description->state_initialized = false;
+      description->persistent_path = NULL;
+      description->drain = NULL;
+      description->mirror_path = NULL;
+      description->mirror.data = NULL;
+      description->checksums = false;
+      description->verifier = NULL;
+      description->pending_corrupt = false;
+      description->lazy_restore = false;
+      description->lazy_queue = 0;
+      description->lazy = NULL;
+      description->restore_queues = 1;
+      description->epoch = 0;
+      description->agreement_interval = 0;
+      description->acks_received = 0;
+      description->agreement_in_progress = false;
+      description->agreement_epoch = 0;
+      description->global_epoch = 0;
+      description->members = NULL;
+      description->number_of_members = 0;
+      description->spare_pool = false;
+      description->spares = NULL;
+      description->number_of_spares = 0;
+      description->spares_used = 0;
+      description->spare = false;
+      description->shadows = false;
+      description->shadow_spares = NULL;
+      description->shadow_capacity = 0;
+      description->compression = 0;
+      description->compression_capacity = 0;
+      description->lossy_dropped_bits = 0;
+      description->compressed_buffer_size = 0;
+      description->compression_scratch = NULL;
+      description->compressed_size = 0;
+      description->delta = 0;
+      description->delta_base_epoch = 0;
+      description->delta_previous = NULL;
+      description->delta_table = NULL;
+      description->block_size = 0;
+      description->deduplicate = false;
+      description->slot_maps = NULL;
+      description->zero_bytes_saved = 0;
+      description->duplicate_bytes_saved = 0;
+      description->local_copy = false;
+      description->local_copies = NULL;
+      memset (description->local_copy_epochs, 0, sizeof (description->local_copy_epochs));
+      description->copy_threads = 1;
+      description->copy_team = NULL;
+      memset (&description->registry, 0, sizeof (description->registry));
+      memset (description->variable_slot_epochs, 0, sizeof (description->variable_slot_epochs));
+      description->packed_size = 0;
 #ifdef CP_STATS
       memset(&(description->in_init), 0, sizeof(description->in_init));
       memset(&(description->in_start), 0, sizeof(description->in_start));
@@ -206,10 +388,33 @@ gpi_cp_is_in_group ( gaspi_group_t group
   return false;
 }
 
+/* position of rank in the ring order of the members, number_of_members
+   if it is none */
+static gaspi_number_t
+gpi_cp_member_position ( const gaspi_rank_t* members
+                       , const gaspi_number_t number_of_members
+                       , const gaspi_rank_t rank
+                       )
+{
+  gaspi_number_t i;
+  for (i = 0; i < number_of_members; ++i)
+    {
+      if (members[i] == rank)
+        break;
+    }
+
+  return i;
+}
+
+/* the distance-th member before rank in the ring order of the members;
+   the ring only uses distance 1, the striped policy 1 to the number of
+   stripes */
 static gpi_cp_error_codes
 gpi_cp_sender ( gpi_cp_policy_t policy
-              , gaspi_group_t group
+              , const gaspi_rank_t* members
+              , const gaspi_number_t number_of_members
               , gaspi_rank_t rank
+              , gaspi_number_t distance
               , gaspi_rank_t * const sender
               )
 {
@@ -217,16 +422,16 @@ gpi_cp_sender ( gpi_cp_policy_t policy
   switch (policy)
     {
     case GPI_CP_POLICY_RING:
+    case GPI_CP_POLICY_STRIPED:
       {
-       gaspi_rank_t nProc;
-       if ( GASPI_SUCCESS == gaspi_proc_num( &nProc) )
-         {
-           *sender = (rank + nProc - 1) % nProc;
+       gaspi_number_t const position =
+         gpi_cp_member_position (members, number_of_members, rank);
 
-           while ( !gpi_cp_is_in_group (group, *sender) )
-             {
-              *sender = (*sender + nProc - 1) % nProc;
-             }
+       if (position < number_of_members)
+         {
+           *sender = members[ (position + number_of_members - distance % number_of_members)
+                            % number_of_members
+                            ];
 
            DEBUG_PRINT ("Setting sender %i from rank %i\n", *sender, rank);
          }
@@ -246,10 +451,13 @@ gpi_cp_sender ( gpi_cp_policy_t policy
   return cp_ret;
 }
 
+/* the distance-th member after rank */
 static gpi_cp_error_codes
 gpi_cp_receiver ( gpi_cp_policy_t policy
-                , gaspi_group_t group
+                , const gaspi_rank_t* members
+                , const gaspi_number_t number_of_members
                 , gaspi_rank_t rank
+                , gaspi_number_t distance
                 , gaspi_rank_t * const receiver
                 )
 {
@@ -257,17 +465,16 @@ gpi_cp_receiver ( gpi_cp_policy_t policy
   switch (policy)
     {
     case GPI_CP_POLICY_RING:
+    case GPI_CP_POLICY_STRIPED:
       {
-       gaspi_rank_t nProc;
-       if ( GASPI_SUCCESS == gaspi_proc_num(&nProc) )
+       gaspi_number_t const position =
+         gpi_cp_member_position (members, number_of_members, rank);
+
+       if (position < number_of_members)
          {
-           *receiver = (rank + 1) % nProc;
+           *receiver = members[(position + distance) % number_of_members];
 
-           while ( !gpi_cp_is_in_group (group, *receiver) )
-             {
-              *receiver = (*receiver + 1) % nProc;
-             }
-           DEBUG_PRINT ("Setting receiver %i from rank %i group size %i\n", *receiver, rank, nProc);
+           DEBUG_PRINT ("Setting receiver %i from rank %i group size %i\n", *receiver, rank, number_of_members);
          }
        else
          {
@@ -297,615 +504,6038 @@ gpi_cp_ptr ( gaspi_segment_id_t segment_id
   return NULL;
 }
 
-static void
-gpi_cp_tell_sender_about_the_local_segment_id ( gaspi_segment_id_t segment_id_local_for_sender
-                                              , gaspi_offset_t offset
-                                              , gaspi_rank_t sender
-                                              )
+static int
+gpi_cp_compare_ranks (const void* a, const void* b)
 {
-  gpi_cp_ptr (segment_id_local_for_sender, offset)[0] = segment_id_local_for_sender;
+  return (int) *(const gaspi_rank_t*) a - (int) *(const gaspi_rank_t*) b;
+}
 
-  /* We have to send in a non-blocking way => GASPI_TEST */
-  gaspi_return_t ret = gaspi_passive_send ( segment_id_local_for_sender
-                                       , offset
-                                       , sender
-                                       , sizeof (gaspi_segment_id_t)
-                                       , GASPI_TEST
-                                       );
+/* the members of group in rank order, the order of the ring */
+static gaspi_return_t
+gpi_cp_set_members ( gpi_cp_description_t description
+                   , const gaspi_group_t group
+                   )
+{
+  gaspi_number_t group_size;
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_size (group, &group_size));
+
+  gaspi_rank_t* const members = malloc (group_size * sizeof (gaspi_rank_t));
+
+  if (members == NULL)
+    return GASPI_ERROR;
+
+  gaspi_return_t const ret = gaspi_group_ranks (group, members);
 
-  if(ret != GASPI_TIMEOUT && ret != GASPI_SUCCESS)
+  if (ret != GASPI_SUCCESS)
     {
-      gaspi_printf("Failed to tell sender (error %s)\n", gaspi_error_str(ret));
+      free (members);
+      return ret;
     }
-}
 
-static void
-gpi_cp_make_sure_receiver_got_local_segment_id ( const gaspi_segment_id_t segment_id_local_for_sender
-                                               , const gaspi_offset_t offset
-                                               , const gaspi_rank_t sender
-                                               , const gaspi_timeout_t timeout_ms
-                                               )
-{
-  gpi_cp_ptr (segment_id_local_for_sender, offset)[0] = segment_id_local_for_sender;
+  qsort (members, group_size, sizeof (gaspi_rank_t), gpi_cp_compare_ranks);
 
-  gaspi_pointer_t pointer_segment;
-  if ( GASPI_SUCCESS != gaspi_segment_ptr (segment_id_local_for_sender, &pointer_segment))
-    return;
-  
-  if( GASPI_SUCCESS != (gaspi_passive_send ( segment_id_local_for_sender
-                                        , offset
-                                        , sender
-                                        , sizeof (gaspi_segment_id_t)
-                                        , timeout_ms
-                                        )
-                     ) )
-    return;
+  free (description->members);
+  description->members = members;
+  description->number_of_members = group_size;
+
+  return GASPI_SUCCESS;
 }
-  
-static gpi_cp_error_codes
-gpi_cp_receive_segment_id ( const gaspi_segment_id_t segment_id_local_for_sender
-                          , const gaspi_offset_t offset
-                          , const gaspi_rank_t expected_notifier
-                          , const gaspi_timeout_t timeout_ms
-                          , gaspi_segment_id_t * const segment_id_received
-                          )
+
+/* the notification ids the options take must exist, or the ids of the
+   snapshots, confirmations, heartbeats, views, recruitment and hashes
+   (gpi_cp_notification_id and the ids after it) would wrap around into
+   each other */
+static gaspi_return_t
+gpi_cp_check_notification_ids (const gpi_cp_description_t description)
 {
-  gpi_cp_error_codes cp_ret = GPI_CP_SUCCESS;
-  *segment_id_received = 33;  // Invalid value
-  gaspi_rank_t notifier;
-  if ( GASPI_SUCCESS  != gaspi_passive_receive ( segment_id_local_for_sender
-                                           , offset + sizeof (gaspi_segment_id_t)
-                                           , &notifier
-                                           , sizeof (gaspi_segment_id_t)
-                                           , timeout_ms
-                                           ) )
-  {
-    cp_ret = GPI_CP_ERROR_UNEXPECTED_SEGMENT_ID_SOURCE;
-    return cp_ret;
-  }
+  gaspi_rank_t nProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_num (&nProc));
+
+  gaspi_number_t notification_num;
+  GASPI_SUCCESS_OR_RETURN (gaspi_notification_num (&notification_num));
 
-  if (notifier != expected_notifier)
+  unsigned long const snapshots = (unsigned long) nProc * description->number_of_snapshots;
+  unsigned long needed = snapshots;
+  const char* option = "the snapshots";
+
+  if (description->agreement_interval > 0)
     {
-      gaspi_printf ("BUMMER: Got segment_id from unexpected source (%u %u)\n",  notifier, expected_notifier);
-      cp_ret = GPI_CP_ERROR_UNEXPECTED_SEGMENT_ID_SOURCE;
-      return cp_ret;
+      needed = 2 * snapshots;
+      option = "the neighbourhood commit";
+    }
+
+  if (description->spare_pool)
+    {
+      needed = 2 * snapshots + 3UL * nProc + 1;
+      option = "the spare pool";
     }
-  *segment_id_received = gpi_cp_ptr (segment_id_local_for_sender, offset)[1];
-  return cp_ret;
-}
 
+  if (description->block_size > 0)
+    {
+      needed = 2 * snapshots + 4UL * nProc + 1;
+      option = "block elimination";
+    }
 
-static void
-gpi_cp_allocate_and_register_local_segment ( gaspi_segment_id_t *segment_id_local_for_sender
-                                           , const gaspi_size_t size
-                                           , const gaspi_rank_t sender
-                                           , const gaspi_timeout_t timeout_ms
-                                           )
-{
-  gaspi_size_t const number_of_snapshots = 2;
+  unsigned long const available =
+    MIN ((unsigned long) notification_num, (unsigned long) (gaspi_notification_id_t) -1 + 1);
 
-  if ( GASPI_SUCCESS != gpi_cp_get_unused_segment_id (segment_id_local_for_sender) ) 
-    return;
-  
-  if ( GASPI_SUCCESS != gaspi_segment_alloc ( *segment_id_local_for_sender
-                                         , MAX ( number_of_snapshots * size, number_of_snapshots * (2 * sizeof (gaspi_segment_id_t)))
-                                         , GASPI_MEM_UNINITIALIZED
-                                         ) )
-    return;
-  
-  if ( GASPI_SUCCESS != gaspi_segment_register ( *segment_id_local_for_sender
-                                           , sender
-                                           , timeout_ms
-                                           ) )
-    return;
+  if (needed > available)
+    {
+      fprintf ( stderr
+              , "Not enough notification ids for %s with %u ranks: %lu needed, %lu available\n"
+              , option
+              , nProc
+              , needed
+              , available
+              );
+      return GASPI_ERROR;
+    }
 
-  return;
+  return GASPI_SUCCESS;
 }
-static inline double
-gpi_cp_timeval_to_ms(struct timeval t)
+
+/* two options that do not go together, see their setters */
+static gaspi_return_t
+gpi_cp_option_conflict (const char* option, const char* other)
 {
-  return (t.tv_sec * 1000.0) + ((t.tv_usec) / 1000.0);
-}
+  fprintf (stderr, "%s cannot be combined with %s\n", option, other);
 
+  return GASPI_ERROR;
+}
 
-gaspi_return_t
-gpi_cp_finalize ( const gpi_cp_description_t description
-                , const gaspi_timeout_t timeout_ms
-                )
+/* the stripes, and the senders and receivers of rank if it is a
+   member, see gpi_cp_sender */
+static gaspi_return_t
+gpi_cp_set_partners ( gpi_cp_description_t description
+                    , const gpi_cp_policy_t policy
+                    , const gaspi_rank_t rank
+                    )
 {
-  /*   if( !description->state_initialized) */
-  /*     return GASPI_ERROR; */
-
-  /*   if( description->state_in_progress) */
-  /*     return GASPI_ERROR; */
-  gaspi_rank_t iProc;
-  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  description->number_of_stripes = 1;
 
-  if(gpi_cp_is_in_group(description->group, iProc))
+  if (policy == GPI_CP_POLICY_STRIPED)
     {
-      GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_local_for_sender));
+      gaspi_number_t const group_size = description->number_of_members;
 
-#ifdef CP_STATS
-      double max_total[5] ={ 0.0f };
-      double total[5];
+      // every stripe needs a partner of its own
+      if ( description->stripes < 1
+         || description->stripes >= group_size
+         || description->stripes > GPI_CP_STRIPES_MAX
+         )
+        {
+          fprintf (stderr, "Cannot stripe over %u of %u ranks\n", description->stripes, group_size);
+          return GASPI_ERROR;
+        }
 
-      total[1] = gpi_cp_timeval_to_ms(description->in_start);
-      total[2] = gpi_cp_timeval_to_ms(description->in_init);
-      total[3] = gpi_cp_timeval_to_ms(description->in_commit);
-      total[4] = gpi_cp_timeval_to_ms(description->in_restore);
-      total[0] = total[1] + total[2] + total[3] + total[4];
-  
-      gaspi_printf("CP Stats (in ms): start %.4f init %.4f commit %.4f restore %.4f total %.4f\n",
-                 gpi_cp_timeval_to_ms(description->in_start),
-                 gpi_cp_timeval_to_ms(description->in_init),
-                 gpi_cp_timeval_to_ms(description->in_commit),
-                 gpi_cp_timeval_to_ms(description->in_restore),
-                 total[0]);
+      //! \todo the options below assume that a slot holds the whole
+      //! snapshot of a single sender: the files of persistent copies
+      //! and mirror files, the checksum next to the slot, the pages a
+      //! lazy restore reads from one mirror, the staging segment and
+      //! block map of compression, deltas and block elimination
+      const char* const striped = "The striped policy";
+      if (description->persistent_path != NULL)
+        return gpi_cp_option_conflict (striped, "persistent copies");
+      if (description->mirror_path != NULL)
+        return gpi_cp_option_conflict (striped, "mirror files");
+      if (description->checksums)
+        return gpi_cp_option_conflict (striped, "checksums");
+      if (description->lazy_restore)
+        return gpi_cp_option_conflict (striped, "the lazy restore");
+      if (description->compression > 0)
+        return gpi_cp_option_conflict (striped, "compression");
+      if (description->delta > 0)
+        return gpi_cp_option_conflict (striped, "deltas");
+      if (description->block_size > 0)
+        return gpi_cp_option_conflict (striped, "block elimination");
 
-      gaspi_allreduce(&total
-                    , &max_total
-                    , 5
-                    , GASPI_OP_MAX
-                    , GASPI_TYPE_DOUBLE
-                    , description->group
-                    , timeout_ms);
+      description->number_of_stripes = description->stripes;
+    }
 
-      gaspi_rank_t myrank;
-      GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&myrank));
-      if( 0 == myrank )
-       printf("Max CP times: total %.4f, start  %.4f init  %.4f commit  %.4f restore %.4f \n",
-              max_total[0],
-              max_total[1],
-              max_total[2],
-              max_total[3],
-              max_total[4]);
-#endif
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_check_notification_ids (description));
+
+  //! \todo persistent copies, mirror files, checksums, lazy restore
+  //! and shadows expect the data in the slot as it is, not compressed
+  if (description->compression > 0)
+    {
+      const char* const compression = "Compression";
+      if (description->persistent_path != NULL)
+        return gpi_cp_option_conflict (compression, "persistent copies");
+      if (description->mirror_path != NULL)
+        return gpi_cp_option_conflict (compression, "mirror files");
+      if (description->checksums)
+        return gpi_cp_option_conflict (compression, "checksums");
+      if (description->lazy_restore)
+        return gpi_cp_option_conflict (compression, "the lazy restore");
+      if (description->shadows)
+        return gpi_cp_option_conflict (compression, "spare shadows");
     }
-  return GASPI_SUCCESS;
-}
 
-gaspi_return_t
-gpi_cp_init ( const gaspi_segment_id_t segment_id_checkpoint
-            , const gaspi_offset_t offset
-            , const gaspi_size_t size
-            , const gaspi_queue_id_t queue
-            , const gpi_cp_policy_t policy
-            , const gaspi_group_t group
-            , gpi_cp_description_t description
-            , const gaspi_timeout_t timeout_ms
-            )
-{
-#ifdef CP_STATS
-  struct timeval tstart, tend;
-  gettimeofday(&tstart, NULL);
-#endif
+  // deltas are compressed already; the checksum would be of the
+  // delta, not of the data in the slot
+  //! \todo checksums of deltas
+  if (description->delta > 0 && description->compression > 0)
+    return gpi_cp_option_conflict ("Deltas", "compression");
+  if (description->delta > 0 && description->checksums)
+    return gpi_cp_option_conflict ("Deltas", "checksums");
 
-  description->offset = offset;
-  description->size = size;
-  description->segment_id_local_client_source = segment_id_checkpoint;
-  description->queue = queue;
-  description->group = group;
-  description->active_snapshot = 0;
-  
-  gaspi_rank_t iProc;
-  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  // checksums reject an epoch in the barrier of the commit: with the
+  // neighbourhood commit a receiver would reject an epoch its sender
+  // already confirmed, pipelined an epoch may be started on top of a
+  // rejected one
+  if (description->checksums && description->agreement_interval > 0)
+    return gpi_cp_option_conflict ("Checksums", "the neighbourhood commit");
+  if (description->checksums && description->number_of_snapshots > 2)
+    return gpi_cp_option_conflict ("Checksums", "pipelined checkpoints");
 
-  if(gpi_cp_is_in_group(description->group, iProc))
-    {
-      CP_SUCCESS_OR_RETURN( gpi_cp_sender (policy, group, iProc, &(description->sender)) );
-      CP_SUCCESS_OR_RETURN( gpi_cp_receiver (policy, group, iProc, &(description->receiver)) );
+  // compression and deltas have slots of their own (gpi_cp_slot_size)
+  // and share the staging segment with the block map and hashes
+  //! \todo zero blocks in compressed snapshots, checksums
+  if (description->block_size > 0 && description->compression > 0)
+    return gpi_cp_option_conflict ("Block elimination", "compression");
+  if (description->block_size > 0 && description->delta > 0)
+    return gpi_cp_option_conflict ("Block elimination", "deltas");
+  if (description->block_size > 0 && description->checksums)
+    return gpi_cp_option_conflict ("Block elimination", "checksums");
 
-      gpi_cp_allocate_and_register_local_segment
-       ( &description->segment_id_local_for_sender
-         , description->size
-         , description->sender
-         , timeout_ms
-        );
-      
-      gpi_cp_tell_sender_about_the_local_segment_id
-       ( description->segment_id_local_for_sender
-         , description->active_snapshot
-         , description->sender
-         );
+  description->stripe_size =
+    (description->size + description->number_of_stripes - 1) / description->number_of_stripes;
 
-      CP_SUCCESS_OR_RETURN( gpi_cp_receive_segment_id ( description->segment_id_local_for_sender
-                                                      , description->active_snapshot
-                                                      , description->receiver
-                                                      , timeout_ms
-                                                      , &(description->segment_id_remote_on_receiver))
-           );
+  // a spare gets its partners once it replaces a member
+  if ( gpi_cp_member_position (description->members, description->number_of_members, rank)
+     == description->number_of_members
+     )
+    return GASPI_SUCCESS;
 
-      gpi_cp_make_sure_receiver_got_local_segment_id
-       ( description->segment_id_local_for_sender
-         , description->active_snapshot
-         , description->sender
-         , timeout_ms
-         );
-       
-      description->state_initialized = true;
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      CP_SUCCESS_OR_RETURN( gpi_cp_sender ( policy
+                                          , description->members
+                                          , description->number_of_members
+                                          , rank
+                                          , j + 1
+                                          , &(description->senders[j])
+                                          )
+                          );
+      CP_SUCCESS_OR_RETURN( gpi_cp_receiver ( policy
+                                            , description->members
+                                            , description->number_of_members
+                                            , rank
+                                            , j + 1
+                                            , &(description->receivers[j])
+                                            )
+                          );
     }
-/*       description_print(description); */
-
-  //! \todo ensure there are at least nProc many notification ids available
-#ifdef CP_STATS
-  gettimeofday(&tend, NULL);
-  description->in_init.tv_usec += (tend.tv_usec - tstart.tv_usec);
-  description->in_init.tv_sec += (tend.tv_sec - tstart.tv_sec);
-#endif
 
   return GASPI_SUCCESS;
 }
 
+/* offset of stripe j within a slot and its length, the last stripe
+   may be shorter */
+static gaspi_offset_t
+gpi_cp_stripe_offset ( const gpi_cp_description_t description
+                     , const gaspi_number_t j
+                     )
+{
+  return j * description->stripe_size;
+}
 
-gaspi_return_t
-gpi_cp_start ( gpi_cp_description_t description
-             , const gaspi_timeout_t timeout_ms
-             )
+static gaspi_size_t
+gpi_cp_stripe_length ( const gpi_cp_description_t description
+                     , const gaspi_number_t j
+                     )
 {
-#ifdef CP_STATS
-  struct timeval tstart, tend;
-  gettimeofday(&tstart, NULL);
-#endif
+  gaspi_offset_t const begin = MIN (gpi_cp_stripe_offset (description, j), description->size);
+  gaspi_offset_t const end = MIN (begin + description->stripe_size, description->size);
 
-  gaspi_rank_t iProc;
-  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  return end - begin;
+}
 
-  if(gpi_cp_is_in_group(description->group, iProc))
-    {
-      if (description->state_in_progress)
-       {
-         return GASPI_ERROR; //! \todo specific error code
-       }
+/* with block elimination a slot holds the data and then the map of
+   its blocks, one byte each */
+#define GPI_CP_BLOCK_SENT (0)
+#define GPI_CP_BLOCK_ZERO (1)
+#define GPI_CP_BLOCK_DUPLICATE (2) /* of the block of the receiver */
 
-      description->state_in_progress = true;
+static gaspi_number_t
+gpi_cp_number_of_blocks (const gpi_cp_description_t description)
+{
+  return (description->size + description->block_size - 1) / description->block_size;
+}
 
-/*       description_print(description); */
-      DEBUG_PRINT("gpi_cp_start: gaspi_write_notify(%i, %i, %i, %i, %i, %i, %i, %i, %i)\n",
-                 description->segment_id_local_client_source , description->offset, description->receiver,
-                 description->segment_id_remote_on_receiver, description->active_snapshot, description->size,
-                 (gaspi_notification_id_t) iProc, iProc + 1,
-                 description->queue);
+static gaspi_size_t
+gpi_cp_block_map_size (const gpi_cp_description_t description)
+{
+  return (gpi_cp_number_of_blocks (description) + 7) & ~(gaspi_size_t) 7;
+}
 
-      gaspi_number_t queueSize, qmax;
-      GASPI_SUCCESS_OR_RETURN (gaspi_queue_size_max(&qmax));
-      gaspi_queue_size(description->queue, &queueSize);
-      if (queueSize > qmax - 24)
-       GASPI_SUCCESS_OR_RETURN (gaspi_wait(description->queue, timeout_ms));
-      
-      GASPI_SUCCESS_OR_RETURN
-       (gaspi_write_notify (description->segment_id_local_client_source // segment_id_local
-                          , description->offset // offset_local
-                          , description->receiver // rank
-                          , description->segment_id_remote_on_receiver
-                          , description->active_snapshot // offset_remote
-                          , description->size // size
-                          , (gaspi_notification_id_t) iProc // notification_id
-                          , (gaspi_notification_t) iProc+1 // notification_value
-                          , description->queue // queue
-                          , timeout_ms
-                          )
-        );
+/* a slot holds one stripe of every sender, i.e. as much as one rank
+   checkpoints */
+static gaspi_size_t
+gpi_cp_slot_size (const gpi_cp_description_t description)
+{
+  if (description->compression > 0)
+    {
+      gaspi_size_t const capacity = (description->compression_capacity > 0)
+        ? MAX ( description->compression_capacity
+              , gpi_cp_compress_table_size (description->size)
+              )
+        : gpi_cp_compress_bound (description->size);
+
+      return (capacity + 7) & ~(gaspi_size_t) 7;
     }
 
-#ifdef CP_STATS
-  gettimeofday(&tend, NULL);
-  description->in_start.tv_usec += (tend.tv_usec - tstart.tv_usec);
-  description->in_start.tv_sec += (tend.tv_sec - tstart.tv_sec);
-#endif
+  if (description->delta > 0)
+    return gpi_cp_delta_slot_size (description->size);
 
-  return GASPI_SUCCESS;
+  if (description->block_size > 0)
+    return ((description->size + 7) & ~(gaspi_size_t) 7) + gpi_cp_block_map_size (description);
+
+  return description->number_of_stripes * description->stripe_size;
 }
 
+/* layout of the mirror segment
 
-static gaspi_return_t
-gpi_cp_wait_for_notification_from ( const gaspi_segment_id_t segment_id_local_for_sender
-                                  , const gaspi_rank_t sender
-                                  , const gaspi_notification_t expected_value
-                                  , const gaspi_timeout_t timeout_ms
-                                  )
+   [snapshot slots][hashes of the blocks of the receiver][epochs, per
+   sender and slot][epochs read from the receivers][checksum records,
+   one per slot][outgoing record]
+
+   the epoch of a stripe is set once it arrived complete, 0 if none;
+   the hashes only exist with deduplication, the records only with
+   checksums
+*/
+static gaspi_offset_t
+gpi_cp_peer_hashes_offset (const gpi_cp_description_t description)
 {
-  gaspi_notification_id_t notifier;
-  GASPI_SUCCESS_OR_RETURN ( gaspi_notify_waitsome
-                      ( segment_id_local_for_sender
-                        , (gaspi_notification_id_t) sender 
-                        , (gaspi_number_t) 1
-                        , &notifier
-                        , timeout_ms
-                        )
-                      );
+  return MAX ( description->number_of_snapshots * gpi_cp_slot_size (description)
+             , description->number_of_snapshots * (2 * sizeof (gaspi_segment_id_t))
+             );
+}
 
-  if (notifier != sender)
-  {
-    fprintf (stderr, "Unexpected notification\n");
-    return GASPI_ERROR; //! \todo specific error code
-  }
-  
-  gaspi_notification_t value;
-  GASPI_SUCCESS_OR_RETURN( gaspi_notify_reset (segment_id_local_for_sender, notifier, &value) );
+static gaspi_offset_t
+gpi_cp_epochs_offset (const gpi_cp_description_t description)
+{
+  if (!description->deduplicate || description->block_size == 0)
+    return gpi_cp_peer_hashes_offset (description);
 
-  if (value != expected_value)
-  {
-    fprintf (stderr, "Wrong notification value: %i, %i \n", value, expected_value);
-    return GASPI_ERROR; //! \todo specific error code
-  }
+  return gpi_cp_peer_hashes_offset (description)
+    + gpi_cp_number_of_blocks (description) * sizeof (uint64_t);
+}
 
-  return GASPI_SUCCESS; //! \todo specific error code
+/* epoch of the stripe of sender j in snapshot */
+static gaspi_offset_t
+gpi_cp_epoch_offset ( const gpi_cp_description_t description
+                    , const gaspi_number_t j
+                    , const gaspi_offset_t snapshot
+                    )
+{
+  return gpi_cp_epochs_offset (description)
+    + ( j * description->number_of_snapshots
+      + snapshot / gpi_cp_slot_size (description)
+      ) * sizeof (unsigned long);
 }
 
-gaspi_return_t
-gpi_cp_commit ( gpi_cp_description_t description
-              , const gaspi_timeout_t timeout_ms )
+/* the epochs receiver j keeps for our stripe, one per slot */
+static gaspi_offset_t
+gpi_cp_peer_epochs_offset ( const gpi_cp_description_t description
+                          , const gaspi_number_t j
+                          )
 {
+  return gpi_cp_epoch_offset (description, description->number_of_stripes + j, 0);
+}
+
+static gaspi_offset_t
+gpi_cp_records_offset (const gpi_cp_description_t description)
+{
+  return gpi_cp_peer_epochs_offset (description, description->number_of_stripes);
+}
+
+static gaspi_offset_t
+gpi_cp_record_offset ( const gpi_cp_description_t description
+                     , const gaspi_offset_t snapshot
+                     )
+{
+  return gpi_cp_records_offset (description)
+    + (snapshot / gpi_cp_slot_size (description)) * sizeof (gpi_cp_checksum_record_t);
+}
+
+static gaspi_offset_t
+gpi_cp_outgoing_record_offset (const gpi_cp_description_t description)
+{
+  return gpi_cp_records_offset (description)
+    + description->number_of_snapshots * sizeof (gpi_cp_checksum_record_t);
+}
+
+/* with a spare pool, behind the records:
+
+   [failure views, two per rank][outgoing view][recruitment]
+
+   a view is a bitmap of the ranks a member takes for failed, exchanged
+   in rounds by gpi_cp_recover; a recruited spare finds the new ring
+   order in its recruitment. With shadows there follow
+
+   [outgoing shadow epoch], and on spares only
+   [shadow epochs, per position and slot][shadows, per position and slot]
+
+   a shadow holds all of the data of a member, its epoch is set by the
+   member once the shadow arrived complete
+*/
+#define GPI_CP_BITS_PER_WORD (8 * sizeof (unsigned long))
+
+typedef struct
+{
+  unsigned long spares_used;
+  unsigned long number_of_members; // followed by the members and the
+                                   // spares
+} gpi_cp_recruitment_t;
+
+static gaspi_number_t
+gpi_cp_view_words (void)
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  return (nProc + GPI_CP_BITS_PER_WORD - 1) / GPI_CP_BITS_PER_WORD;
+}
+
+static bool
+gpi_cp_test_bit ( const unsigned long* bits
+                , const gaspi_rank_t rank
+                )
+{
+  return (bits[rank / GPI_CP_BITS_PER_WORD] >> (rank % GPI_CP_BITS_PER_WORD)) & 1UL;
+}
+
+static void
+gpi_cp_set_bit ( unsigned long* bits
+               , const gaspi_rank_t rank
+               )
+{
+  bits[rank / GPI_CP_BITS_PER_WORD] |= 1UL << (rank % GPI_CP_BITS_PER_WORD);
+}
+
+static gaspi_offset_t
+gpi_cp_views_offset (const gpi_cp_description_t description)
+{
+  if (!description->checksums)
+    return gpi_cp_records_offset (description);
+
+  return gpi_cp_outgoing_record_offset (description)
+    + sizeof (gpi_cp_checksum_record_t);
+}
+
+/* view of rank in round, the rounds alternate between two buffers */
+static gaspi_offset_t
+gpi_cp_view_offset ( const gpi_cp_description_t description
+                   , const gaspi_rank_t rank
+                   , const unsigned long round
+                   )
+{
+  return gpi_cp_views_offset (description)
+    + (2 * rank + round % 2) * gpi_cp_view_words () * sizeof (unsigned long);
+}
+
+static gaspi_offset_t
+gpi_cp_outgoing_view_offset (const gpi_cp_description_t description)
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  return gpi_cp_view_offset (description, nProc, 0);
+}
+
+static gaspi_offset_t
+gpi_cp_recruitment_offset (const gpi_cp_description_t description)
+{
+  return gpi_cp_outgoing_view_offset (description)
+    + gpi_cp_view_words () * sizeof (unsigned long);
+}
+
+static gaspi_size_t
+gpi_cp_recruitment_size (void)
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  gaspi_size_t const words =
+    (nProc * sizeof (gaspi_rank_t) + sizeof (unsigned long) - 1) / sizeof (unsigned long);
+
+  return sizeof (gpi_cp_recruitment_t) + words * sizeof (unsigned long);
+}
+
+static gaspi_offset_t
+gpi_cp_outgoing_shadow_epoch_offset (const gpi_cp_description_t description)
+{
+  return gpi_cp_recruitment_offset (description) + gpi_cp_recruitment_size ();
+}
+
+/* epoch of the shadow of the index-th position of a spare in snapshot */
+static gaspi_offset_t
+gpi_cp_shadow_epoch_offset ( const gpi_cp_description_t description
+                           , const gaspi_number_t index
+                           , const gaspi_offset_t snapshot
+                           )
+{
+  return gpi_cp_outgoing_shadow_epoch_offset (description)
+    + ( 1
+      + index * description->number_of_snapshots
+      + snapshot / gpi_cp_slot_size (description)
+      ) * sizeof (unsigned long);
+}
+
+static gaspi_offset_t
+gpi_cp_shadow_offset ( const gpi_cp_description_t description
+                     , const gaspi_number_t index
+                     , const gaspi_offset_t snapshot
+                     )
+{
+  return gpi_cp_shadow_epoch_offset (description, description->shadow_capacity, 0)
+    + ( index * description->number_of_snapshots
+      + snapshot / gpi_cp_slot_size (description)
+      ) * description->size;
+}
+
+static gaspi_size_t
+gpi_cp_segment_size (const gpi_cp_description_t description)
+{
+  if (!description->spare_pool)
+    return gpi_cp_views_offset (description);
+
+  if (!description->shadows)
+    return gpi_cp_recruitment_offset (description) + gpi_cp_recruitment_size ();
+
+  if (!description->spare)
+    return gpi_cp_shadow_epoch_offset (description, 0, 0);
+
+  return gpi_cp_shadow_offset (description, description->shadow_capacity, 0);
+}
+
+/* the spare that keeps the shadow of ring position, if any, and the
+   index of the position on it */
+static bool
+gpi_cp_shadow_index ( const gpi_cp_description_t description
+                    , const gaspi_number_t position
+                    , gaspi_rank_t* const spare
+                    , gaspi_number_t* const index
+                    )
+{
+  if (!description->shadows || description->shadow_capacity == 0)
+    return false;
+
+  gaspi_number_t const block = position / description->shadow_capacity;
+
+  if (block >= description->number_of_spares)
+    return false;
+
+  *spare = description->shadow_spares[block];
+  *index = position % description->shadow_capacity;
+
+  return true;
+}
+
+/* the shadow of ring position, as long as its spare waits in the pool */
+static bool
+gpi_cp_shadow_spare ( const gpi_cp_description_t description
+                    , const gaspi_number_t position
+                    , gaspi_rank_t* const spare
+                    , gaspi_number_t* const index
+                    )
+{
+  if (!gpi_cp_shadow_index (description, position, spare, index))
+    return false;
+
+  gaspi_number_t i;
+  for (i = description->spares_used; i < description->number_of_spares; ++i)
+    {
+      if (description->spares[i] == *spare)
+        return true;
+    }
+
+  return false;
+}
+
+/* the mirror lives in anonymous memory or, with a mirror path, in a
+   mapped file that remote writes reach directly; its segment id is
+   the one of gpi_cp_agree_mirror */
+static gaspi_return_t
+gpi_cp_allocate_and_register_local_segment ( const gaspi_segment_id_t segment_id_local_for_sender
+                                           , const gaspi_size_t segment_size
+                                           , const gaspi_rank_t* senders
+                                           , const gaspi_number_t number_of_senders
+                                           , const char* mirror_path
+                                           , gpi_cp_mirror_t* mirror
+                                           , const gaspi_timeout_t timeout_ms
+                                           )
+{
+  if (mirror_path == NULL)
+    {
+      GASPI_SUCCESS_OR_RETURN (gaspi_segment_alloc ( segment_id_local_for_sender
+                                                   , segment_size
+                                                   , GASPI_MEM_UNINITIALIZED
+                                                   )
+                              );
+    }
+  else
+    {
+      gaspi_rank_t iProc;
+      GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+      char file_name[strlen (mirror_path) + 32];
+      sprintf (file_name, "%s/gpi_cp.%u.mirror", mirror_path, iProc);
+
+      if (gpi_cp_mirror_map (file_name, segment_size, mirror) != 0)
+        return GASPI_ERROR;
+
+      const gaspi_return_t ret =
+        gaspi_segment_bind (segment_id_local_for_sender, mirror->data, segment_size, 0);
+
+      if (ret != GASPI_SUCCESS)
+        {
+          gpi_cp_mirror_unmap (mirror);
+          return ret;
+        }
+    }
+
+  gaspi_number_t j;
+  for (j = 0; j < number_of_senders; ++j)
+    {
+      GASPI_SUCCESS_OR_RETURN (gaspi_segment_register ( segment_id_local_for_sender
+                                                      , senders[j]
+                                                      , timeout_ms
+                                                      )
+                              );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* with the neighbourhood commit the receivers confirm snapshots on
+   our mirror, with deduplication they put the hashes of their blocks
+   there; those that are senders as well know it already */
+static gaspi_return_t
+gpi_cp_register_with_receivers ( const gpi_cp_description_t description
+                               , const gaspi_rank_t* old_receivers
+                               , const gaspi_number_t number_of_old_receivers
+                               , const gaspi_timeout_t timeout_ms
+                               )
+{
+  if (description->agreement_interval == 0 && !description->deduplicate)
+    return GASPI_SUCCESS;
+
+  gaspi_number_t j, k;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      gaspi_rank_t const receiver = description->receivers[j];
+      bool known = false;
+
+      for (k = 0; k < description->number_of_stripes; ++k)
+        known = known || description->senders[k] == receiver;
+      for (k = 0; k < number_of_old_receivers; ++k)
+        known = known || old_receivers[k] == receiver;
+
+      if (!known)
+        GASPI_SUCCESS_OR_RETURN (gaspi_segment_register ( description->segment_id_local_for_sender
+                                                        , receiver
+                                                        , timeout_ms
+                                                        )
+                                );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* slot following snapshot in the ring of snapshot slots */
+static gaspi_offset_t
+gpi_cp_next_snapshot ( const gpi_cp_description_t description
+                     , const gaspi_offset_t snapshot
+                     )
+{
+  return (snapshot + gpi_cp_slot_size (description))
+    % (description->number_of_snapshots * gpi_cp_slot_size (description));
+}
+
+/* notification used by rank when writing into snapshot on its receiver
+
+   with pipelining the transfer of epoch n+1 may arrive before the
+   receiver has consumed the notification of epoch n, so every slot
+   gets its own notification id
+*/
+static gaspi_notification_id_t
+gpi_cp_notification_id ( const gpi_cp_description_t description
+                       , const gaspi_rank_t rank
+                       , const gaspi_offset_t snapshot
+                       )
+{
+  gaspi_rank_t nProc;
+
+  if ( description->number_of_snapshots <= 2
+     || GASPI_SUCCESS != gaspi_proc_num (&nProc)
+     )
+    return (gaspi_notification_id_t) rank;
+
+  return (gaspi_notification_id_t) (rank + nProc * (snapshot / gpi_cp_slot_size (description)));
+}
+
+/* value of the notifications for the snapshot of epoch: never 0, a
+   notification left over from an aborted epoch is told apart by it */
+static gaspi_notification_t
+gpi_cp_notification_value (const unsigned long epoch)
+{
+  return (gaspi_notification_t) (epoch % 0xffffffffUL) + 1;
+}
+
+/* notification used by receiver rank to confirm the snapshot in slot
+   on its sender, after the ids of the snapshots */
+static gaspi_notification_id_t
+gpi_cp_ack_notification_id ( const gpi_cp_description_t description
+                           , const gaspi_rank_t rank
+                           , const gaspi_offset_t snapshot
+                           )
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  return (gaspi_notification_id_t)
+    (nProc * description->number_of_snapshots
+     + gpi_cp_notification_id (description, rank, snapshot)
+    );
+}
+
+/* heartbeat of rank, after the confirmations */
+static gaspi_notification_id_t
+gpi_cp_beat_notification_id ( const gpi_cp_description_t description
+                            , const gaspi_rank_t rank
+                            )
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  return (gaspi_notification_id_t)
+    (2 * nProc * description->number_of_snapshots + rank);
+}
+
+/* view of rank in round, after the heartbeats */
+static gaspi_notification_id_t
+gpi_cp_view_notification_id ( const gpi_cp_description_t description
+                            , const gaspi_rank_t rank
+                            , const unsigned long round
+                            )
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  return (gaspi_notification_id_t)
+    (gpi_cp_beat_notification_id (description, nProc) + 2 * rank + round % 2);
+}
+
+/* recruitment (or release) of a spare, after the views */
+static gaspi_notification_id_t
+gpi_cp_recruit_notification_id (const gpi_cp_description_t description)
+{
+  gaspi_rank_t nProc;
+
+  if (GASPI_SUCCESS != gaspi_proc_num (&nProc))
+    nProc = 0;
+
+  return gpi_cp_view_notification_id (description, nProc, 0);
+}
+
+/* hashes of the blocks of receiver rank on its sender, after the
+   recruitment */
+static gaspi_notification_id_t
+gpi_cp_hashes_notification_id ( const gpi_cp_description_t description
+                              , const gaspi_rank_t rank
+                              )
+{
+  return (gaspi_notification_id_t)
+    (gpi_cp_recruit_notification_id (description) + 1 + rank);
+}
+
+/* count values reduced elementwise over group with op, one allreduce
+   per gaspi_allreduce_elem_max of them */
+static gaspi_return_t
+gpi_cp_allreduce ( const gaspi_group_t group
+                 , unsigned long* const contribution
+                 , unsigned long* const values
+                 , const gaspi_number_t count
+                 , const gaspi_operation_t op
+                 , const gaspi_timeout_t timeout_ms
+                 )
+{
+  gaspi_number_t elem_max;
+  GASPI_SUCCESS_OR_RETURN (gaspi_allreduce_elem_max (&elem_max));
+
+  gaspi_return_t ret = GASPI_SUCCESS;
+  gaspi_number_t first = 0;
+
+  while (first < count && ret == GASPI_SUCCESS)
+    {
+      gaspi_number_t const chunk = MIN (elem_max, count - first);
+
+      ret = gaspi_allreduce ( contribution + first
+                            , values + first
+                            , chunk
+                            , op
+                            , GASPI_TYPE_ULONG
+                            , group
+                            , timeout_ms
+                            );
+      first += chunk;
+    }
+
+  return ret;
+}
+
+/* all members of group contribute a nonzero value, values[rank] gets
+   the one of rank (0 for ranks outside the group)
+
+   it grows with the number of ranks: only gpi_cp_expand uses it, the
+   new ranks learn the old ring from it */
+static gaspi_return_t
+gpi_cp_allgather ( const gaspi_group_t group
+                 , const unsigned long value
+                 , unsigned long* const values
+                 , const gaspi_timeout_t timeout_ms
+                 )
+{
+  gaspi_rank_t nProc, iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_num (&nProc));
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  unsigned long* const contribution = calloc (nProc, sizeof (unsigned long));
+
+  if (contribution == NULL)
+    return GASPI_ERROR;
+
+  contribution[iProc] = value;
+
+  gaspi_return_t const ret =
+    gpi_cp_allreduce (group, contribution, values, nProc, GASPI_OP_MAX, timeout_ms);
+
+  free (contribution);
+
+  return ret;
+}
+
+/* what a rank tells in the allgather of gpi_cp_expand: its position
+   in the old ring, or that it is new */
+#define GPI_CP_BIND_PRESENT (1UL << 63)
+#define GPI_CP_BIND_JOINER (1UL << 62)
+
+/* agree within group on the segment id of the mirrors, the same on
+   all ranks, and on the newest epoch a survivor started (joiners
+   contribute 0)
+
+   a rank with a mirror contributes its id, the others flag the ids
+   they use: joiners take the id of the mirrors there are, a new
+   group the lowest id that is unused on all ranks. One allreduce of
+   gaspi_segment_max + 2 values, whatever the number of ranks; if the
+   id is taken somewhere, all ranks fail alike. */
+static gaspi_return_t
+gpi_cp_agree_mirror ( gpi_cp_description_t description
+                    , const gaspi_group_t group
+                    , const bool has_mirror
+                    , const unsigned long started_epoch
+                    , unsigned long* const epoch
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  gaspi_number_t segment_max, number_of_segments, i;
+  GASPI_SUCCESS_OR_RETURN (gaspi_segment_max (&segment_max));
+  GASPI_SUCCESS_OR_RETURN (gaspi_segment_num (&number_of_segments));
+
+  // [used:segment_max][mirror id + 1][started epoch]
+  unsigned long* const contribution = calloc (2 * (segment_max + 2), sizeof (unsigned long));
+  gaspi_segment_id_t* const segment_ids =
+    malloc ((number_of_segments + 1) * sizeof (gaspi_segment_id_t));
+
+  if (contribution == NULL || segment_ids == NULL)
+    {
+      free (contribution);
+      free (segment_ids);
+      return GASPI_ERROR;
+    }
+
+  unsigned long* const values = contribution + segment_max + 2;
+  gaspi_return_t ret = GASPI_SUCCESS;
+
+  if (has_mirror)
+    contribution[segment_max] = description->segment_id_local_for_sender + 1UL;
+  else if (number_of_segments > 0)
+    ret = gaspi_segment_list (number_of_segments, segment_ids);
+
+  for (i = 0; i < number_of_segments && !has_mirror && ret == GASPI_SUCCESS; ++i)
+    contribution[segment_ids[i]] = 1;
+
+  contribution[segment_max + 1] = started_epoch;
+
+  if (ret == GASPI_SUCCESS)
+    ret = gpi_cp_allreduce (group, contribution, values, segment_max + 2, GASPI_OP_MAX, timeout_ms);
+
+  free (segment_ids);
+
+  gaspi_number_t id = 0;
+
+  if (ret == GASPI_SUCCESS && values[segment_max] > 0)
+    id = values[segment_max] - 1;
+
+  while (ret == GASPI_SUCCESS && values[segment_max] == 0 && id < segment_max && values[id] != 0)
+    ++id;
+
+  if (ret == GASPI_SUCCESS && (id >= segment_max || values[id] != 0))
+    {
+      fprintf (stderr, "No segment id for the mirror unused on all ranks\n");
+      ret = GASPI_ERROR;
+    }
+
+  if (ret == GASPI_SUCCESS)
+    {
+      description->segment_id_local_for_sender = (gaspi_segment_id_t) id;
+      *epoch = values[segment_max + 1];
+    }
+
+  free (contribution);
+
+  return ret;
+}
+
+/* what gpi_cp_bind found out about the group */
+typedef struct
+{
+  bool receiver_joined[GPI_CP_STRIPES_MAX];
+  bool receiver_shadowed[GPI_CP_STRIPES_MAX]; // fills our stripe itself
+  bool sender_shadowed[GPI_CP_STRIPES_MAX]; // we fill its stripe
+  unsigned long epoch; // the newest one a survivor started
+} gpi_cp_bind_result_t;
+
+/* slot of the data of epoch, the committed one once epoch is the
+   current epoch */
+static gaspi_offset_t
+gpi_cp_epoch_snapshot ( const gpi_cp_description_t description
+                      , const unsigned long epoch
+                      )
+{
+  gaspi_number_t const n = description->number_of_snapshots;
+
+  return ((epoch + n - 1) % n) * gpi_cp_slot_size (description);
+}
+
+/* bind the partners on the mirror segment id and the epoch of
+   gpi_cp_agree_mirror, once all mirrors are registered with their
+   senders
+
+   one allreduce of bitmaps by rank, k + 1 bits per rank: the joiners,
+   and for every stripe j the spares that join with the stripe of
+   their sender j of epoch in a shadow (shadowed). It returns once
+   all ranks registered. */
+static gaspi_return_t
+gpi_cp_bind ( gpi_cp_description_t description
+            , const bool joiner
+            , const unsigned long epoch
+            , const unsigned long shadowed
+            , gpi_cp_bind_result_t* const result
+            , const gaspi_timeout_t timeout_ms
+            )
+{
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  // a new receiver does not know our previous snapshot, new senders
+  // (and refills) change what our slots hold
+  description->delta_base_epoch = 0;
+
+  if (description->slot_maps != NULL)
+    memset (description->slot_maps, 0, description->number_of_snapshots * gpi_cp_block_map_size (description));
+
+  // the epochs start anew from the restored one; the local copies
+  // still hold the data of their epochs, a refill sends them
+  memset (description->variable_slot_epochs, 0, sizeof (description->variable_slot_epochs));
+
+  // [joiners][shadowed stripe 0]...[shadowed stripe k - 1]
+  gaspi_number_t const words = gpi_cp_view_words ();
+  gaspi_number_t const count = (description->number_of_stripes + 1) * words;
+  unsigned long* const contribution = calloc (2 * count, sizeof (unsigned long));
+
+  if (contribution == NULL)
+    return GASPI_ERROR;
+
+  unsigned long* const bits = contribution + count;
+  gaspi_number_t j;
+
+  if (joiner)
+    gpi_cp_set_bit (contribution, iProc);
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if ((shadowed >> j) & 1)
+        gpi_cp_set_bit (contribution + (j + 1) * words, iProc);
+    }
+
+  // every rank sets its own bits only, the sum is the union
+  gaspi_return_t const ret =
+    gpi_cp_allreduce (description->group, contribution, bits, count, GASPI_OP_SUM, timeout_ms);
+
+  for (j = 0; j < description->number_of_stripes && ret == GASPI_SUCCESS; ++j)
+    {
+      gaspi_rank_t const receiver = description->receivers[j];
+
+      description->segment_ids_remote_on_receivers[j] = description->segment_id_local_for_sender;
+      description->segment_ids_remote_on_senders[j] = description->segment_id_local_for_sender;
+      result->receiver_joined[j] = gpi_cp_test_bit (bits, receiver);
+      result->receiver_shadowed[j] = gpi_cp_test_bit (bits + (j + 1) * words, receiver);
+      result->sender_shadowed[j] = gpi_cp_test_bit (bits + (j + 1) * words, iProc);
+    }
+
+  result->epoch = epoch;
+
+  free (contribution);
+
+  return ret;
+}
+
+/* the members and the spares: gpi_cp_recover (and the shadows) write
+   from any of them to any of them */
+static gaspi_return_t
+gpi_cp_pool_group ( const gpi_cp_description_t description
+                  , gaspi_group_t* const pool
+                  , const gaspi_timeout_t timeout_ms
+                  )
+{
+  gaspi_number_t number_of_spares;
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_size (description->spare_group, &number_of_spares));
+
+  gaspi_rank_t* const spares = malloc (number_of_spares * sizeof (gaspi_rank_t));
+
+  if (spares == NULL)
+    return GASPI_ERROR;
+
+  gaspi_return_t ret = gaspi_group_ranks (description->spare_group, spares);
+
+  if (ret == GASPI_SUCCESS)
+    ret = gaspi_group_create (pool);
+
+  gaspi_number_t i;
+
+  for (i = 0; i < description->number_of_members && ret == GASPI_SUCCESS; ++i)
+    ret = gaspi_group_add (*pool, description->members[i]);
+  for (i = 0; i < number_of_spares && ret == GASPI_SUCCESS; ++i)
+    ret = gaspi_group_add (*pool, spares[i]);
+
+  if (ret == GASPI_SUCCESS)
+    ret = gaspi_group_commit (*pool, timeout_ms);
+
+  free (spares);
+
+  return ret;
+}
+
+/* members and spares register their mirrors with each other, all of
+   the pool, once; the mirrors share their segment id */
+static gaspi_return_t
+gpi_cp_bind_pool ( gpi_cp_description_t description
+                 , const gaspi_group_t pool
+                 , const gaspi_timeout_t timeout_ms
+                 )
+{
+  gaspi_number_t number_of_spares;
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_size (description->spare_group, &number_of_spares));
+
+  free (description->spares);
+  free (description->shadow_spares);
+  description->spares = malloc (number_of_spares * sizeof (gaspi_rank_t));
+  description->shadow_spares = malloc (number_of_spares * sizeof (gaspi_rank_t));
+
+  if (description->spares == NULL || description->shadow_spares == NULL)
+    return GASPI_ERROR;
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_ranks (description->spare_group, description->spares));
+  qsort (description->spares, number_of_spares, sizeof (gaspi_rank_t), gpi_cp_compare_ranks);
+  memcpy (description->shadow_spares, description->spares, number_of_spares * sizeof (gaspi_rank_t));
+  description->number_of_spares = number_of_spares;
+  description->spares_used = 0;
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  gaspi_number_t i;
+
+  for (i = 0; i < description->number_of_members; ++i)
+    {
+      if (description->members[i] != iProc)
+        GASPI_SUCCESS_OR_RETURN (gaspi_segment_register ( description->segment_id_local_for_sender
+                                                        , description->members[i]
+                                                        , timeout_ms
+                                                        )
+                                );
+    }
+  for (i = 0; i < number_of_spares; ++i)
+    {
+      if (description->spares[i] != iProc)
+        GASPI_SUCCESS_OR_RETURN (gaspi_segment_register ( description->segment_id_local_for_sender
+                                                        , description->spares[i]
+                                                        , timeout_ms
+                                                        )
+                                );
+    }
+
+  return gaspi_barrier (pool, timeout_ms);
+}
+
+/* make epoch the current one, alike on all ranks */
+static void
+gpi_cp_adopt_epoch ( gpi_cp_description_t description
+                   , const unsigned long epoch
+                   )
+{
+  description->epoch = epoch;
+  description->global_epoch = epoch;
+  description->agreement_epoch = (description->agreement_interval > 0)
+    ? epoch - epoch % description->agreement_interval
+    : epoch;
+  description->committed_snapshot = gpi_cp_epoch_snapshot (description, epoch);
+  description->active_snapshot = gpi_cp_next_snapshot (description, description->committed_snapshot);
+}
+
+/* a new mirror holds no stripes yet */
+static void
+gpi_cp_clear_epochs (const gpi_cp_description_t description)
+{
+  memset ( gpi_cp_ptr ( description->segment_id_local_for_sender
+                      , gpi_cp_epochs_offset (description)
+                      )
+         , 0
+         , gpi_cp_records_offset (description) - gpi_cp_epochs_offset (description)
+         );
+}
+
+/* a spare holds no shadows yet */
+static void
+gpi_cp_clear_shadow_epochs (const gpi_cp_description_t description)
+{
+  if (!description->shadows)
+    return;
+
+  memset ( gpi_cp_ptr ( description->segment_id_local_for_sender
+                      , gpi_cp_shadow_epoch_offset (description, 0, 0)
+                      )
+         , 0
+         , description->shadow_capacity * description->number_of_snapshots * sizeof (unsigned long)
+         );
+}
+
+/* record epoch and the committed slot in the mirror file, if any */
+static gaspi_return_t
+gpi_cp_commit_mirror ( const gpi_cp_description_t description
+                     , const unsigned long epoch
+                     )
+{
+  if (description->mirror.data == NULL)
+    return GASPI_SUCCESS;
+
+  gpi_cp_mirror_state_t state;
+  memset (&state, 0, sizeof (state));
+  state.epoch = epoch;
+  state.committed_snapshot = description->committed_snapshot;
+  state.size = description->size;
+  state.rank = description->senders[0];
+  state.number_of_snapshots = description->number_of_snapshots;
+
+  return gpi_cp_mirror_commit (&description->mirror, &state) == 0
+    ? GASPI_SUCCESS : GASPI_ERROR;
+}
+
+/* start the background writer for persistent copies, if requested */
+static gaspi_return_t
+gpi_cp_start_drain (gpi_cp_description_t description)
+{
+  if (description->persistent_path == NULL || description->drain != NULL)
+    return GASPI_SUCCESS;
+
+  description->drain = gpi_cp_drain_create();
+
+  return description->drain != NULL ? GASPI_SUCCESS : GASPI_ERROR;
+}
+
+/* start the background verifier, if requested */
+static gaspi_return_t
+gpi_cp_start_verifier (gpi_cp_description_t description)
+{
+  if (!description->checksums || description->verifier != NULL)
+    return GASPI_SUCCESS;
+
+  description->verifier = gpi_cp_verifier_create();
+
+  return description->verifier != NULL ? GASPI_SUCCESS : GASPI_ERROR;
+}
+
+/* result of the check of the last snapshot received */
+static gaspi_return_t
+gpi_cp_wait_verifier (gpi_cp_description_t description)
+{
+  if (description->verifier == NULL)
+    return GASPI_SUCCESS;
+
+  if (gpi_cp_verifier_wait (description->verifier) != 0)
+    {
+      fprintf (stderr, "Checksum mismatch in snapshot of rank %u\n", description->senders[0]);
+      return GASPI_ERROR; //! \todo specific error code
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* wait for the background writer, a failed persistent copy is an error */
+static gaspi_return_t
+gpi_cp_wait_drain (gpi_cp_description_t description)
+{
+  if (description->drain == NULL)
+    return GASPI_SUCCESS;
+
+  if (gpi_cp_drain_wait (description->drain) != 0)
+    {
+      fprintf (stderr, "Persistent copy of the snapshot of rank %u failed\n", description->senders[0]);
+      return GASPI_ERROR; //! \todo specific error code
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* restores are split into chunks spread over several queues */
+#define GPI_CP_RESTORE_CHUNK_SIZE_MIN (64 * 1024)
+#define GPI_CP_RESTORE_CHUNK_SIZE_MAX (4 * 1024 * 1024)
+
+static gaspi_number_t
+gpi_cp_number_of_restore_queues ( const gpi_cp_description_t description
+                                , const gaspi_number_t queue_num
+                                )
+{
+  if (description->restore_queues == 0 || description->restore_queues > queue_num)
+    return queue_num;
+
+  return description->restore_queues;
+}
+
+static gaspi_queue_id_t
+gpi_cp_restore_queue ( const gpi_cp_description_t description
+                     , const gaspi_number_t queue_num
+                     , const gaspi_number_t k
+                     )
+{
+  return (description->queue + k) % queue_num;
+}
+
+/* read size bytes in chunks, round robin over the restore queues;
+   complete with gpi_cp_wait_chunked */
+static gaspi_return_t
+gpi_cp_read_chunked ( const gpi_cp_description_t description
+                    , const gaspi_segment_id_t segment_id_local
+                    , const gaspi_offset_t offset_local
+                    , const gaspi_rank_t rank
+                    , const gaspi_segment_id_t segment_id_remote
+                    , const gaspi_offset_t offset_remote
+                    , const gaspi_size_t size
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  gaspi_number_t queue_num, queue_size_max;
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_num (&queue_num));
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_size_max (&queue_size_max));
+
+  gaspi_number_t const queues =
+    gpi_cp_number_of_restore_queues (description, queue_num);
+
+  // at least one chunk per queue, unless the chunks get too small
+  gaspi_size_t chunk_size = (size + queues - 1) / queues;
+
+  if (chunk_size < GPI_CP_RESTORE_CHUNK_SIZE_MIN)
+    chunk_size = GPI_CP_RESTORE_CHUNK_SIZE_MIN;
+  if (chunk_size > GPI_CP_RESTORE_CHUNK_SIZE_MAX)
+    chunk_size = GPI_CP_RESTORE_CHUNK_SIZE_MAX;
+
+  gaspi_number_t chunk = 0;
+
+  for (gaspi_size_t done = 0; done < size; done += chunk_size, ++chunk)
+    {
+      gaspi_size_t const length =
+        (size - done < chunk_size) ? size - done : chunk_size;
+      gaspi_queue_id_t const queue =
+        gpi_cp_restore_queue (description, queue_num, chunk % queues);
+
+      gaspi_number_t queue_size;
+      GASPI_SUCCESS_OR_RETURN (gaspi_queue_size (queue, &queue_size));
+
+      if (queue_size >= queue_size_max)
+        GASPI_SUCCESS_OR_RETURN (gaspi_wait (queue, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN ( gaspi_read ( segment_id_local
+                                           , offset_local + done
+                                           , rank
+                                           , segment_id_remote
+                                           , offset_remote + done
+                                           , length
+                                           , queue
+                                           , timeout_ms
+                                           )
+                              );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* wait for all queues gpi_cp_read_chunked may have used */
+static gaspi_return_t
+gpi_cp_wait_chunked ( const gpi_cp_description_t description
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  gaspi_number_t queue_num;
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_num (&queue_num));
+
+  gaspi_number_t const queues =
+    gpi_cp_number_of_restore_queues (description, queue_num);
+
+  for (gaspi_number_t k = 0; k < queues; ++k)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_wait (gpi_cp_restore_queue (description, queue_num, k), timeout_ms));
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* the staging segment of what we send, at least size bytes */
+static gaspi_return_t
+gpi_cp_staging_buffer ( gpi_cp_description_t description
+                      , const gaspi_size_t size
+                      )
+{
+  if (description->compressed_buffer_size >= size)
+    return GASPI_SUCCESS;
+
+  if (description->compressed_buffer_size > 0)
+    GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_compressed));
+
+  description->compressed_buffer_size = 0;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_get_unused_segment_id (&description->segment_id_compressed));
+  GASPI_SUCCESS_OR_RETURN (gaspi_segment_alloc ( description->segment_id_compressed
+                                               , size
+                                               , GASPI_MEM_UNINITIALIZED
+                                               )
+                          );
+
+  description->compressed_buffer_size = size;
+
+  return GASPI_SUCCESS;
+}
+
+/* the staging segment of compressed snapshots, one slot large */
+static gaspi_return_t
+gpi_cp_compression_buffers (gpi_cp_description_t description)
+{
+  if (description->compression_scratch == NULL)
+    {
+      description->compression_scratch =
+        malloc ((description->delta > 0) ? GPI_CP_DELTA_SCRATCH_SIZE : 2 * GPI_CP_COMPRESS_CHUNK_SIZE);
+
+      if (description->compression_scratch == NULL)
+        return GASPI_ERROR;
+    }
+
+  return gpi_cp_staging_buffer (description, gpi_cp_slot_size (description));
+}
+
+/* compress our data and write it into snapshot of the receiver, every
+   chunk as soon as it is compressed, so the transfers overlap with the
+   compression of the next ones. The header and the table go last,
+   notified if notification_value is not 0.
+
+   GASPI_ERROR if the compressed data exceeds the slot; what was
+   written is not notified then */
+static gaspi_return_t
+gpi_cp_write_compressed ( gpi_cp_description_t description
+                        , const gaspi_offset_t snapshot
+                        , const gaspi_notification_id_t notification_id
+                        , const gaspi_notification_t notification_value
+                        , const gaspi_timeout_t timeout_ms
+                        )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_compression_buffers (description));
+
+  gaspi_size_t const table_size = gpi_cp_compress_table_size (description->size);
+  gaspi_size_t const capacity = gpi_cp_slot_size (description);
+
+  gpi_cp_compressed_header_t* const header = (gpi_cp_compressed_header_t*)
+    gpi_cp_ptr (description->segment_id_compressed, 0);
+  uint32_t* const table = (uint32_t*) (header + 1);
+  const char* const data = (const char*)
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
+
+  gaspi_number_t queueSize, qmax;
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_size_max (&qmax));
+
+  gaspi_size_t payload = 0;
+  gaspi_size_t done;
+  gaspi_number_t chunk = 0;
+
+  for (done = 0; done < description->size; done += GPI_CP_COMPRESS_CHUNK_SIZE, ++chunk)
+    {
+      gaspi_size_t const length =
+        MIN (description->size - done, (gaspi_size_t) GPI_CP_COMPRESS_CHUNK_SIZE);
+
+      gaspi_size_t const compressed = gpi_cp_compress_chunk
+        ( gpi_cp_ptr (description->segment_id_compressed, table_size + payload)
+        , capacity - table_size - payload
+        , data + done
+        , length
+        , description->compression
+        , description->lossy_dropped_bits
+        , description->compression_scratch
+        , &table[chunk]
+        );
+
+      if (compressed == 0)
+        {
+          fprintf (stderr, "Compressed snapshot exceeds %lu bytes\n", (unsigned long) capacity);
+          gaspi_wait (description->queue, timeout_ms);
+          return GASPI_ERROR;
+        }
+
+      GASPI_SUCCESS_OR_RETURN (gaspi_queue_size (description->queue, &queueSize));
+      if (queueSize > qmax - 24)
+        GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_write ( description->segment_id_compressed
+                     , table_size + payload
+                     , description->receivers[0]
+                     , description->segment_ids_remote_on_receivers[0]
+                     , snapshot + table_size + payload
+                     , compressed
+                     , description->queue
+                     , timeout_ms
+                     )
+         );
+
+      payload += compressed;
+    }
+
+  header->size = description->size;
+  header->payload = payload;
+  header->chunk_size = GPI_CP_COMPRESS_CHUNK_SIZE;
+  header->element_size = (uint32_t) description->compression;
+
+  description->compressed_size = table_size + payload;
+
+  if (notification_value == 0)
+    return gaspi_write ( description->segment_id_compressed
+                       , 0
+                       , description->receivers[0]
+                       , description->segment_ids_remote_on_receivers[0]
+                       , snapshot
+                       , table_size
+                       , description->queue
+                       , timeout_ms
+                       );
+
+  return gaspi_write_notify ( description->segment_id_compressed
+                            , 0
+                            , description->receivers[0]
+                            , description->segment_ids_remote_on_receivers[0]
+                            , snapshot
+                            , table_size
+                            , notification_id
+                            , notification_value
+                            , description->queue
+                            , timeout_ms
+                            );
+}
+
+/* joiner: read our compressed snapshot from the receiver, in chunks
+   over the restore queues, and decompress it into the checkpoint
+   region */
+static gaspi_return_t
+gpi_cp_read_compressed ( gpi_cp_description_t description
+                       , const gaspi_offset_t snapshot
+                       , const gaspi_timeout_t timeout_ms
+                       )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_compression_buffers (description));
+
+  gaspi_size_t const table_size = gpi_cp_compress_table_size (description->size);
+
+  GASPI_SUCCESS_OR_RETURN
+    ( gaspi_read ( description->segment_id_compressed
+                 , 0
+                 , description->receivers[0]
+                 , description->segment_ids_remote_on_receivers[0]
+                 , snapshot
+                 , table_size
+                 , description->queue
+                 , timeout_ms
+                 )
+      );
+  GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  const gpi_cp_compressed_header_t* const header = (const gpi_cp_compressed_header_t*)
+    gpi_cp_ptr (description->segment_id_compressed, 0);
+  const uint32_t* const table = (const uint32_t*) (header + 1);
+
+  if ( header->size != description->size
+     || header->chunk_size != GPI_CP_COMPRESS_CHUNK_SIZE
+     || header->payload > gpi_cp_slot_size (description) - table_size
+     )
+    {
+      fprintf (stderr, "Corrupt compressed snapshot on %u\n", description->receivers[0]);
+      return GASPI_ERROR;
+    }
+
+  if (header->payload > 0)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        ( gpi_cp_read_chunked ( description
+                              , description->segment_id_compressed
+                              , table_size
+                              , description->receivers[0]
+                              , description->segment_ids_remote_on_receivers[0]
+                              , snapshot + table_size
+                              , header->payload
+                              , timeout_ms
+                              )
+          );
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_chunked (description, timeout_ms));
+    }
+
+  char* const data = (char*)
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
+  gaspi_size_t payload = 0;
+  gaspi_size_t done;
+  gaspi_number_t chunk = 0;
+
+  for (done = 0; done < description->size; done += GPI_CP_COMPRESS_CHUNK_SIZE, ++chunk)
+    {
+      gaspi_size_t const length =
+        MIN (description->size - done, (gaspi_size_t) GPI_CP_COMPRESS_CHUNK_SIZE);
+      gaspi_size_t const compressed = table[chunk] & ~GPI_CP_COMPRESS_STORED;
+
+      if ( payload + compressed > header->payload
+         || gpi_cp_decompress_chunk ( data + done
+                                    , length
+                                    , gpi_cp_ptr (description->segment_id_compressed, table_size + payload)
+                                    , table[chunk]
+                                    , header->element_size
+                                    , description->compression_scratch
+                                    )
+         )
+        {
+          fprintf (stderr, "Corrupt compressed snapshot on %u\n", description->receivers[0]);
+          return GASPI_ERROR;
+        }
+
+      payload += compressed;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* the staging segment and scratch of compression, our previous
+   snapshot and the table of a delta */
+static gaspi_return_t
+gpi_cp_delta_buffers (gpi_cp_description_t description)
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_compression_buffers (description));
+
+  if (description->delta_previous == NULL)
+    {
+      description->delta_previous = malloc (description->size);
+
+      if (description->delta_previous == NULL)
+        return GASPI_ERROR;
+    }
+
+  if (description->delta_table == NULL)
+    {
+      description->delta_table = malloc (gpi_cp_delta_table_size (description->size));
+
+      if (description->delta_table == NULL)
+        return GASPI_ERROR;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* write the snapshot of epoch into snapshot of the receiver: the
+   delta to our previous one if it is smaller than the data, the data
+   as it is otherwise. The header goes last, notified. */
+static gaspi_return_t
+gpi_cp_write_delta ( gpi_cp_description_t description
+                   , const gaspi_offset_t snapshot
+                   , const unsigned long epoch
+                   , const gaspi_notification_id_t notification_id
+                   , const gaspi_notification_t notification_value
+                   , const gaspi_timeout_t timeout_ms
+                   )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_delta_buffers (description));
+
+  gaspi_size_t const table_size = gpi_cp_delta_table_size (description->size);
+  gaspi_size_t const slot_size = gpi_cp_slot_size (description);
+  gaspi_size_t const header_size = sizeof (gpi_cp_delta_header_t);
+
+  char* const staging = (char*) gpi_cp_ptr (description->segment_id_compressed, 0);
+  char* const previous = (char*) description->delta_previous;
+  const char* const data = (const char*)
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
+
+  unsigned long const base_epoch = description->delta_base_epoch;
+  bool delta = base_epoch != 0 && table_size < description->size;
+  gaspi_size_t payload = 0;
+  gaspi_size_t done;
+  gaspi_number_t chunk = 0;
+
+  // a failure leaves the receiver without our previous snapshot
+  description->delta_base_epoch = 0;
+
+  for (done = 0; delta && done < description->size; done += GPI_CP_DELTA_CHUNK_SIZE, ++chunk)
+    {
+      gaspi_size_t const length =
+        MIN (description->size - done, (gaspi_size_t) GPI_CP_DELTA_CHUNK_SIZE);
+
+      // at most as large as the data
+      gaspi_size_t const encoded = gpi_cp_delta_encode_chunk
+        ( staging + table_size + payload
+        , description->size - table_size - payload
+        , previous + done
+        , data + done
+        , length
+        , description->delta
+        , description->compression_scratch
+        , &description->delta_table[chunk]
+        );
+
+      if (encoded == 0)
+        {
+          memcpy (previous + done + length, data + done + length, description->size - done - length);
+          delta = false;
+        }
+
+      payload += encoded;
+    }
+
+  if (base_epoch == 0 || table_size >= description->size)
+    memcpy (previous, data, description->size);
+
+  gaspi_size_t const block_size = delta ? table_size + payload : 0;
+  gpi_cp_delta_header_t* const header = (gpi_cp_delta_header_t*) (staging + block_size);
+
+  header->base_epoch = delta ? base_epoch : 0;
+  header->size = description->size;
+  header->payload = delta ? payload : 0;
+  header->chunk_size = GPI_CP_DELTA_CHUNK_SIZE;
+  header->element_size = (uint32_t) description->delta;
+
+  if (delta)
+    memcpy (staging, description->delta_table, table_size);
+  else
+    GASPI_SUCCESS_OR_RETURN
+      (gaspi_write ( description->segment_id_local_client_source
+                   , description->offset
+                   , description->receivers[0]
+                   , description->segment_ids_remote_on_receivers[0]
+                   , snapshot
+                   , description->size
+                   , description->queue
+                   , timeout_ms
+                   )
+       );
+
+  GASPI_SUCCESS_OR_RETURN
+    (gaspi_write_notify ( description->segment_id_compressed
+                        , 0
+                        , description->receivers[0]
+                        , description->segment_ids_remote_on_receivers[0]
+                        , snapshot + slot_size - block_size - header_size
+                        , block_size + header_size
+                        , notification_id
+                        , notification_value
+                        , description->queue
+                        , timeout_ms
+                        )
+     );
+
+  description->compressed_size = (delta ? block_size : description->size) + header_size;
+  description->delta_base_epoch = epoch;
+
+  return GASPI_SUCCESS;
+}
+
+/* receiver: turn the delta that arrived in snapshot into the data,
+   using the slot of its base epoch */
+static gaspi_return_t
+gpi_cp_apply_delta ( gpi_cp_description_t description
+                   , const gaspi_offset_t snapshot
+                   )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_delta_buffers (description));
+
+  gaspi_size_t const table_size = gpi_cp_delta_table_size (description->size);
+  gaspi_size_t const slot_size = gpi_cp_slot_size (description);
+  gaspi_size_t const header_size = sizeof (gpi_cp_delta_header_t);
+  char* const slot = (char*) gpi_cp_ptr (description->segment_id_local_for_sender, snapshot);
+
+  gpi_cp_delta_header_t header;
+  memcpy (&header, slot + slot_size - header_size, header_size);
+
+  if ( header.size != description->size
+     || header.chunk_size != GPI_CP_DELTA_CHUNK_SIZE
+     || header.payload > slot_size - header_size - table_size
+     )
+    {
+      fprintf (stderr, "Corrupt delta from %u\n", description->senders[0]);
+      return GASPI_ERROR;
+    }
+
+  // the data as it is
+  if (header.base_epoch == 0)
+    return GASPI_SUCCESS;
+
+  const char* base = NULL;
+  gaspi_number_t k;
+
+  for (k = 0; k < description->number_of_snapshots; ++k)
+    {
+      gaspi_offset_t const other = k * slot_size;
+
+      if ( other != snapshot
+         && *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                                         , gpi_cp_epoch_offset (description, 0, other)
+                                         ) == header.base_epoch
+         )
+        base = (const char*) gpi_cp_ptr (description->segment_id_local_for_sender, other);
+    }
+
+  if (base == NULL)
+    {
+      fprintf (stderr, "No base epoch %lu for the delta from %u\n"
+              , (unsigned long) header.base_epoch, description->senders[0]);
+      return GASPI_ERROR; //! \todo specific error code
+    }
+
+  const char* const block = slot + slot_size - header_size - table_size - header.payload;
+  memcpy (description->delta_table, block, table_size);
+
+  gaspi_size_t payload = 0;
+  gaspi_size_t done;
+  gaspi_number_t chunk = 0;
+
+  for (done = 0; done < description->size; done += GPI_CP_DELTA_CHUNK_SIZE, ++chunk)
+    {
+      gaspi_size_t const length =
+        MIN (description->size - done, (gaspi_size_t) GPI_CP_DELTA_CHUNK_SIZE);
+      uint32_t const entry = description->delta_table[chunk];
+      gaspi_size_t const encoded = entry & ~GPI_CP_COMPRESS_STORED;
+
+      if ( payload + encoded > header.payload
+         || gpi_cp_delta_apply_chunk ( slot + done
+                                     , base + done
+                                     , length
+                                     , block + table_size + payload
+                                     , entry
+                                     , header.element_size
+                                     , description->compression_scratch
+                                     )
+         )
+        {
+          fprintf (stderr, "Corrupt delta from %u\n", description->senders[0]);
+          return GASPI_ERROR;
+        }
+
+      payload += encoded;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+static gaspi_return_t
+gpi_cp_wait_for_notification_from ( const gaspi_segment_id_t segment_id_local_for_sender
+                                  , const gaspi_notification_id_t notification_id
+                                  , const gaspi_notification_t expected_value
+                                  , const gaspi_timeout_t timeout_ms
+                                  )
+{
+  // notifications of an aborted epoch may still be around after a
+  // restore, they carry an older epoch and are dropped
+  gaspi_notification_t value = 0;
+
+  while (value != expected_value)
+    {
+      gaspi_notification_id_t notifier;
+      GASPI_SUCCESS_OR_RETURN ( gaspi_notify_waitsome
+                          ( segment_id_local_for_sender
+                            , notification_id
+                            , (gaspi_number_t) 1
+                            , &notifier
+                            , timeout_ms
+                            )
+                          );
+
+      if (notifier != notification_id)
+      {
+        fprintf (stderr, "Unexpected notification\n");
+        return GASPI_ERROR; //! \todo specific error code
+      }
+
+      GASPI_SUCCESS_OR_RETURN( gaspi_notify_reset (segment_id_local_for_sender, notifier, &value) );
+    }
+
+  return GASPI_SUCCESS; //! \todo specific error code
+}
+
+/* the staging segment holds the map of our blocks and their hashes;
+   we remember the maps of the slots of our sender */
+static gaspi_return_t
+gpi_cp_block_buffers (gpi_cp_description_t description)
+{
+  if (description->slot_maps == NULL)
+    {
+      description->slot_maps =
+        calloc (description->number_of_snapshots, gpi_cp_block_map_size (description));
+
+      if (description->slot_maps == NULL)
+        return GASPI_ERROR;
+    }
+
+  return gpi_cp_staging_buffer
+    ( description
+    , gpi_cp_block_map_size (description)
+      + gpi_cp_number_of_blocks (description) * sizeof (uint64_t)
+    );
+}
+
+/* write the blocks of the snapshot of epoch that the receiver cannot
+   fill in itself into snapshot, adjacent ones at once, then the map,
+   notified. With deduplication our hashes go to our sender first and
+   we wait for those of our receiver. */
+static gaspi_return_t
+gpi_cp_write_blocks ( gpi_cp_description_t description
+                    , const gaspi_rank_t iProc
+                    , const gaspi_offset_t snapshot
+                    , const unsigned long epoch
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_block_buffers (description));
+
+  gaspi_number_t const number_of_blocks = gpi_cp_number_of_blocks (description);
+  gaspi_size_t const map_size = gpi_cp_block_map_size (description);
+  unsigned char* const map = (unsigned char*) gpi_cp_ptr (description->segment_id_compressed, 0);
+  uint64_t* const hashes = (uint64_t*) gpi_cp_ptr (description->segment_id_compressed, map_size);
+  const uint64_t* const peer_hashes = (const uint64_t*)
+    gpi_cp_ptr (description->segment_id_local_for_sender, gpi_cp_peer_hashes_offset (description));
+  const char* const data = (const char*)
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
+  gaspi_number_t b;
+
+  for (b = 0; b < number_of_blocks; ++b)
+    {
+      gaspi_size_t const begin = b * description->block_size;
+      gaspi_size_t const length = MIN (description->block_size, description->size - begin);
+
+      map[b] = gpi_cp_is_zero (data + begin, length) ? GPI_CP_BLOCK_ZERO : GPI_CP_BLOCK_SENT;
+
+      // never equal to the hash of a zero block, which is not sent
+      if (description->deduplicate)
+        hashes[b] = (map[b] == GPI_CP_BLOCK_ZERO) ? 0 : (gpi_cp_hash64 (data + begin, length) | 1);
+    }
+
+  if (description->deduplicate)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_write_notify ( description->segment_id_compressed
+                            , map_size
+                            , description->senders[0]
+                            , description->segment_ids_remote_on_senders[0]
+                            , gpi_cp_peer_hashes_offset (description)
+                            , number_of_blocks * sizeof (uint64_t)
+                            , gpi_cp_hashes_notification_id (description, iProc)
+                            , gpi_cp_notification_value (epoch)
+                            , description->queue
+                            , timeout_ms
+                            )
+         );
+
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_wait_for_notification_from ( description->segment_id_local_for_sender
+                                           , gpi_cp_hashes_notification_id (description, description->receivers[0])
+                                           , gpi_cp_notification_value (epoch)
+                                           , timeout_ms
+                                           )
+         );
+
+      /* equal hashes only, the bytes of the receiver are not here to
+         compare: a collision restores the wrong block (see
+         gpi_cp_set_block_elimination) */
+      for (b = 0; b < number_of_blocks; ++b)
+        {
+          if (map[b] == GPI_CP_BLOCK_SENT && hashes[b] == peer_hashes[b])
+            map[b] = GPI_CP_BLOCK_DUPLICATE;
+        }
+    }
+
+  gaspi_number_t queueSize, qmax;
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_size_max (&qmax));
+
+  for (b = 0; b < number_of_blocks;)
+    {
+      gaspi_size_t const begin = b * description->block_size;
+      gaspi_number_t end = b + 1;
+
+      if (map[b] != GPI_CP_BLOCK_SENT)
+        {
+          gaspi_size_t const length = MIN (description->block_size, description->size - begin);
+
+          if (map[b] == GPI_CP_BLOCK_ZERO)
+            description->zero_bytes_saved += length;
+          else
+            description->duplicate_bytes_saved += length;
+
+          b = end;
+          continue;
+        }
+
+      while (end < number_of_blocks && map[end] == GPI_CP_BLOCK_SENT)
+        ++end;
+
+      GASPI_SUCCESS_OR_RETURN (gaspi_queue_size (description->queue, &queueSize));
+      if (queueSize > qmax - 24)
+        GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_write ( description->segment_id_local_client_source
+                     , description->offset + begin
+                     , description->receivers[0]
+                     , description->segment_ids_remote_on_receivers[0]
+                     , snapshot + begin
+                     , MIN (end * description->block_size, description->size) - begin
+                     , description->queue
+                     , timeout_ms
+                     )
+         );
+
+      b = end;
+    }
+
+  return gaspi_write_notify ( description->segment_id_compressed
+                            , 0
+                            , description->receivers[0]
+                            , description->segment_ids_remote_on_receivers[0]
+                            , snapshot + gpi_cp_slot_size (description) - map_size
+                            , map_size
+                            , gpi_cp_notification_id (description, iProc, snapshot)
+                            , gpi_cp_notification_value (epoch)
+                            , description->queue
+                            , timeout_ms
+                            );
+}
+
+/* receiver: fill in the blocks of snapshot that were not sent, zeros
+   only where the slot does not hold them already */
+static gaspi_return_t
+gpi_cp_fill_blocks ( gpi_cp_description_t description
+                   , const gaspi_offset_t snapshot
+                   )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_block_buffers (description));
+
+  gaspi_number_t const number_of_blocks = gpi_cp_number_of_blocks (description);
+  gaspi_size_t const map_size = gpi_cp_block_map_size (description);
+  char* const slot = (char*) gpi_cp_ptr (description->segment_id_local_for_sender, snapshot);
+  const unsigned char* const map =
+    (const unsigned char*) slot + gpi_cp_slot_size (description) - map_size;
+  unsigned char* const known =
+    description->slot_maps + (snapshot / gpi_cp_slot_size (description)) * map_size;
+  const char* const data = (const char*)
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
+  gaspi_number_t b;
+
+  for (b = 0; b < number_of_blocks; ++b)
+    {
+      gaspi_size_t const begin = b * description->block_size;
+      gaspi_size_t const length = MIN (description->block_size, description->size - begin);
+
+      if (map[b] == GPI_CP_BLOCK_ZERO && known[b] != GPI_CP_BLOCK_ZERO)
+        memset (slot + begin, 0, length);
+      else if (map[b] == GPI_CP_BLOCK_DUPLICATE)
+        memcpy (slot + begin, data + begin, length);
+      else if (map[b] != GPI_CP_BLOCK_ZERO && map[b] != GPI_CP_BLOCK_SENT)
+        {
+          fprintf (stderr, "Corrupt block map from %u\n", description->senders[0]);
+          return GASPI_ERROR;
+        }
+
+      known[b] = map[b];
+    }
+
+  return GASPI_SUCCESS;
+}
+
+static gaspi_return_t
+gpi_cp_check_restored (const gpi_cp_description_t description)
+{
+  if (!description->checksums)
+    return GASPI_SUCCESS;
+
+  gpi_cp_checksum_record_t const * const record =
+    (gpi_cp_checksum_record_t*) gpi_cp_ptr
+      ( description->segment_id_local_for_sender
+      , gpi_cp_outgoing_record_offset (description)
+      );
+
+  if (record->checksum != gpi_cp_crc32c
+        ( 0
+        , gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+        , description->size
+        )
+     )
+    {
+      fprintf (stderr, "Checksum mismatch in restored snapshot\n");
+      return GASPI_ERROR; //! \todo specific error code
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* lazy restore: called from the fetching thread, through the staging
+   segment because the checkpoint region is not mapped yet */
+static const void*
+gpi_cp_lazy_fetch ( void* context
+                  , size_t offset
+                  , size_t length
+                  )
+{
+  gpi_cp_description_t const description = context;
+
+  if ( GASPI_SUCCESS != gaspi_read ( description->segment_id_staging
+                                   , 0
+                                   , description->receivers[0]
+                                   , description->segment_ids_remote_on_receivers[0]
+                                   , description->source_snapshot + offset
+                                   , length
+                                   , description->lazy_queue
+                                   , GASPI_BLOCK
+                                   )
+     || GASPI_SUCCESS != gaspi_wait (description->lazy_queue, GASPI_BLOCK)
+     )
+    return NULL;
+
+  return gpi_cp_ptr (description->segment_id_staging, 0);
+}
+
+static gaspi_return_t
+gpi_cp_start_lazy_restore (gpi_cp_description_t description)
+{
+  // the application keeps posting to its queue meanwhile
+  if (description->lazy_queue == description->queue)
+    {
+      fprintf (stderr, "Lazy restore needs a queue of its own\n");
+      return GASPI_ERROR;
+    }
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_get_unused_segment_id (&description->segment_id_staging));
+  GASPI_SUCCESS_OR_RETURN (gaspi_segment_alloc ( description->segment_id_staging
+                                               , GPI_CP_LAZY_CHUNK_SIZE
+                                               , GASPI_MEM_UNINITIALIZED
+                                               )
+                          );
+
+  description->lazy = gpi_cp_lazy_create
+    ( gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+    , description->size
+    , gpi_cp_lazy_fetch
+    , description
+    );
+
+  if (description->lazy == NULL)
+    {
+      gaspi_segment_delete (description->segment_id_staging);
+      return GASPI_ERROR;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* wait for a lazy restore, before the checkpoint region is sent or the
+   mirror of the receiver may change */
+static gaspi_return_t
+gpi_cp_finish_lazy_restore (gpi_cp_description_t description)
+{
+  if (description->lazy == NULL)
+    return GASPI_SUCCESS;
+
+  int const status = gpi_cp_lazy_wait (description->lazy);
+  description->lazy = NULL;
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_staging));
+
+  if (status != 0)
+    {
+      fprintf (stderr, "Lazy restore failed\n");
+      return GASPI_ERROR;
+    }
+
+  return gpi_cp_check_restored (description);
+}
+
+/* two generations per owner, so that a crash while writing epoch n
+   leaves epoch n-1 intact */
+static void
+gpi_cp_snapshot_file_name ( const gpi_cp_description_t description
+                          , const gaspi_rank_t owner
+                          , const unsigned long epoch
+                          , char* file_name
+                          )
+{
+  sprintf ( file_name, "%s/gpi_cp.%u.%lu.snapshot"
+          , description->persistent_path, owner, epoch % 2
+          );
+}
+
+#define GPI_CP_FILE_NAME_SIZE(description) (strlen ((description)->persistent_path) + 48)
+
+/* persistent copy of the snapshot of the sender, held in our mirror */
+static gaspi_return_t
+gpi_cp_post_drain ( gpi_cp_description_t description
+                  , const unsigned long epoch
+                  )
+{
+  char file_name[GPI_CP_FILE_NAME_SIZE (description)];
+  gpi_cp_snapshot_file_name
+    (description, description->senders[0], epoch, file_name);
+
+  gaspi_number_t group_size = 0;
+  gaspi_group_size (description->group, &group_size);
+
+  gpi_cp_snapshot_header_t header;
+  memset (&header, 0, sizeof (header));
+  header.epoch = epoch;
+  header.rank = description->senders[0];
+  header.group_size = group_size;
+  header.policy = description->policy;
+  header.size = description->size;
+
+  if (gpi_cp_drain_post ( description->drain
+                        , file_name
+                        , &header
+                        , (char*) gpi_cp_get_receiver_ptr (description)
+                          + description->committed_snapshot
+                        ) != 0
+     )
+    {
+      return GASPI_ERROR;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* newest valid snapshot of owner matching the description, 0 if none */
+static unsigned long
+gpi_cp_find_snapshot ( const gpi_cp_description_t description
+                     , const gaspi_rank_t owner
+                     )
+{
+  gaspi_number_t group_size = 0;
+  gaspi_group_size (description->group, &group_size);
+
+  unsigned long newest = 0;
+  unsigned long generation;
+
+  for (generation = 0; generation < 2; ++generation)
+    {
+      char file_name[GPI_CP_FILE_NAME_SIZE (description)];
+      gpi_cp_snapshot_file_name (description, owner, generation, file_name);
+
+      gpi_cp_snapshot_header_t header;
+
+      if ( gpi_cp_snapshot_read_header (file_name, &header) == 0
+         && header.rank == owner
+         && header.group_size == group_size
+         && header.policy == (uint32_t) description->policy
+         && header.size == description->size
+         && header.epoch % 2 == generation
+         )
+        {
+          newest = MAX (newest, (unsigned long) header.epoch);
+        }
+    }
+
+  return newest;
+}
+
+/* the epoch of the snapshot of the sender the mirror file holds in
+   its committed slot, e.g. from an earlier run; 0 if none */
+static unsigned long
+gpi_cp_find_mirror_snapshot (const gpi_cp_description_t description)
+{
+  gpi_cp_mirror_state_t state;
+
+  if (  description->mirror.data == NULL
+     || gpi_cp_mirror_read_state (&description->mirror, &state) != 0
+     || state.rank != description->senders[0]
+     || state.size != description->size
+     || state.number_of_snapshots != description->number_of_snapshots
+     || state.epoch == 0
+     || state.committed_snapshot != gpi_cp_epoch_snapshot (description, state.epoch)
+     )
+    {
+      return 0;
+    }
+
+  return state.epoch;
+}
+
+/* read the snapshot epoch of owner into data, 0 in case of success */
+static int
+gpi_cp_load_snapshot ( const gpi_cp_description_t description
+                     , const gaspi_rank_t owner
+                     , const unsigned long epoch
+                     , void* data
+                     )
+{
+  char file_name[GPI_CP_FILE_NAME_SIZE (description)];
+  gpi_cp_snapshot_file_name (description, owner, epoch, file_name);
+
+  gpi_cp_snapshot_header_t expected;
+  memset (&expected, 0, sizeof (expected));
+  expected.epoch = epoch;
+  expected.rank = owner;
+  expected.size = description->size;
+
+  return gpi_cp_snapshot_read (file_name, &expected, data);
+}
+
+static inline double
+gpi_cp_timeval_to_ms(struct timeval t)
+{
+  return (t.tv_sec * 1000.0) + ((t.tv_usec) / 1000.0);
+}
+
+
+/* the lazy agreement on the newest epoch committed on all ranks: an
+   allreduce every agreement_interval epochs, progressed by the
+   following commits without blocking */
+static gaspi_return_t
+gpi_cp_progress_agreement ( gpi_cp_description_t description
+                          , const gaspi_timeout_t timeout_ms
+                          )
+{
+  for (;;)
+    {
+      if (!description->agreement_in_progress)
+        {
+          // one at every multiple of the interval, the same number on
+          // all ranks: also those passed while the last one was running
+          unsigned long const next =
+            description->agreement_epoch + description->agreement_interval;
+
+          if (description->epoch < next)
+            return GASPI_SUCCESS;
+
+          description->agreement_epoch = next;
+          description->agreement_contribution = description->epoch;
+          description->agreement_in_progress = true;
+        }
+
+      gaspi_return_t const ret = gaspi_allreduce ( &description->agreement_contribution
+                                                 , &description->agreement_result
+                                                 , 1
+                                                 , GASPI_OP_MIN
+                                                 , GASPI_TYPE_ULONG
+                                                 , description->group
+                                                 , timeout_ms
+                                                 );
+      if (ret == GASPI_TIMEOUT)
+        return GASPI_SUCCESS;
+
+      description->agreement_in_progress = false;
+
+      GASPI_SUCCESS_OR_RETURN (ret);
+
+      description->global_epoch = description->agreement_result;
+    }
+}
+
+/* the first member lets the spares that were not needed go */
+static gaspi_return_t
+gpi_cp_release_spares ( const gpi_cp_description_t description
+                      , const gaspi_rank_t iProc
+                      , const gaspi_timeout_t timeout_ms
+                      )
+{
+  if (!description->spare_pool || description->members[0] != iProc)
+    return GASPI_SUCCESS;
+
+  gaspi_number_t i;
+  for (i = description->spares_used; i < description->number_of_spares; ++i)
+    {
+      gaspi_rank_t const spare = description->spares[i];
+
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_notify ( description->segment_id_local_for_sender
+                      , spare
+                      , gpi_cp_recruit_notification_id (description)
+                      , GPI_CP_RELEASED
+                      , description->queue
+                      , timeout_ms
+                      )
+         );
+    }
+
+  return gaspi_wait (description->queue, timeout_ms);
+}
+
+gaspi_return_t
+gpi_cp_finalize ( const gpi_cp_description_t description
+                , const gaspi_timeout_t timeout_ms
+                )
+{
+  /*   if( !description->state_initialized) */
+  /*     return GASPI_ERROR; */
+
+  /*   if( description->state_in_progress) */
+  /*     return GASPI_ERROR; */
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if(gpi_cp_is_in_group(description->group, iProc))
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+      // a running agreement occupies the group
+      if (description->agreement_in_progress)
+        GASPI_SUCCESS_OR_RETURN (gpi_cp_progress_agreement (description, timeout_ms));
+
+      // the last persistent copy must have made it
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+
+      if (description->drain != NULL)
+        {
+          gpi_cp_drain_destroy (description->drain);
+          description->drain = NULL;
+        }
+      if (description->verifier != NULL)
+        {
+          gpi_cp_verifier_destroy (description->verifier);
+          description->verifier = NULL;
+        }
+      if (description->copy_team != NULL)
+        {
+          gpi_cp_copy_team_destroy (description->copy_team);
+          description->copy_team = NULL;
+        }
+      free (description->persistent_path);
+      description->persistent_path = NULL;
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_release_spares (description, iProc, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_local_for_sender));
+
+      if (description->mirror.data != NULL)
+        gpi_cp_mirror_unmap (&description->mirror);
+      free (description->mirror_path);
+      description->mirror_path = NULL;
+
+      if (description->compressed_buffer_size > 0)
+        GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_compressed));
+      description->compressed_buffer_size = 0;
+      free (description->compression_scratch);
+      description->compression_scratch = NULL;
+      free (description->delta_previous);
+      description->delta_previous = NULL;
+      free (description->delta_table);
+      description->delta_table = NULL;
+      free (description->slot_maps);
+      description->slot_maps = NULL;
+      free (description->local_copies);
+      description->local_copies = NULL;
+      gpi_cp_registry_clear (&description->registry);
+
+#ifdef CP_STATS
+      double max_total[5] ={ 0.0f };
+      double total[5];
+
+      total[1] = gpi_cp_timeval_to_ms(description->in_start);
+      total[2] = gpi_cp_timeval_to_ms(description->in_init);
+      total[3] = gpi_cp_timeval_to_ms(description->in_commit);
+      total[4] = gpi_cp_timeval_to_ms(description->in_restore);
+      total[0] = total[1] + total[2] + total[3] + total[4];
+  
+      gaspi_printf("CP Stats (in ms): start %.4f init %.4f commit %.4f restore %.4f total %.4f\n",
+                 gpi_cp_timeval_to_ms(description->in_start),
+                 gpi_cp_timeval_to_ms(description->in_init),
+                 gpi_cp_timeval_to_ms(description->in_commit),
+                 gpi_cp_timeval_to_ms(description->in_restore),
+                 total[0]);
+
+      gaspi_allreduce(&total
+                    , &max_total
+                    , 5
+                    , GASPI_OP_MAX
+                    , GASPI_TYPE_DOUBLE
+                    , description->group
+                    , timeout_ms);
+
+      gaspi_rank_t myrank;
+      GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&myrank));
+      if( 0 == myrank )
+       printf("Max CP times: total %.4f, start  %.4f init  %.4f commit  %.4f restore %.4f \n",
+              max_total[0],
+              max_total[1],
+              max_total[2],
+              max_total[3],
+              max_total[4]);
+#endif
+    }
+  else if (description->spare)
+    {
+      // released from the pool
+      GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_local_for_sender));
+
+      if (description->mirror.data != NULL)
+        gpi_cp_mirror_unmap (&description->mirror);
+      free (description->mirror_path);
+      description->mirror_path = NULL;
+      description->spare = false;
+    }
+
+  free (description->members);
+  free (description->spares);
+  free (description->shadow_spares);
+  description->members = NULL;
+  description->spares = NULL;
+  description->shadow_spares = NULL;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_init ( const gaspi_segment_id_t segment_id_checkpoint
+            , const gaspi_offset_t offset
+            , const gaspi_size_t size
+            , const gaspi_queue_id_t queue
+            , const gpi_cp_policy_t policy
+            , const gaspi_group_t group
+            , gpi_cp_description_t description
+            , const gaspi_timeout_t timeout_ms
+            )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  description->offset = offset;
+  description->size = size;
+  description->segment_id_local_client_source = segment_id_checkpoint;
+  description->queue = queue;
+  description->group = group;
+  description->policy = policy;
+  description->active_snapshot = 0;
+  description->committed_snapshot = (description->number_of_snapshots - 1) * size;
+  description->state_commit_pending = false;
+  description->pending_corrupt = false;
+  
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_set_members (description, group));
+
+  if (description->spare_pool && description->shadows)
+    {
+      gaspi_number_t number_of_spares;
+      GASPI_SUCCESS_OR_RETURN (gaspi_group_size (description->spare_group, &number_of_spares));
+
+      description->shadow_capacity = (number_of_spares == 0) ? 0
+        : (description->number_of_members + number_of_spares - 1) / number_of_spares;
+    }
+
+  // with a spare pool all of its mirrors share their segment id
+  gaspi_group_t pool = description->group;
+
+  if ( description->spare_pool
+     && ( gpi_cp_is_in_group (description->group, iProc)
+        || gpi_cp_is_in_group (description->spare_group, iProc)
+        )
+     )
+    GASPI_SUCCESS_OR_RETURN (gpi_cp_pool_group (description, &pool, timeout_ms));
+
+  unsigned long epoch;
+
+  if(gpi_cp_is_in_group(description->group, iProc))
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_set_partners (description, policy, iProc));
+      description->committed_snapshot =
+        (description->number_of_snapshots - 1) * gpi_cp_slot_size (description);
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_start_drain (description));
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_start_verifier (description));
+
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_agree_mirror (description, pool, false, 0, &epoch, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN
+       ( gpi_cp_allocate_and_register_local_segment
+         ( description->segment_id_local_for_sender
+           , gpi_cp_segment_size (description)
+           , description->senders
+           , description->number_of_stripes
+           , description->mirror_path
+           , &description->mirror
+           , timeout_ms
+           )
+         );
+
+      gpi_cp_clear_epochs (description);
+
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_register_with_receivers (description, NULL, 0, timeout_ms));
+
+      gpi_cp_bind_result_t bound;
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_bind (description, false, epoch, 0, &bound, timeout_ms));
+       
+      description->state_initialized = true;
+    }
+  else if ( description->spare_pool
+          && gpi_cp_is_in_group (description->spare_group, iProc)
+          )
+    {
+      // a spare keeps an empty mirror of the same layout until it
+      // replaces a member, followed by its shadows
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_set_partners (description, policy, iProc));
+
+      description->spare = true;
+
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_agree_mirror (description, pool, false, 0, &epoch, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN
+       ( gpi_cp_allocate_and_register_local_segment
+         ( description->segment_id_local_for_sender
+           , gpi_cp_segment_size (description)
+           , NULL
+           , 0
+           , description->mirror_path
+           , &description->mirror
+           , timeout_ms
+           )
+         );
+
+      gpi_cp_clear_epochs (description);
+      gpi_cp_clear_shadow_epochs (description);
+
+      description->state_initialized = true;
+    }
+
+  if (description->spare_pool && description->state_initialized)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_bind_pool (description, pool, timeout_ms));
+      GASPI_SUCCESS_OR_RETURN (gaspi_group_delete (pool));
+    }
+/*       description_print(description); */
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_init.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_init.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+
+/* all of our data to the spare that shadows our position */
+static gaspi_return_t
+gpi_cp_write_shadow ( const gpi_cp_description_t description
+                    , const gaspi_rank_t iProc
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  gaspi_rank_t spare;
+  gaspi_number_t index;
+
+  if (!gpi_cp_shadow_spare ( description
+                           , gpi_cp_member_position ( description->members
+                                                    , description->number_of_members
+                                                    , iProc
+                                                    )
+                           , &spare
+                           , &index
+                           )
+     )
+    return GASPI_SUCCESS;
+
+  return gaspi_write ( description->segment_id_local_client_source
+                     , description->offset
+                     , spare
+                     , description->segment_id_local_for_sender
+                     , gpi_cp_shadow_offset (description, index, description->active_snapshot)
+                     , description->size
+                     , description->queue
+                     , timeout_ms
+                     );
+}
+
+/* the shadow of the snapshot in slot arrived complete: it is of epoch
+
+   the slot of an epoch that may be restored is not written again
+   before all ranks started a later one, so the epoch alone tells a
+   complete shadow */
+static gaspi_return_t
+gpi_cp_stamp_shadow ( const gpi_cp_description_t description
+                    , const gaspi_rank_t iProc
+                    , const gaspi_offset_t snapshot
+                    , const unsigned long epoch
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  gaspi_rank_t spare;
+  gaspi_number_t index;
+
+  if (!gpi_cp_shadow_spare ( description
+                           , gpi_cp_member_position ( description->members
+                                                    , description->number_of_members
+                                                    , iProc
+                                                    )
+                           , &spare
+                           , &index
+                           )
+     )
+    return GASPI_SUCCESS;
+
+  *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                               , gpi_cp_outgoing_shadow_epoch_offset (description)
+                               ) = epoch;
+
+  return gaspi_write ( description->segment_id_local_for_sender
+                     , gpi_cp_outgoing_shadow_epoch_offset (description)
+                     , spare
+                     , description->segment_id_local_for_sender
+                     , gpi_cp_shadow_epoch_offset (description, index, snapshot)
+                     , sizeof (unsigned long)
+                     , description->queue
+                     , timeout_ms
+                     );
+}
+
+/* keep the data of epoch in the local copy of its epoch, streamed
+   past the caches since it is only read by a rollback */
+static gaspi_return_t
+gpi_cp_keep_local_copy ( gpi_cp_description_t description
+                       , const unsigned long epoch
+                       )
+{
+  if (description->local_copies == NULL)
+    {
+      description->local_copies = malloc (description->number_of_snapshots * description->size);
+
+      if (description->local_copies == NULL)
+        return GASPI_ERROR;
+    }
+
+  gaspi_number_t const copy = epoch % description->number_of_snapshots;
+
+  gpi_cp_stream_copy ( (char*) description->local_copies + copy * description->size
+                     , gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+                     , description->size
+                     );
+
+  description->local_copy_epochs[copy] = epoch;
+
+  return GASPI_SUCCESS;
+}
+
+static gaspi_return_t
+gpi_cp_wait_for_queue_entries ( const gpi_cp_description_t description
+                              , const gaspi_timeout_t timeout_ms
+                              )
+{
+  gaspi_number_t queueSize, qmax;
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_size_max (&qmax));
+  GASPI_SUCCESS_OR_RETURN (gaspi_queue_size (description->queue, &queueSize));
+
+  if (queueSize > qmax - 24)
+    GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  return GASPI_SUCCESS;
+}
+
+static gaspi_return_t
+gpi_cp_start_copy_team (gpi_cp_description_t description)
+{
+  if (description->copy_team == NULL)
+    description->copy_team = gpi_cp_copy_team_create (description->copy_threads);
+
+  return (description->copy_team == NULL) ? GASPI_ERROR : GASPI_SUCCESS;
+}
+
+/* copy size bytes at data to the beginning of our data */
+static gaspi_return_t
+gpi_cp_copy_in ( gpi_cp_description_t description
+               , const void* data
+               , const gaspi_size_t size
+               )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_start_copy_team (description));
+
+  if (gpi_cp_copy_team_post ( description->copy_team
+                            , gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+                            , data
+                            , size
+                            ) != 0
+     )
+    {
+      return GASPI_ERROR;
+    }
+
+  while (gpi_cp_copy_team_next (description->copy_team) >= 0)
+    ;
+
+  return GASPI_SUCCESS;
+}
+
+/* write [begin, end) of our data to the receivers of the stripes it
+   falls into, without notification */
+static gaspi_return_t
+gpi_cp_write_range ( const gpi_cp_description_t description
+                   , const gaspi_offset_t begin
+                   , const gaspi_offset_t end
+                   , const gaspi_timeout_t timeout_ms
+                   )
+{
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      gaspi_offset_t const stripe_begin = gpi_cp_stripe_offset (description, j);
+      gaspi_offset_t const stripe_end = stripe_begin + gpi_cp_stripe_length (description, j);
+      gaspi_offset_t const first = (begin > stripe_begin) ? begin : stripe_begin;
+      gaspi_offset_t const last = (end < stripe_end) ? end : stripe_end;
+
+      if (first >= last)
+        continue;
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_for_queue_entries (description, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_write ( description->segment_id_local_client_source
+                     , description->offset + first
+                     , description->receivers[j]
+                     , description->segment_ids_remote_on_receivers[j]
+                     , description->active_snapshot + first
+                     , last - first
+                     , description->queue
+                     , timeout_ms
+                     )
+         );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* copy size bytes at data in with the team and write every chunk as
+   soon as it is copied, then notify the receivers: the notifications
+   follow the writes in the queue */
+static gaspi_return_t
+gpi_cp_copy_and_write ( gpi_cp_description_t description
+                      , const gaspi_rank_t iProc
+                      , const void* data
+                      , const gaspi_size_t size
+                      , const unsigned long epoch
+                      , const gaspi_timeout_t timeout_ms
+                      )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_start_copy_team (description));
+
+  if (gpi_cp_copy_team_post ( description->copy_team
+                            , gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+                            , data
+                            , size
+                            ) != 0
+     )
+    {
+      return GASPI_ERROR;
+    }
+
+  // the rest of our data is in place already
+  gaspi_return_t ret = GASPI_SUCCESS;
+
+  if (size < description->size)
+    ret = gpi_cp_write_range (description, size, description->size, timeout_ms);
+
+  long chunk;
+  while ((chunk = gpi_cp_copy_team_next (description->copy_team)) >= 0)
+    {
+      // the team finishes the copy in any case
+      if (ret != GASPI_SUCCESS)
+        continue;
+
+      gaspi_offset_t const begin = (gaspi_offset_t) chunk * GPI_CP_COPY_CHUNK_SIZE;
+      gaspi_offset_t const end =
+        (size - begin < GPI_CP_COPY_CHUNK_SIZE) ? size : begin + GPI_CP_COPY_CHUNK_SIZE;
+
+      ret = gpi_cp_write_range (description, begin, end, timeout_ms);
+    }
+
+  GASPI_SUCCESS_OR_RETURN (ret);
+
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_notify ( description->segment_ids_remote_on_receivers[j]
+                      , description->receivers[j]
+                      , gpi_cp_notification_id (description, iProc, description->active_snapshot)
+                      , gpi_cp_notification_value (epoch)
+                      , description->queue
+                      , timeout_ms
+                      )
+         );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* write the directory and the variables the active slot does not
+   hold yet, then notify the receivers */
+static gaspi_return_t
+gpi_cp_write_variables ( gpi_cp_description_t description
+                       , const gaspi_rank_t iProc
+                       , const unsigned long epoch
+                       , const gaspi_timeout_t timeout_ms
+                       )
+{
+  gaspi_number_t const slot = description->active_snapshot / gpi_cp_slot_size (description);
+  unsigned long const slot_epoch = description->variable_slot_epochs[slot];
+
+  // a failure leaves the slot partly written
+  description->variable_slot_epochs[slot] = 0;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_write_range ( description
+                        , 0
+                        , sizeof (gpi_cp_registry_header_t)
+                          + description->registry.count * sizeof (gpi_cp_registry_entry_t)
+                        , timeout_ms
+                        )
+     );
+
+  uint32_t i;
+  for (i = 0; i < description->registry.count; ++i)
+    {
+      const gpi_cp_variable_t* const variable = &description->registry.variables[i];
+
+      if (slot_epoch != 0 && variable->epoch <= slot_epoch)
+        continue;
+
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_write_range ( description
+                            , variable->offset
+                            , variable->offset + variable->size
+                            , timeout_ms
+                            )
+         );
+    }
+
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_notify ( description->segment_ids_remote_on_receivers[j]
+                      , description->receivers[j]
+                      , gpi_cp_notification_id (description, iProc, description->active_snapshot)
+                      , gpi_cp_notification_value (epoch)
+                      , description->queue
+                      , timeout_ms
+                      )
+         );
+    }
+
+  description->variable_slot_epochs[slot] = epoch;
+
+  return GASPI_SUCCESS;
+}
+
+/* gpi_cp_start, after copying size bytes at data in (data != NULL);
+   with variables only the registered variables are sent, if nothing
+   else needs the data complete */
+static gaspi_return_t
+gpi_cp_start_from ( gpi_cp_description_t description
+                  , const void* data
+                  , const gaspi_size_t size
+                  , const bool variables
+                  , const gaspi_timeout_t timeout_ms
+                  )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if(gpi_cp_is_in_group(description->group, iProc))
+    {
+      if (gpi_cp_get_state_in_progress (description) || size > description->size)
+       {
+         return GASPI_ERROR; //! \todo specific error code
+       }
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+      // the epoch of the snapshot, one ahead while the last one is pending
+      unsigned long const epoch = description->epoch + (description->state_commit_pending ? 2 : 1);
+
+      // the data as it is is sent while it is copied in, all else
+      // needs it complete
+      bool const overlap = data != NULL
+        && !description->checksums
+        && description->compression == 0
+        && description->block_size == 0
+        && description->delta == 0;
+      bool const variables_only = variables
+        && !description->checksums
+        && description->compression == 0
+        && description->block_size == 0
+        && description->delta == 0;
+
+      if (data != NULL && !overlap)
+       {
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_copy_in (description, data, size));
+       }
+
+      if (description->local_copy && !overlap)
+       {
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_keep_local_copy (description, epoch));
+       }
+
+      description->state_in_progress = true;
+
+/*       description_print(description); */
+      DEBUG_PRINT("gpi_cp_start: gaspi_write_notify(%i, %i, %i, %i, %i, %i, %i, %i, %i)\n",
+                 description->segment_id_local_client_source , description->offset, description->receivers[0],
+                 description->segment_ids_remote_on_receivers[0], description->active_snapshot, description->size,
+                 gpi_cp_notification_id (description, iProc, description->active_snapshot), gpi_cp_notification_value (epoch),
+                 description->queue);
+
+      gaspi_number_t queueSize, qmax;
+      GASPI_SUCCESS_OR_RETURN (gaspi_queue_size_max(&qmax));
+      gaspi_queue_size(description->queue, &queueSize);
+      if (queueSize > qmax - 24)
+       GASPI_SUCCESS_OR_RETURN (gaspi_wait(description->queue, timeout_ms));
+
+      if (description->checksums)
+       {
+         // the data, then its record, which carries the notification
+         gpi_cp_checksum_record_t* const record = (gpi_cp_checksum_record_t*)
+           gpi_cp_ptr ( description->segment_id_local_for_sender
+                      , gpi_cp_outgoing_record_offset (description)
+                      );
+
+         record->epoch = epoch;
+         record->checksum = gpi_cp_crc32c
+           ( 0
+           , gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+           , description->size
+           );
+
+         GASPI_SUCCESS_OR_RETURN
+           (gaspi_write ( description->segment_id_local_client_source
+                        , description->offset
+                        , description->receivers[0]
+                        , description->segment_ids_remote_on_receivers[0]
+                        , description->active_snapshot
+                        , description->size
+                        , description->queue
+                        , timeout_ms
+                        )
+            );
+
+         GASPI_SUCCESS_OR_RETURN
+           (gaspi_write_notify ( description->segment_id_local_for_sender
+                               , gpi_cp_outgoing_record_offset (description)
+                               , description->receivers[0]
+                               , description->segment_ids_remote_on_receivers[0]
+                               , gpi_cp_record_offset (description, description->active_snapshot)
+                               , sizeof (gpi_cp_checksum_record_t)
+                               , gpi_cp_notification_id (description, iProc, description->active_snapshot)
+                               , gpi_cp_notification_value (epoch)
+                               , description->queue
+                               , timeout_ms
+                               )
+            );
+       }
+      else if (description->compression > 0)
+       {
+         gaspi_return_t const ret =
+           gpi_cp_write_compressed ( description
+                                   , description->active_snapshot
+                                   , gpi_cp_notification_id (description, iProc, description->active_snapshot)
+                                   , gpi_cp_notification_value (epoch)
+                                   , timeout_ms
+                                   );
+
+         // nothing was notified, the epoch did not start
+         if (ret != GASPI_SUCCESS)
+           {
+             description->state_in_progress = false;
+             return ret;
+           }
+       }
+      else if (description->block_size > 0)
+       {
+         gaspi_return_t const ret =
+           gpi_cp_write_blocks (description, iProc, description->active_snapshot, epoch, timeout_ms);
+
+         // e.g. a timeout waiting for the hashes of the receiver
+         if (ret != GASPI_SUCCESS)
+           {
+             description->state_in_progress = false;
+             return ret;
+           }
+       }
+      else if (description->delta > 0)
+       {
+         GASPI_SUCCESS_OR_RETURN
+           (gpi_cp_write_delta ( description
+                               , description->active_snapshot
+                               , epoch
+                               , gpi_cp_notification_id (description, iProc, description->active_snapshot)
+                               , gpi_cp_notification_value (epoch)
+                               , timeout_ms
+                               )
+            );
+       }
+      else if (overlap)
+       {
+         GASPI_SUCCESS_OR_RETURN
+           (gpi_cp_copy_and_write (description, iProc, data, size, epoch, timeout_ms));
+       }
+      else if (variables_only)
+       {
+         GASPI_SUCCESS_OR_RETURN
+           (gpi_cp_write_variables (description, iProc, epoch, timeout_ms));
+       }
+      else
+       {
+         // stripe j to receiver j, the ring has one stripe
+         gaspi_number_t j;
+         for (j = 0; j < description->number_of_stripes; ++j)
+           {
+             gaspi_size_t const length = gpi_cp_stripe_length (description, j);
+
+             if (length == 0)
+              {
+                GASPI_SUCCESS_OR_RETURN
+                  (gaspi_notify ( description->segment_ids_remote_on_receivers[j]
+                                , description->receivers[j]
+                                , gpi_cp_notification_id (description, iProc, description->active_snapshot)
+                                , gpi_cp_notification_value (epoch)
+                                , description->queue
+                                , timeout_ms
+                                )
+                   );
+                continue;
+              }
+
+             GASPI_SUCCESS_OR_RETURN
+              (gaspi_write_notify (description->segment_id_local_client_source // segment_id_local
+                                 , description->offset + gpi_cp_stripe_offset (description, j) // offset_local
+                                 , description->receivers[j] // rank
+                                 , description->segment_ids_remote_on_receivers[j]
+                                 , description->active_snapshot + gpi_cp_stripe_offset (description, j) // offset_remote
+                                 , length // size
+                                 , gpi_cp_notification_id (description, iProc, description->active_snapshot) // notification_id
+                                 , gpi_cp_notification_value (epoch) // notification_value
+                                 , description->queue // queue
+                                 , timeout_ms
+                                 )
+               );
+           }
+       }
+
+      if (description->local_copy && overlap)
+       {
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_keep_local_copy (description, epoch));
+       }
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_write_shadow (description, iProc, timeout_ms));
+    }
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_start.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_start.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_start ( gpi_cp_description_t description
+             , const gaspi_timeout_t timeout_ms
+             )
+{
+  return gpi_cp_start_from (description, NULL, 0, false, timeout_ms);
+}
+
+gaspi_return_t
+gpi_cp_snapshot_copy ( gpi_cp_description_t description
+                     , const void* data
+                     , const gaspi_size_t size
+                     , const bool start
+                     , const gaspi_timeout_t timeout_ms
+                     )
+{
+  if (start)
+    return gpi_cp_start_from (description, data, size, false, timeout_ms);
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if (!gpi_cp_is_in_group (description->group, iProc))
+    return GASPI_SUCCESS;
+
+  // too much, or our data is being sent
+  if (size > description->size || gpi_cp_get_state_in_progress (description))
+    return GASPI_ERROR; //! \todo specific error code
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+  return gpi_cp_copy_in (description, data, size);
+}
+
+gaspi_return_t
+gpi_cp_checkpoint_variables ( gpi_cp_description_t description
+                            , const gaspi_timeout_t timeout_ms
+                            )
+{
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if (!gpi_cp_is_in_group (description->group, iProc))
+    return GASPI_SUCCESS;
+
+  // our data must not change while it is being sent
+  if (description->registry.count == 0 || gpi_cp_get_state_in_progress (description))
+    return GASPI_ERROR; //! \todo specific error code
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+  // the epoch gpi_cp_start_from sends
+  unsigned long const epoch = description->epoch + (description->state_commit_pending ? 2 : 1);
+
+  description->packed_size =
+    gpi_cp_registry_pack ( &description->registry
+                         , gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+                         , epoch
+                         );
+
+  return gpi_cp_start_from (description, NULL, 0, true, timeout_ms);
+}
+
+
+/* the pending epoch is dropped on all ranks, its slot becomes the
+   active one again and is sent anew; the committed slot is untouched */
+static gaspi_return_t
+gpi_cp_drop_pending (gpi_cp_description_t description)
+{
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                                   , gpi_cp_epoch_offset (description, j, description->pending_snapshot)
+                                   ) = 0;
+    }
+
+  description->active_snapshot = description->pending_snapshot;
+  description->state_commit_pending = false;
+
+  fprintf (stderr, "Snapshot %lu rejected\n", description->epoch + 1);
+
+  return GASPI_ERROR; //! \todo specific error code
+}
+
+/* with checksums the barrier of a commit is an allreduce of the
+   results of the checks of the pending snapshot: a mismatch anywhere
+   rejects the epoch everywhere, before it is committed */
+static gaspi_return_t
+gpi_cp_agree_on_checks ( gpi_cp_description_t description
+                       , const gaspi_timeout_t timeout_ms
+                       )
+{
+  // a mismatch is reported once, it is kept until the allreduce
+  // completed
+  if (gpi_cp_verifier_wait (description->verifier) != 0)
+    {
+      fprintf (stderr, "Checksum mismatch in snapshot of rank %u\n", description->senders[0]);
+      description->pending_corrupt = true;
+    }
+
+  unsigned long intact = !description->pending_corrupt;
+  unsigned long all_intact;
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_allreduce ( &intact
+                                           , &all_intact
+                                           , 1
+                                           , GASPI_OP_MIN
+                                           , GASPI_TYPE_ULONG
+                                           , description->group
+                                           , timeout_ms
+                                           )
+                          );
+
+  description->pending_corrupt = false;
+
+  return all_intact ? GASPI_SUCCESS : gpi_cp_drop_pending (description);
+}
+
+/* finish the global part of a commit: a barrier, or with the
+   neighbourhood commit the confirmations of the receivers
+
+   on GASPI_TIMEOUT the commit stays pending and is continued by the
+   next gpi_cp_commit
+*/
+static gaspi_return_t
+gpi_cp_commit_agree ( gpi_cp_description_t description
+                    , const gaspi_timeout_t timeout_ms
+                    )
+{
+  if (description->agreement_interval > 0)
+    {
+      // after a timeout we continue with the missing ones
+      while (description->acks_received < description->number_of_stripes)
+        {
+          gaspi_rank_t const receiver = description->receivers[description->acks_received];
+
+          GASPI_SUCCESS_OR_RETURN
+            (gpi_cp_wait_for_notification_from ( description->segment_id_local_for_sender
+                                               , gpi_cp_ack_notification_id ( description
+                                                                            , receiver
+                                                                            , description->pending_snapshot
+                                                                            )
+                                               , gpi_cp_notification_value (description->epoch + 1)
+                                               , timeout_ms
+                                               )
+             );
+
+          description->acks_received++;
+        }
+
+      description->acks_received = 0;
+      description->state_commit_pending = false;
+      description->epoch++;
+
+      return gpi_cp_progress_agreement (description, GASPI_TEST);
+    }
+
+  // the sender reuses the slot being drained once we passed the
+  // barrier; after a failed copy the commit stays pending
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+
+  if (description->verifier != NULL)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_agree_on_checks (description, timeout_ms));
+    }
+  else
+    {
+      GASPI_SUCCESS_OR_RETURN (gaspi_barrier (description->group, timeout_ms));
+    }
+
+  description->committed_snapshot = description->pending_snapshot;
+  description->state_commit_pending = false;
+  description->epoch++;
+  description->global_epoch = description->epoch;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_commit_mirror (description, description->epoch));
+
+  if (description->drain != NULL)
+    GASPI_SUCCESS_OR_RETURN (gpi_cp_post_drain (description, description->epoch));
+
+  return GASPI_SUCCESS;
+}
+
+/* neighbourhood commit: the stripes of the senders are complete, they
+   become the committed ones here and the senders may reuse the slot
+   of the previous ones */
+static gaspi_return_t
+gpi_cp_acknowledge ( gpi_cp_description_t description
+                   , const gaspi_rank_t iProc
+                   , const gaspi_timeout_t timeout_ms
+                   )
+{
+  // gpi_cp_commit waited for the copy of the committed snapshot
+  description->committed_snapshot = description->active_snapshot;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_commit_mirror (description, description->epoch + 1));
+
+  if (description->drain != NULL)
+    GASPI_SUCCESS_OR_RETURN (gpi_cp_post_drain (description, description->epoch + 1));
+
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_notify ( description->segment_ids_remote_on_senders[j]
+                      , description->senders[j]
+                      , gpi_cp_ack_notification_id (description, iProc, description->active_snapshot)
+                      , gpi_cp_notification_value (description->epoch + 1)
+                      , description->queue
+                      , timeout_ms
+                      )
+         );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_commit ( gpi_cp_description_t description
+              , const gaspi_timeout_t timeout_ms )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  
+  if(gpi_cp_is_in_group(description->group, iProc))
+    {
+      // global agreement on an earlier epoch is still outstanding
+      if (description->state_commit_pending)
+       {
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_commit_agree (description, timeout_ms));
+       }
+
+      if (description->state_in_progress)
+       {
+         // the check and the persistent copy of the previous snapshot
+         // ran in the background
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_verifier (description));
+
+         GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+         GASPI_SUCCESS_OR_RETURN
+           (gpi_cp_stamp_shadow ( description
+                                , iProc
+                                , description->active_snapshot
+                                , description->epoch + 1
+                                , timeout_ms
+                                )
+            );
+         
+         // one stripe from every sender; after a timeout we continue
+         // with the missing ones
+         while (description->stripes_received < description->number_of_stripes)
+           {
+             gaspi_rank_t const sender = description->senders[description->stripes_received];
+
+             GASPI_SUCCESS_OR_RETURN( gpi_cp_wait_for_notification_from ( description->segment_id_local_for_sender
+                                                          , gpi_cp_notification_id ( description
+                                                                                   , sender
+                                                                                   , description->active_snapshot
+                                                                                   )
+                                                          , gpi_cp_notification_value (description->epoch + 1)
+                                                          , timeout_ms
+                                                         )
+                                );
+
+             *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                                          , gpi_cp_epoch_offset ( description
+                                                                , description->stripes_received
+                                                                , description->active_snapshot
+                                                                )
+                                          ) = description->epoch + 1;
+             description->stripes_received++;
+           }
+
+         if (description->delta > 0)
+           {
+             GASPI_SUCCESS_OR_RETURN (gpi_cp_apply_delta (description, description->active_snapshot));
+           }
+
+         if (description->block_size > 0)
+           {
+             GASPI_SUCCESS_OR_RETURN (gpi_cp_fill_blocks (description, description->active_snapshot));
+           }
+
+         // the data is in the mapped file, make it persistent
+         if (  description->mirror.data != NULL
+            && gpi_cp_mirror_flush ( &description->mirror
+                                   , description->active_snapshot
+                                   , description->size
+                                   ) != 0
+            )
+           {
+             return GASPI_ERROR;
+           }
+
+         if (description->verifier != NULL)
+           {
+             gpi_cp_checksum_record_t const * const record =
+               (gpi_cp_checksum_record_t*) gpi_cp_ptr
+                 ( description->segment_id_local_for_sender
+                 , gpi_cp_record_offset (description, description->active_snapshot)
+                 );
+
+             if (record->epoch != description->epoch + 1)
+               {
+                 fprintf (stderr, "Unexpected snapshot epoch: %lu, %lu\n"
+                         , (unsigned long) record->epoch, description->epoch + 1);
+                 return GASPI_ERROR; //! \todo specific error code
+               }
+
+             gpi_cp_verifier_post ( description->verifier
+                                  , (char*) gpi_cp_get_receiver_ptr (description)
+                                    + description->active_snapshot
+                                  , description->size
+                                  , record
+                                  );
+           }
+
+         if (description->agreement_interval > 0)
+           {
+             GASPI_SUCCESS_OR_RETURN (gpi_cp_acknowledge (description, iProc, timeout_ms));
+           }
+
+         // local part done: the slot now only waits for the barrier
+         // (or the confirmations of the receivers)
+         description->pending_snapshot = description->active_snapshot;
+         description->active_snapshot = gpi_cp_next_snapshot (description, description->active_snapshot);
+         description->stripes_received = 0;
+         description->state_in_progress = false;
+         description->state_commit_pending = true;
+
+         GASPI_SUCCESS_OR_RETURN (gpi_cp_commit_agree (description, timeout_ms));
+       }
+    }
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_commit.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_commit.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_rollback ( gpi_cp_description_t description
+                , const gaspi_timeout_t timeout_ms
+                )
+{
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if (!gpi_cp_is_in_group (description->group, iProc))
+    return GASPI_SUCCESS;
+
+  if (!description->local_copy || gpi_cp_get_state_in_progress (description))
+    return GASPI_ERROR; //! \todo specific error code
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+  // a pending epoch is committed first, it may be complete elsewhere
+  if (description->state_commit_pending)
+    GASPI_SUCCESS_OR_RETURN (gpi_cp_commit_agree (description, timeout_ms));
+
+  // a running agreement occupies the group
+  if (description->agreement_in_progress)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_progress_agreement (description, timeout_ms));
+
+      if (description->agreement_in_progress)
+        return GASPI_TIMEOUT;
+    }
+
+  // the oldest of the consecutive epochs up to ours we have copies of
+  gaspi_number_t const n = description->number_of_snapshots;
+  unsigned long oldest = description->epoch + 1;
+
+  while (oldest > 1 && description->local_copy_epochs[(oldest - 1) % n] == oldest - 1)
+    --oldest;
+
+  // one allreduce: the newest epoch committed on all ranks and the
+  // oldest one kept on all ranks (negated)
+  long contribution[2] = { (long) description->epoch, -(long) oldest };
+  long result[2];
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_allreduce ( contribution
+                                           , result
+                                           , 2
+                                           , GASPI_OP_MIN
+                                           , GASPI_TYPE_LONG
+                                           , description->group
+                                           , timeout_ms
+                                           )
+                           );
+
+  // the same decision on all ranks
+  if (-result[1] > result[0])
+    return GASPI_ERROR;
+
+  unsigned long const epoch = (unsigned long) result[0];
+
+  memcpy ( gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+         , (char*) description->local_copies + (epoch % n) * description->size
+         , description->size
+         );
+
+  // our data no longer is what the slots were sent from
+  memset (description->variable_slot_epochs, 0, sizeof (description->variable_slot_epochs));
+
+  return GASPI_SUCCESS;
+}
+
+static bool
+gpi_cp_is_sender ( const gaspi_rank_t* senders
+                 , const gaspi_number_t number_of_senders
+                 , const gaspi_rank_t rank
+                 )
+{
+  gaspi_number_t j;
+  for (j = 0; j < number_of_senders; ++j)
+    {
+      if (senders[j] == rank)
+        return true;
+    }
+
+  return false;
+}
+
+/* write our stripes of the current epoch, found at offset in
+   segment_id, into the committed slot of the receivers j with
+   refill[j], then mark them as of the current epoch. Only committed
+   data: the checkpoint region of a joiner right after its restore, or
+   a local copy. */
+static gaspi_return_t
+gpi_cp_write_committed ( const gpi_cp_description_t description
+                       , const bool* const refill
+                       , const gaspi_segment_id_t segment_id
+                       , const gaspi_offset_t offset
+                       , const gaspi_timeout_t timeout_ms
+                       )
+{
+  gaspi_number_t j;
+
+  // the slot of the base epoch gets overwritten
+  description->delta_base_epoch = 0;
+  memset (description->variable_slot_epochs, 0, sizeof (description->variable_slot_epochs));
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (!refill[j])
+        continue;
+
+      if (description->compression > 0)
+        {
+          GASPI_SUCCESS_OR_RETURN
+            (gpi_cp_write_compressed (description, description->committed_snapshot, 0, 0, timeout_ms));
+        }
+      else if (gpi_cp_stripe_length (description, j) > 0)
+        {
+          GASPI_SUCCESS_OR_RETURN
+            ( gaspi_write ( segment_id
+                          , offset + gpi_cp_stripe_offset (description, j)
+                          , description->receivers[j]
+                          , description->segment_ids_remote_on_receivers[j]
+                          , description->committed_snapshot + gpi_cp_stripe_offset (description, j)
+                          , gpi_cp_stripe_length (description, j)
+                          , description->queue
+                          , timeout_ms
+                          )
+              );
+        }
+
+      if (description->checksums)
+        {
+          gpi_cp_checksum_record_t* const record = (gpi_cp_checksum_record_t*)
+            gpi_cp_ptr ( description->segment_id_local_for_sender
+                       , gpi_cp_outgoing_record_offset (description)
+                       );
+
+          record->epoch = description->epoch;
+          record->checksum = gpi_cp_crc32c
+            (0, gpi_cp_ptr (segment_id, offset), description->size);
+
+          GASPI_SUCCESS_OR_RETURN
+            ( gaspi_write ( description->segment_id_local_for_sender
+                          , gpi_cp_outgoing_record_offset (description)
+                          , description->receivers[j]
+                          , description->segment_ids_remote_on_receivers[j]
+                          , gpi_cp_record_offset (description, description->committed_snapshot)
+                          , sizeof (gpi_cp_checksum_record_t)
+                          , description->queue
+                          , timeout_ms
+                          )
+              );
+        }
+    }
+
+  // the epoch only once the data is there
+  GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (!refill[j])
+        continue;
+
+      *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                                   , gpi_cp_peer_epochs_offset (description, j)
+                                   ) = description->epoch;
+
+      GASPI_SUCCESS_OR_RETURN
+        ( gaspi_write ( description->segment_id_local_for_sender
+                      , gpi_cp_peer_epochs_offset (description, j)
+                      , description->receivers[j]
+                      , description->segment_ids_remote_on_receivers[j]
+                      , gpi_cp_epoch_offset (description, j, description->committed_snapshot)
+                      , sizeof (unsigned long)
+                      , description->queue
+                      , timeout_ms
+                      )
+          );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* the receivers j with forget[j] get no snapshot of ours before the
+   next checkpoint: the stamp of the slot it overwrites goes, so a
+   restore does not take a half written slot for the older epoch. A
+   receiver that joined (or changed) holds nothing of ours at all. */
+static gaspi_return_t
+gpi_cp_forget_receivers ( const gpi_cp_description_t description
+                        , const bool* const forget
+                        , const gpi_cp_bind_result_t* const bound
+                        , const gaspi_timeout_t timeout_ms
+                        )
+{
+  gaspi_number_t j;
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (!forget[j])
+        continue;
+
+      gaspi_offset_t const first = bound->receiver_joined[j] ? 0 : description->active_snapshot;
+      gaspi_number_t const count = bound->receiver_joined[j] ? description->number_of_snapshots : 1;
+      gaspi_offset_t const local = gpi_cp_peer_epochs_offset (description, j)
+        + (first / gpi_cp_slot_size (description)) * sizeof (unsigned long);
+
+      memset (gpi_cp_ptr (description->segment_id_local_for_sender, local), 0, count * sizeof (unsigned long));
+
+      GASPI_SUCCESS_OR_RETURN
+        ( gaspi_write ( description->segment_id_local_for_sender
+                      , local
+                      , description->receivers[j]
+                      , description->segment_ids_remote_on_receivers[j]
+                      , gpi_cp_epoch_offset (description, j, first)
+                      , count * sizeof (unsigned long)
+                      , description->queue
+                      , timeout_ms
+                      )
+          );
+    }
+
+  return gaspi_wait (description->queue, timeout_ms);
+}
+
+/* read the epochs receiver j keeps for our stripe in the slots from
+   slot 'first' on ('count' slots) */
+static gaspi_return_t
+gpi_cp_read_peer_epochs ( const gpi_cp_description_t description
+                        , const gaspi_number_t j
+                        , const gaspi_offset_t first
+                        , const gaspi_number_t count
+                        , const gaspi_timeout_t timeout_ms
+                        )
+{
+  gaspi_number_t const slot = first / gpi_cp_slot_size (description);
+
+  return gaspi_read ( description->segment_id_local_for_sender
+                    , gpi_cp_peer_epochs_offset (description, j) + slot * sizeof (unsigned long)
+                    , description->receivers[j]
+                    , description->segment_ids_remote_on_receivers[j]
+                    , gpi_cp_epoch_offset (description, j, first)
+                    , count * sizeof (unsigned long)
+                    , description->queue
+                    , timeout_ms
+                    );
+}
+
+static unsigned long
+gpi_cp_peer_epoch ( const gpi_cp_description_t description
+                  , const gaspi_number_t j
+                  , const gaspi_offset_t snapshot
+                  )
+{
+  return *(unsigned long*) gpi_cp_ptr
+    ( description->segment_id_local_for_sender
+    , gpi_cp_peer_epochs_offset (description, j)
+      + (snapshot / gpi_cp_slot_size (description)) * sizeof (unsigned long)
+    );
+}
+
+/* survivor: the mirror of a joiner is empty (unless it fills it from
+   its shadows). If our last epoch was not confirmed (or is older than
+   the current one) a receiver may not hold it complete either. Such
+   receivers get the data of the current epoch from the checkpoint
+   region if it holds that (restored), else from our local copy of it;
+   without one, only the next checkpoint gives them our data. */
+static gaspi_return_t
+gpi_cp_refill_receivers ( gpi_cp_description_t description
+                        , const gpi_cp_bind_result_t* const bound
+                        , const bool check
+                        , const bool restored
+                        , const gaspi_timeout_t timeout_ms
+                        )
+{
+  bool refill[GPI_CP_STRIPES_MAX];
+  gaspi_number_t j;
+
+  if (check)
+    {
+      for (j = 0; j < description->number_of_stripes; ++j)
+        {
+          if (!bound->receiver_joined[j])
+            GASPI_SUCCESS_OR_RETURN
+              (gpi_cp_read_peer_epochs (description, j, description->committed_snapshot, 1, timeout_ms));
+        }
+
+      GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+    }
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      refill[j] = bound->receiver_joined[j]
+        ? !bound->receiver_shadowed[j]
+        : (  check
+          && gpi_cp_peer_epoch (description, j, description->committed_snapshot)
+             != description->epoch
+          );
+    }
+
+  if (restored)
+    return gpi_cp_write_committed
+      ( description
+      , refill
+      , description->segment_id_local_client_source
+      , description->offset
+      , timeout_ms
+      );
+
+  gaspi_number_t const copy = description->epoch % description->number_of_snapshots;
+
+  //! \todo refill compressed snapshots from the local copy
+  if ( description->local_copies == NULL
+     || description->local_copy_epochs[copy] != description->epoch
+     || description->compression > 0
+     )
+    return gpi_cp_forget_receivers (description, refill, bound, timeout_ms);
+
+  // sent through the staging segment, the copy is not registered
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_staging_buffer (description, description->size));
+
+  memcpy ( gpi_cp_ptr (description->segment_id_compressed, 0)
+         , (char*) description->local_copies + copy * description->size
+         , description->size
+         );
+
+  return gpi_cp_write_committed
+    (description, refill, description->segment_id_compressed, 0, timeout_ms);
+}
+
+/* the shadow of the data of owner of epoch, if we keep it */
+static bool
+gpi_cp_find_shadow ( const gpi_cp_description_t description
+                   , const gaspi_rank_t iProc
+                   , const gaspi_rank_t owner
+                   , const unsigned long epoch
+                   , gaspi_offset_t* const shadow
+                   )
+{
+  gaspi_rank_t spare;
+  gaspi_number_t index, slot;
+
+  if ( epoch == 0
+     || !gpi_cp_shadow_index ( description
+                             , gpi_cp_member_position ( description->members
+                                                      , description->number_of_members
+                                                      , owner
+                                                      )
+                             , &spare
+                             , &index
+                             )
+     || spare != iProc
+     )
+    return false;
+
+  for (slot = 0; slot < description->number_of_snapshots; ++slot)
+    {
+      gaspi_offset_t const snapshot = slot * gpi_cp_slot_size (description);
+
+      if (*(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                                       , gpi_cp_shadow_epoch_offset (description, index, snapshot)
+                                       ) == epoch)
+        {
+          *shadow = gpi_cp_shadow_offset (description, index, snapshot);
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/* spare that joins: the bits of the senders whose stripes of epoch we
+   keep in shadows */
+static unsigned long
+gpi_cp_shadowed_senders ( const gpi_cp_description_t description
+                        , const gaspi_rank_t iProc
+                        , const unsigned long epoch
+                        )
+{
+  gaspi_rank_t spare;
+  gaspi_number_t index, j;
+  unsigned long shadowed = 0;
+
+  if (!gpi_cp_shadow_index ( description
+                           , gpi_cp_member_position ( description->members
+                                                    , description->number_of_members
+                                                    , iProc
+                                                    )
+                           , &spare
+                           , &index
+                           )
+     || spare != iProc
+     )
+    return 0;
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      gaspi_offset_t shadow;
+
+      if (gpi_cp_find_shadow (description, iProc, description->senders[j], epoch, &shadow))
+        shadowed |= 1UL << j;
+    }
+
+  return shadowed;
+}
+
+/* spare that joins: the stripes of the senders we keep in shadows go
+   into the committed slot of the mirror, the senders do not write
+   them */
+static void
+gpi_cp_fill_from_shadows ( const gpi_cp_description_t description
+                         , const gaspi_rank_t iProc
+                         , const gpi_cp_bind_result_t* const bound
+                         )
+{
+  gaspi_number_t j;
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      gaspi_offset_t shadow;
+
+      if ( !bound->sender_shadowed[j]
+         || !gpi_cp_find_shadow (description, iProc, description->senders[j], description->epoch, &shadow)
+         )
+        continue;
+
+      memcpy ( gpi_cp_ptr ( description->segment_id_local_for_sender
+                          , description->committed_snapshot + gpi_cp_stripe_offset (description, j)
+                          )
+             , gpi_cp_ptr ( description->segment_id_local_for_sender
+                          , shadow + gpi_cp_stripe_offset (description, j)
+                          )
+             , gpi_cp_stripe_length (description, j)
+             );
+
+      if (description->checksums)
+        {
+          gpi_cp_checksum_record_t* const record = (gpi_cp_checksum_record_t*)
+            gpi_cp_ptr ( description->segment_id_local_for_sender
+                       , gpi_cp_record_offset (description, description->committed_snapshot)
+                       );
+
+          record->epoch = description->epoch;
+          record->checksum = gpi_cp_crc32c
+            (0, gpi_cp_ptr (description->segment_id_local_for_sender, shadow), description->size);
+        }
+
+      *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                                   , gpi_cp_epoch_offset (description, j, description->committed_snapshot)
+                                   ) = description->epoch;
+    }
+}
+
+/* joiner: the stripes of the failed rank, of the newest epoch that all
+   its receivers hold complete. If that is not the current epoch, the
+   data goes back into the committed slot of the receivers, the next
+   checkpoint must not overwrite the only copy. */
+static gaspi_return_t
+gpi_cp_restore_joiner ( gpi_cp_description_t description
+                      , const gaspi_rank_t iProc
+                      , const gpi_cp_bind_result_t* const bound
+                      , const gaspi_timeout_t timeout_ms
+                      )
+{
+  gaspi_number_t j;
+  gaspi_number_t slot;
+  gaspi_offset_t shadow;
+
+  // a spare with the shadow of the current epoch has the data already,
+  // the receivers are only checked like by a survivor
+  if (gpi_cp_find_shadow (description, iProc, iProc, description->epoch, &shadow))
+    {
+      memcpy ( gpi_cp_ptr (description->segment_id_local_client_source, description->offset)
+             , gpi_cp_ptr (description->segment_id_local_for_sender, shadow)
+             , description->size
+             );
+
+      return gpi_cp_refill_receivers (description, bound, true, true, timeout_ms);
+    }
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (bound->receiver_joined[j])
+        {
+          fprintf (stderr, "Data lost: receiver %u joined as well\n", description->receivers[j]);
+          return GASPI_ERROR; //! \todo specific error code
+        }
+
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_read_peer_epochs (description, j, 0, description->number_of_snapshots, timeout_ms));
+    }
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  unsigned long restored = (unsigned long) -1;
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      unsigned long newest = 0;
+
+      for (slot = 0; slot < description->number_of_snapshots; ++slot)
+        newest = MAX (newest, gpi_cp_peer_epoch (description, j, slot * gpi_cp_slot_size (description)));
+
+      restored = MIN (restored, newest);
+    }
+
+  description->source_snapshot = gpi_cp_epoch_snapshot (description, restored);
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (  restored == 0
+         || gpi_cp_peer_epoch (description, j, description->source_snapshot) != restored
+         )
+        {
+          fprintf (stderr, "Data lost: no complete snapshot on %u\n", description->receivers[j]);
+          return GASPI_ERROR; //! \todo specific error code
+        }
+    }
+
+  bool const refill = restored != description->epoch;
+
+  // lazily: the pages arrive on first touch or in the background
+  if (description->compression > 0)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gpi_cp_read_compressed (description, description->source_snapshot, timeout_ms));
+    }
+  else if ( refill
+          || !description->lazy_restore
+          || gpi_cp_start_lazy_restore (description) != GASPI_SUCCESS
+          )
+    {
+      // the stripes of the failed rank, from all receivers at once
+      for (j = 0; j < description->number_of_stripes; ++j)
+        {
+          if (gpi_cp_stripe_length (description, j) == 0)
+            continue;
+
+          GASPI_SUCCESS_OR_RETURN
+            ( gpi_cp_read_chunked
+              ( description
+                , description->segment_id_local_client_source
+                , description->offset + gpi_cp_stripe_offset (description, j)
+                , description->receivers[j]
+                , description->segment_ids_remote_on_receivers[j]
+                , description->source_snapshot + gpi_cp_stripe_offset (description, j)
+                , gpi_cp_stripe_length (description, j)
+                , timeout_ms
+                )
+              );
+        }
+    }
+
+  if (description->checksums)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        ( gaspi_read ( description->segment_id_local_for_sender
+                     , gpi_cp_outgoing_record_offset (description)
+                     , description->receivers[0]
+                     , description->segment_ids_remote_on_receivers[0]
+                     , gpi_cp_record_offset (description, description->source_snapshot)
+                     , sizeof (gpi_cp_checksum_record_t)
+                     , description->queue
+                     , timeout_ms
+                     )
+          );
+    }
+
+  // a lazy restore is checked once complete
+  if (description->lazy != NULL)
+    return GASPI_SUCCESS;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_chunked (description, timeout_ms));
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_check_restored (description));
+
+  if (!refill)
+    return GASPI_SUCCESS;
+
+  bool all[GPI_CP_STRIPES_MAX];
+  for (j = 0; j < description->number_of_stripes; ++j)
+    all[j] = true;
+
+  return gpi_cp_write_committed
+    ( description
+    , all
+    , description->segment_id_local_client_source
+    , description->offset
+    , timeout_ms
+    );
+}
+
+/* rebind after a failure
+
+   the joiner takes the place of the failed rank in the group order:
+   its receivers hold the stripes of the failed rank (all of its data
+   with the ring), it reads them from all of them at once. What the
+   failed rank kept for its senders is lost, the senders write it again
+   from local memory.
+
+   Two allreduces of a fixed size: the first agrees on the segment id
+   of the mirrors, which the joiner takes, and on the epoch to
+   continue with, the newest one a survivor started; the second
+   follows the registration of the mirrors and spreads bitmaps of the
+   joiners and of the stripes they keep in shadows. Each slot keeps
+   the epoch of every stripe it holds complete, so the one to restore
+   is known even if the failure hit a commit. There are no passive
+   messages.
+*/
+static gaspi_return_t
+gpi_cp_rebind ( gpi_cp_description_t description
+              , const gaspi_rank_t iProc
+              , const gaspi_timeout_t timeout_ms
+              )
+{
+  bool const joiner = !description->state_initialized || description->spare;
+
+  gaspi_rank_t old_senders[GPI_CP_STRIPES_MAX];
+  gaspi_rank_t old_receivers[GPI_CP_STRIPES_MAX];
+  gaspi_number_t const number_of_old_partners = joiner ? 0 : description->number_of_stripes;
+  memcpy (old_senders, description->senders, sizeof (old_senders));
+  memcpy (old_receivers, description->receivers, sizeof (old_receivers));
+
+  // transfers of the aborted epoch must not arrive after the rebind
+  if (description->state_in_progress || description->state_commit_pending)
+    GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  // the last epoch we started to write, it is confirmed by the
+  // receivers only if the commit completed
+  unsigned long const started_epoch = description->epoch
+    + (description->state_commit_pending ? 1 : 0)
+    + (description->state_in_progress ? 1 : 0);
+  bool const unconfirmed =
+    description->state_commit_pending || description->state_in_progress;
+
+  description->state_commit_pending = false;
+  description->pending_corrupt = false;
+  description->acks_received = 0;
+  description->agreement_in_progress = false;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_set_partners (description, description->policy, iProc));
+
+  // a spare has its mirror since gpi_cp_init
+  unsigned long epoch;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_agree_mirror ( description
+                         , description->group
+                         , description->state_initialized
+                         , joiner ? 0 : started_epoch
+                         , &epoch
+                         , timeout_ms
+                         )
+     );
+
+  gaspi_number_t j;
+
+  if (joiner)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_start_drain (description));
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_start_verifier (description));
+
+      if (description->spare)
+        {
+          for (j = 0; j < description->number_of_stripes; ++j)
+            {
+              GASPI_SUCCESS_OR_RETURN
+                (gaspi_segment_register ( description->segment_id_local_for_sender
+                                        , description->senders[j]
+                                        , timeout_ms
+                                        )
+                 );
+            }
+        }
+      else
+        {
+          GASPI_SUCCESS_OR_RETURN
+           ( gpi_cp_allocate_and_register_local_segment
+             ( description->segment_id_local_for_sender
+               , gpi_cp_segment_size (description)
+               , description->senders
+               , description->number_of_stripes
+               , description->mirror_path
+               , &description->mirror
+               , timeout_ms
+               )
+             );
+        }
+
+      gpi_cp_clear_epochs (description);
+    }
+  else
+    {
+      for (j = 0; j < description->number_of_stripes; ++j)
+        {
+          if (!gpi_cp_is_sender (old_senders, number_of_old_partners, description->senders[j]))
+            {
+              GASPI_SUCCESS_OR_RETURN
+                (gaspi_segment_register ( description->segment_id_local_for_sender
+                                        , description->senders[j]
+                                        , timeout_ms
+                                        )
+                 );
+            }
+        }
+    }
+
+  GASPI_SUCCESS_OR_RETURN
+    ( gpi_cp_register_with_receivers ( description
+                                     , old_receivers
+                                     , number_of_old_partners
+                                     , timeout_ms
+                                     )
+      );
+
+  // a spare tells which of the stripes it keeps in shadows
+  unsigned long const shadowed = description->spare
+    ? gpi_cp_shadowed_senders (description, iProc, epoch)
+    : 0;
+
+  gpi_cp_bind_result_t bound;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_bind (description, joiner, epoch, shadowed, &bound, timeout_ms));
+
+  gpi_cp_adopt_epoch (description, bound.epoch);
+
+  if (joiner)
+    {
+      gpi_cp_fill_from_shadows (description, iProc, &bound);
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_restore_joiner (description, iProc, &bound, timeout_ms));
+    }
+  else
+    {
+      GASPI_SUCCESS_OR_RETURN
+        ( gpi_cp_refill_receivers ( description
+                                  , &bound
+                                  , unconfirmed || started_epoch < bound.epoch
+                                  , false
+                                  , timeout_ms
+                                  )
+          );
+    }
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_chunked (description, timeout_ms));
+
+  description->stripes_received = 0;
+  description->state_in_progress = false;
+  description->state_initialized = true;
+  description->spare = false;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_restore ( const gaspi_segment_id_t segment_id_checkpoint
+               , const gaspi_offset_t offset
+               , const gaspi_size_t size
+               , const gaspi_queue_id_t queue
+               , const gpi_cp_policy_t policy
+               , const gaspi_group_t new_group
+               , gpi_cp_description_t description
+               , const gaspi_timeout_t timeout_ms
+               )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  description->offset = offset;
+  description->size = size;
+  description->segment_id_local_client_source = segment_id_checkpoint;
+  description->queue = queue;
+  description->group = new_group;
+  description->policy = policy;
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+  // the mirror is about to change
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_verifier (description));
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_set_members (description, new_group));
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_rebind (description, iProc, timeout_ms));
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_restore.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_restore.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_block_redistribution ( const gaspi_rank_t failed
+                            , const gaspi_number_t failed_index
+                            , const gaspi_size_t size
+                            , const gaspi_number_t position
+                            , const gaspi_number_t number_of_survivors
+                            , gpi_cp_part_t* const part
+                            , void* context
+                            )
+{
+  const gpi_cp_part_t* const first = (const gpi_cp_part_t*) context;
+  gaspi_size_t const block = (size + number_of_survivors - 1) / number_of_survivors;
+  gaspi_offset_t const begin = MIN (position * block, size);
+
+  (void) failed;
+
+  part->offset = begin;
+  part->size = MIN (begin + block, size) - begin;
+  part->segment_id = first->segment_id;
+  part->segment_offset = first->segment_offset + failed_index * block;
+
+  return GASPI_SUCCESS;
+}
+
+/* read our part of the data of the member at position of the ring
+   (members), from its receivers, of the newest epoch they all hold
+   complete. present: by rank, false for ranks that are gone; NULL if
+   all are there */
+static gaspi_return_t
+gpi_cp_read_part ( const gpi_cp_description_t description
+                 , const gaspi_rank_t* members
+                 , const gaspi_number_t number_of_members
+                 , const gaspi_number_t position
+                 , const gpi_cp_part_t* const part
+                 , const bool* const present
+                 , const gaspi_timeout_t timeout_ms
+                 )
+{
+  gaspi_rank_t const owner = members[position];
+  gaspi_rank_t receivers[GPI_CP_STRIPES_MAX];
+  gaspi_number_t j, slot;
+
+  //! \todo parts of compressed snapshots
+  if (description->compression > 0)
+    return gpi_cp_option_conflict
+      ("Compression", "the parts of gpi_cp_restore_shrinking and gpi_cp_expand");
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      CP_SUCCESS_OR_RETURN (gpi_cp_receiver ( description->policy
+                                            , members
+                                            , number_of_members
+                                            , owner
+                                            , j + 1
+                                            , &receivers[j]
+                                            )
+                           );
+
+      if (present != NULL && !present[receivers[j]])
+        {
+          fprintf (stderr, "Data lost: receiver %u of %u is gone\n", receivers[j], owner);
+          return GASPI_ERROR; //! \todo specific error code
+        }
+
+      // the epochs of its stripe j, in our buffer for those of our
+      // receivers
+      GASPI_SUCCESS_OR_RETURN
+        ( gaspi_read ( description->segment_id_local_for_sender
+                     , gpi_cp_peer_epochs_offset (description, j)
+                     , receivers[j]
+                     , description->segment_id_local_for_sender
+                     , gpi_cp_epoch_offset (description, j, 0)
+                     , description->number_of_snapshots * sizeof (unsigned long)
+                     , description->queue
+                     , timeout_ms
+                     )
+          );
+    }
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  unsigned long restored = (unsigned long) -1;
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      unsigned long newest = 0;
+
+      for (slot = 0; slot < description->number_of_snapshots; ++slot)
+        newest = MAX (newest, gpi_cp_peer_epoch (description, j, slot * gpi_cp_slot_size (description)));
+
+      restored = MIN (restored, newest);
+    }
+
+  gaspi_offset_t const snapshot = gpi_cp_epoch_snapshot (description, restored);
+
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (restored == 0 || gpi_cp_peer_epoch (description, j, snapshot) != restored)
+        {
+          fprintf (stderr, "Data lost: no complete snapshot of %u on %u\n", owner, receivers[j]);
+          return GASPI_ERROR; //! \todo specific error code
+        }
+    }
+
+  if (part->offset + part->size > description->size)
+    {
+      fprintf (stderr, "Part beyond the data of %u\n", owner);
+      return GASPI_ERROR;
+    }
+
+  // a stripe lies in the slot where it lies in the data
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      gaspi_offset_t const begin =
+        MAX (part->offset, gpi_cp_stripe_offset (description, j));
+      gaspi_offset_t const end =
+        MIN ( part->offset + part->size
+            , gpi_cp_stripe_offset (description, j) + gpi_cp_stripe_length (description, j)
+            );
+
+      if (begin >= end)
+        continue;
+
+      GASPI_SUCCESS_OR_RETURN
+        ( gpi_cp_read_chunked ( description
+                              , part->segment_id
+                              , part->segment_offset + (begin - part->offset)
+                              , receivers[j]
+                              , description->segment_id_local_for_sender
+                              , snapshot + begin
+                              , end - begin
+                              , timeout_ms
+                              )
+          );
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* shrinking restore
+
+   the receivers of failed members register their mirrors with all
+   survivors, one allreduce agrees on the epoch (the mirrors share
+   their segment id). Every survivor reads its parts, directly from
+   those mirrors. After a
+   barrier nobody reads the old mirrors any more: the description
+   starts over on the survivors, in the old ring order, with the new
+   layout, and every survivor writes its data to its new receivers.
+*/
+gaspi_return_t
+gpi_cp_restore_shrinking ( const gaspi_segment_id_t segment_id_checkpoint
+                         , const gaspi_offset_t offset
+                         , const gaspi_size_t size
+                         , const gaspi_queue_id_t queue
+                         , const gaspi_group_t new_group
+                         , gpi_cp_redistribution_t redistribution
+                         , void* context
+                         , gpi_cp_description_t description
+                         , const gaspi_timeout_t timeout_ms
+                         )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  if (!description->state_initialized || description->spare_pool)
+    return GASPI_ERROR;
+
+  gaspi_rank_t iProc, nProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_num (&nProc));
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_verifier (description));
+
+  // transfers of the aborted epoch must not arrive later
+  if (description->state_in_progress || description->state_commit_pending)
+    GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+  unsigned long const started_epoch = description->epoch
+    + (description->state_commit_pending ? 1 : 0)
+    + (description->state_in_progress ? 1 : 0);
+
+  // the survivors in the order of the old ring
+  gaspi_number_t number_of_survivors;
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_size (new_group, &number_of_survivors));
+
+  gaspi_rank_t* const survivors = malloc (number_of_survivors * sizeof (gaspi_rank_t));
+
+  if (survivors == NULL)
+    return GASPI_ERROR;
+
+  gaspi_return_t ret = gaspi_group_ranks (new_group, survivors);
+  gaspi_number_t i, n = 0;
+
+  qsort (survivors, number_of_survivors, sizeof (gaspi_rank_t), gpi_cp_compare_ranks);
+
+  bool* const survived = calloc (nProc, sizeof (bool));
+
+  if (survived == NULL)
+    ret = GASPI_ERROR;
+
+  for (i = 0; i < number_of_survivors && ret == GASPI_SUCCESS; ++i)
+    survived[survivors[i]] = true;
+
+  for (i = 0; i < description->number_of_members && ret == GASPI_SUCCESS; ++i)
+    {
+      if (survived[description->members[i]])
+        survivors[n++] = description->members[i];
+    }
+
+  if (ret == GASPI_SUCCESS && n != number_of_survivors)
+    {
+      fprintf (stderr, "Only survivors can shrink, joiners restore\n");
+      ret = GASPI_ERROR;
+    }
+
+  // the data of a failed sender in our mirror is read by all
+  gaspi_number_t j;
+  bool keeps_failed = false;
+
+  for (j = 0; j < description->number_of_stripes && ret == GASPI_SUCCESS; ++j)
+    keeps_failed = keeps_failed || !survived[description->senders[j]];
+
+  for (i = 0; i < n && keeps_failed && ret == GASPI_SUCCESS; ++i)
+    {
+      if (survivors[i] != iProc)
+        ret = gaspi_segment_register ( description->segment_id_local_for_sender
+                                     , survivors[i]
+                                     , timeout_ms
+                                     );
+    }
+
+  // after it all mirrors to read from are registered
+  unsigned long epoch = 0;
+
+  if (ret == GASPI_SUCCESS)
+    ret = gpi_cp_agree_mirror (description, new_group, true, started_epoch, &epoch, timeout_ms);
+
+  // our parts, all at once
+  gaspi_number_t failed_index = 0;
+  gaspi_number_t const position =
+    gpi_cp_member_position (survivors, n, iProc);
+
+  for (i = 0; i < description->number_of_members && ret == GASPI_SUCCESS; ++i)
+    {
+      if (survived[description->members[i]])
+        continue;
+
+      gpi_cp_part_t part;
+      memset (&part, 0, sizeof (part));
+
+      ret = redistribution ( description->members[i]
+                           , failed_index++
+                           , description->size
+                           , position
+                           , n
+                           , &part
+                           , context
+                           );
+
+      if (ret == GASPI_SUCCESS)
+        ret = gpi_cp_read_part ( description
+                               , description->members
+                               , description->number_of_members
+                               , i
+                               , &part
+                               , survived
+                               , timeout_ms
+                               );
+    }
+
+  free (survived);
+
+  if (ret == GASPI_SUCCESS)
+    ret = gpi_cp_wait_chunked (description, timeout_ms);
+
+  // all parts arrived everywhere, the old mirrors can go
+  if (ret == GASPI_SUCCESS)
+    ret = gaspi_barrier (new_group, timeout_ms);
+
+  if (ret != GASPI_SUCCESS)
+    {
+      free (survivors);
+      return ret;
+    }
+
+  free (description->members);
+  description->members = survivors;
+  description->number_of_members = n;
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_segment_delete (description->segment_id_local_for_sender));
+
+  if (description->mirror.data != NULL)
+    gpi_cp_mirror_unmap (&description->mirror);
+
+  // start over with the new layout, the local copies are of the old
+  free (description->local_copies);
+  description->local_copies = NULL;
+  memset (description->local_copy_epochs, 0, sizeof (description->local_copy_epochs));
+
+  description->offset = offset;
+  description->size = size;
+  description->segment_id_local_client_source = segment_id_checkpoint;
+  description->queue = queue;
+  description->group = new_group;
+  description->stripes_received = 0;
+  description->state_in_progress = false;
+  description->state_commit_pending = false;
+  description->pending_corrupt = false;
+  description->acks_received = 0;
+  description->agreement_in_progress = false;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_set_partners (description, description->policy, iProc));
+
+  GASPI_SUCCESS_OR_RETURN
+   ( gpi_cp_allocate_and_register_local_segment
+     ( description->segment_id_local_for_sender
+       , gpi_cp_segment_size (description)
+       , description->senders
+       , description->number_of_stripes
+       , description->mirror_path
+       , &description->mirror
+       , timeout_ms
+       )
+     );
+
+  gpi_cp_clear_epochs (description);
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_register_with_receivers (description, NULL, 0, timeout_ms));
+
+  gpi_cp_bind_result_t bound;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_bind (description, false, epoch, 0, &bound, timeout_ms));
+
+  gpi_cp_adopt_epoch (description, bound.epoch);
+
+  // no receiver holds anything of ours until the next checkpoint: the
+  // data with the part is no committed snapshot yet
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_restore.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_restore.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+/* expansion
+
+   one allgather over the new group tells the position of every member
+   in the old ring and who is new, the new ranks need the whole ring;
+   they follow the members, in rank order, and take the segment id of
+   the mirrors (gpi_cp_agree_mirror). The size, and so the layout, stays: a member keeps its
+   mirror, forgets the stripes of senders that changed and refills the
+   receivers that changed, a new rank gets a mirror and writes all of
+   its data. With a redistribution the new ranks read their parts
+   before, from the receivers in the old ring, which nobody writes to
+   until a barrier.
+*/
+gaspi_return_t
+gpi_cp_expand ( const gaspi_segment_id_t segment_id_checkpoint
+              , const gaspi_offset_t offset
+              , const gaspi_size_t size
+              , const gaspi_queue_id_t queue
+              , const gpi_cp_policy_t policy
+              , const gaspi_group_t new_group
+              , gpi_cp_redistribution_t redistribution
+              , void* context
+              , gpi_cp_description_t description
+              , const gaspi_timeout_t timeout_ms
+              )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  bool const joiner = !description->state_initialized;
+
+  if (  description->spare_pool
+     || (!joiner && (size != description->size || policy != description->policy))
+     )
+    return GASPI_ERROR;
+
+  gaspi_rank_t iProc, nProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_num (&nProc));
+
+  gaspi_rank_t old_senders[GPI_CP_STRIPES_MAX];
+  gaspi_rank_t old_receivers[GPI_CP_STRIPES_MAX];
+  gaspi_number_t const number_of_old_partners = joiner ? 0 : description->number_of_stripes;
+  memcpy (old_senders, description->senders, sizeof (old_senders));
+  memcpy (old_receivers, description->receivers, sizeof (old_receivers));
+
+  unsigned long started_epoch = 0;
+  bool unconfirmed = false;
+
+  if (!joiner)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_verifier (description));
+
+      // transfers of the aborted epoch must not arrive later
+      if (description->state_in_progress || description->state_commit_pending)
+        GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+      started_epoch = description->epoch
+        + (description->state_commit_pending ? 1 : 0)
+        + (description->state_in_progress ? 1 : 0);
+      unconfirmed =
+        description->state_commit_pending || description->state_in_progress;
+    }
+
+  // the old ring, then the new ranks
+  gaspi_number_t n;
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_size (new_group, &n));
+
+  gaspi_rank_t* const members = malloc (n * sizeof (gaspi_rank_t));
+  unsigned long* const infos = malloc (nProc * sizeof (unsigned long));
+
+  if (members == NULL || infos == NULL)
+    {
+      free (members);
+      free (infos);
+      return GASPI_ERROR;
+    }
+
+  gaspi_return_t ret =
+    gpi_cp_allgather ( new_group
+                     , GPI_CP_BIND_PRESENT
+                       | ( joiner
+                         ? GPI_CP_BIND_JOINER
+                         : (unsigned long) gpi_cp_member_position ( description->members
+                                                                  , description->number_of_members
+                                                                  , iProc
+                                                                  )
+                         )
+                     , infos
+                     , timeout_ms
+                     );
+
+  gaspi_number_t number_of_old_members = 0;
+  gaspi_number_t number_of_new_ranks = 0;
+  gaspi_rank_t rank;
+
+  for (rank = 0; rank < nProc && ret == GASPI_SUCCESS; ++rank)
+    {
+      if ((infos[rank] & GPI_CP_BIND_PRESENT) && !(infos[rank] & GPI_CP_BIND_JOINER))
+        ++number_of_old_members;
+    }
+
+  for (rank = 0; rank < nProc && ret == GASPI_SUCCESS; ++rank)
+    {
+      if (!(infos[rank] & GPI_CP_BIND_PRESENT))
+        continue;
+
+      if (infos[rank] & GPI_CP_BIND_JOINER)
+        {
+          members[number_of_old_members + number_of_new_ranks++] = rank;
+        }
+      else if ((infos[rank] & ~GPI_CP_BIND_PRESENT) < number_of_old_members)
+        {
+          members[infos[rank] & ~GPI_CP_BIND_PRESENT] = rank;
+        }
+      else
+        {
+          fprintf (stderr, "Only members and new ranks can expand\n");
+          ret = GASPI_ERROR;
+        }
+    }
+
+  free (infos);
+
+  if (ret == GASPI_SUCCESS && (number_of_old_members == 0 || number_of_new_ranks == 0))
+    ret = GASPI_ERROR;
+
+  if (ret != GASPI_SUCCESS)
+    {
+      free (members);
+      return ret;
+    }
+
+  free (description->members);
+  description->members = members;
+  description->number_of_members = n;
+  description->group = new_group;
+
+  if (joiner)
+    {
+      description->offset = offset;
+      description->size = size;
+      description->segment_id_local_client_source = segment_id_checkpoint;
+      description->queue = queue;
+      description->policy = policy;
+    }
+
+  description->state_in_progress = false;
+  description->state_commit_pending = false;
+  description->pending_corrupt = false;
+  description->acks_received = 0;
+  description->agreement_in_progress = false;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_set_partners (description, description->policy, iProc));
+
+  unsigned long epoch;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_agree_mirror (description, new_group, !joiner, started_epoch, &epoch, timeout_ms));
+
+  gaspi_number_t j, slot;
+
+  if (joiner)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_start_drain (description));
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_start_verifier (description));
+
+      GASPI_SUCCESS_OR_RETURN
+       ( gpi_cp_allocate_and_register_local_segment
+         ( description->segment_id_local_for_sender
+           , gpi_cp_segment_size (description)
+           , description->senders
+           , description->number_of_stripes
+           , description->mirror_path
+           , &description->mirror
+           , timeout_ms
+           )
+         );
+
+      gpi_cp_clear_epochs (description);
+    }
+  else
+    {
+      for (j = 0; j < description->number_of_stripes; ++j)
+        {
+          if (!gpi_cp_is_sender (old_senders, number_of_old_partners, description->senders[j]))
+            {
+              GASPI_SUCCESS_OR_RETURN
+                (gaspi_segment_register ( description->segment_id_local_for_sender
+                                        , description->senders[j]
+                                        , timeout_ms
+                                        )
+                 );
+            }
+        }
+    }
+
+  GASPI_SUCCESS_OR_RETURN
+    ( gpi_cp_register_with_receivers ( description
+                                     , old_receivers
+                                     , number_of_old_partners
+                                     , timeout_ms
+                                     )
+      );
+
+  // the new ranks read from the mirrors of the members
+  gaspi_number_t i;
+
+  for (i = number_of_old_members; i < n && redistribution != NULL && !joiner; ++i)
+    {
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_segment_register ( description->segment_id_local_for_sender
+                                , description->members[i]
+                                , timeout_ms
+                                )
+         );
+    }
+
+  gpi_cp_bind_result_t bound;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gpi_cp_bind (description, joiner, epoch, 0, &bound, timeout_ms));
+
+  gpi_cp_adopt_epoch (description, bound.epoch);
+
+  if (redistribution != NULL)
+    {
+      gaspi_number_t const position =
+        gpi_cp_member_position (description->members, n, iProc) - number_of_old_members;
+
+      for (i = 0; i < number_of_old_members && joiner && ret == GASPI_SUCCESS; ++i)
+        {
+          gpi_cp_part_t part;
+          memset (&part, 0, sizeof (part));
+
+          ret = redistribution ( description->members[i]
+                               , i
+                               , description->size
+                               , position
+                               , number_of_new_ranks
+                               , &part
+                               , context
+                               );
+
+          if (ret == GASPI_SUCCESS && part.size > 0)
+            ret = gpi_cp_read_part ( description
+                                   , description->members
+                                   , number_of_old_members
+                                   , i
+                                   , &part
+                                   , NULL
+                                   , timeout_ms
+                                   );
+        }
+
+      if (ret == GASPI_SUCCESS)
+        ret = gpi_cp_wait_chunked (description, timeout_ms);
+
+      if (ret == GASPI_SUCCESS)
+        ret = gaspi_barrier (new_group, timeout_ms);
+
+      GASPI_SUCCESS_OR_RETURN (ret);
+    }
+
+  // a joiner has no committed snapshot, its receivers get its data
+  // (with the parts) with the next checkpoint
+  if (!joiner)
+    {
+      for (j = 0; j < description->number_of_stripes; ++j)
+        {
+          if (old_senders[j] == description->senders[j])
+            continue;
+
+          // stripe j of another sender from now on, a member refills
+          // the committed slot (or clears its stamp), a new rank has
+          // nothing committed yet
+          bool const new_sender =
+            gpi_cp_member_position (description->members, n, description->senders[j])
+            >= number_of_old_members;
+
+          for (slot = 0; slot < description->number_of_snapshots; ++slot)
+            {
+              gaspi_offset_t const snapshot = slot * gpi_cp_slot_size (description);
+
+              if (new_sender || snapshot != description->committed_snapshot)
+                *(unsigned long*) gpi_cp_ptr
+                  ( description->segment_id_local_for_sender
+                  , gpi_cp_epoch_offset (description, j, snapshot)
+                  ) = 0;
+            }
+        }
+
+      // a receiver that changed holds nothing of ours
+      for (j = 0; j < description->number_of_stripes; ++j)
+        {
+          if (old_receivers[j] != description->receivers[j])
+            bound.receiver_joined[j] = true;
+        }
+
+      GASPI_SUCCESS_OR_RETURN
+        ( gpi_cp_refill_receivers ( description
+                                  , &bound
+                                  , unconfirmed || started_epoch < bound.epoch
+                                  , false
+                                  , timeout_ms
+                                  )
+          );
+    }
+
+  description->stripes_received = 0;
+  description->state_initialized = true;
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_restore.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_restore.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+/* add the members GASPI reports as failed */
+static gaspi_return_t
+gpi_cp_update_failed ( const gpi_cp_description_t description
+                     , unsigned long* const failed
+                     )
+{
+  gaspi_rank_t nProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_num (&nProc));
+
+  unsigned char state[nProc];
+  GASPI_SUCCESS_OR_RETURN (gaspi_state_vec_get (state));
+
+  gaspi_number_t i;
+  for (i = 0; i < description->number_of_members; ++i)
+    {
+      if (state[description->members[i]] == GASPI_STATE_CORRUPT)
+        gpi_cp_set_bit (failed, description->members[i]);
+    }
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_heartbeat ( gpi_cp_description_t description
+                 , const gaspi_timeout_t timeout_ms
+                 )
+{
+  gaspi_rank_t iProc, nProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_num (&nProc));
+
+  if ( !description->spare_pool
+     || !description->state_initialized
+     || description->spare
+     )
+    return GASPI_ERROR;
+
+  // another member started gpi_cp_recover
+  gaspi_notification_id_t first;
+  if ( GASPI_SUCCESS == gaspi_notify_waitsome ( description->segment_id_local_for_sender
+                                              , gpi_cp_view_notification_id (description, 0, 0)
+                                              , 2 * nProc
+                                              , &first
+                                              , GASPI_TEST
+                                              )
+     )
+    return GASPI_ERROR;
+
+  unsigned long failed[gpi_cp_view_words ()];
+  memset (failed, 0, sizeof (failed));
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_update_failed (description, failed));
+
+  gaspi_number_t i;
+  for (i = 0; i < description->number_of_members; ++i)
+    {
+      if (gpi_cp_test_bit (failed, description->members[i]))
+        return GASPI_ERROR;
+    }
+
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_for_queue_entries (description, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_notify ( description->segment_ids_remote_on_receivers[j]
+                      , description->receivers[j]
+                      , gpi_cp_beat_notification_id (description, iProc)
+                      , 1
+                      , description->queue
+                      , timeout_ms
+                      )
+         );
+    }
+
+  // a sender that stays silent is checked
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      gaspi_rank_t const sender = description->senders[j];
+      gaspi_notification_id_t const beat = gpi_cp_beat_notification_id (description, sender);
+
+      gaspi_return_t const ret = gaspi_notify_waitsome ( description->segment_id_local_for_sender
+                                                       , beat
+                                                       , 1
+                                                       , &first
+                                                       , timeout_ms
+                                                       );
+      if (ret == GASPI_TIMEOUT)
+        {
+          GASPI_SUCCESS_OR_RETURN (gpi_cp_update_failed (description, failed));
+
+          return gpi_cp_test_bit (failed, sender) ? GASPI_ERROR : GASPI_TIMEOUT;
+        }
+
+      GASPI_SUCCESS_OR_RETURN (ret);
+
+      gaspi_notification_t value;
+      GASPI_SUCCESS_OR_RETURN (gaspi_notify_reset (description->segment_id_local_for_sender, beat, &value));
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* agree with the surviving members on the failed ones
+
+   flooding in rounds: every member sends its view to the members it
+   takes for alive and waits for theirs, checking the state of a member
+   it waits for every GPI_CP_HEARTBEAT_MS; the views are merged until a
+   round brings no news, which happens in the same round everywhere.
+   Failures during the agreement are not covered.
+*/
+static gaspi_return_t
+gpi_cp_agree_on_failed ( const gpi_cp_description_t description
+                       , unsigned long* const failed
+                       , const gaspi_timeout_t timeout_ms
+                       )
+{
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  gaspi_number_t const words = gpi_cp_view_words ();
+  gaspi_size_t const view_size = words * sizeof (unsigned long);
+  unsigned long* const view = (unsigned long*)
+    gpi_cp_ptr (description->segment_id_local_for_sender, gpi_cp_outgoing_view_offset (description));
+
+  memset (failed, 0, view_size);
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_update_failed (description, failed));
+
+  gaspi_timeout_t const slice = MIN (timeout_ms, GPI_CP_HEARTBEAT_MS);
+  gaspi_timeout_t waited = 0;
+
+  unsigned long round;
+  for (round = 1; round <= description->number_of_members; ++round)
+    {
+      memcpy (view, failed, view_size);
+
+      gaspi_number_t i, w;
+      for (i = 0; i < description->number_of_members; ++i)
+        {
+          gaspi_rank_t const member = description->members[i];
+
+          if (member == iProc || gpi_cp_test_bit (view, member))
+            continue;
+
+          GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_for_queue_entries (description, timeout_ms));
+
+          GASPI_SUCCESS_OR_RETURN
+            (gaspi_write_notify ( description->segment_id_local_for_sender
+                                , gpi_cp_outgoing_view_offset (description)
+                                , member
+                                , description->segment_id_local_for_sender
+                                , gpi_cp_view_offset (description, iProc, round)
+                                , view_size
+                                , gpi_cp_view_notification_id (description, iProc, round)
+                                , (gaspi_notification_t) round
+                                , description->queue
+                                , timeout_ms
+                                )
+             );
+        }
+
+      GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
+
+      bool news = false;
+
+      for (i = 0; i < description->number_of_members; ++i)
+        {
+          gaspi_rank_t const member = description->members[i];
+
+          if (member == iProc || gpi_cp_test_bit (view, member))
+            continue;
+
+          gaspi_notification_id_t const id = gpi_cp_view_notification_id (description, member, round);
+          gaspi_notification_id_t first;
+          gaspi_return_t ret;
+
+          while (GASPI_TIMEOUT == (ret = gaspi_notify_waitsome ( description->segment_id_local_for_sender
+                                                               , id
+                                                               , 1
+                                                               , &first
+                                                               , slice
+                                                               )
+                                   )
+                )
+            {
+              GASPI_SUCCESS_OR_RETURN (gpi_cp_update_failed (description, failed));
+
+              if (gpi_cp_test_bit (failed, member))
+                break;
+
+              waited += slice;
+
+              if (timeout_ms != GASPI_BLOCK && waited >= timeout_ms)
+                return GASPI_TIMEOUT;
+            }
+
+          // failed before it sent its view
+          if (ret == GASPI_TIMEOUT)
+            continue;
+
+          GASPI_SUCCESS_OR_RETURN (ret);
+
+          gaspi_notification_t value;
+          GASPI_SUCCESS_OR_RETURN (gaspi_notify_reset (description->segment_id_local_for_sender, id, &value));
+
+          unsigned long const * const other = (unsigned long*)
+            gpi_cp_ptr (description->segment_id_local_for_sender, gpi_cp_view_offset (description, member, round));
+
+          for (w = 0; w < words; ++w)
+            {
+              news = news || other[w] != view[w];
+              failed[w] |= other[w];
+            }
+        }
+
+      // including the failures found while waiting
+      for (w = 0; w < words; ++w)
+        news = news || failed[w] != view[w];
+
+      if (!news)
+        return GASPI_SUCCESS;
+    }
+
+  fprintf (stderr, "No agreement on the failed ranks\n");
+  return GASPI_ERROR;
+}
+
+/* the failed members get spares in their places of the ring, the one
+   with the shadow of the place if it is still there, else the next
+   one; the first surviving member tells the spares */
+static gaspi_return_t
+gpi_cp_recruit ( gpi_cp_description_t description
+               , const unsigned long* failed
+               , const gaspi_rank_t iProc
+               , const gaspi_timeout_t timeout_ms
+               )
+{
+  gaspi_number_t const first_recruit = description->spares_used;
+  gaspi_rank_t leader = iProc;
+  bool leader_found = false;
+  gaspi_number_t i;
+
+  for (i = 0; i < description->number_of_members; ++i)
+    {
+      if (!gpi_cp_test_bit (failed, description->members[i]))
+        {
+          if (!leader_found)
+            leader = description->members[i];
+          leader_found = true;
+          continue;
+        }
+
+      if (description->spares_used == description->number_of_spares)
+        {
+          fprintf (stderr, "No spare left for rank %u\n", description->members[i]);
+          return GASPI_ERROR;
+        }
+
+      gaspi_rank_t shadow;
+      gaspi_number_t index, k;
+
+      if (gpi_cp_shadow_spare (description, i, &shadow, &index))
+        {
+          // move it to the front of the unused ones
+          for (k = description->spares_used; description->spares[k] != shadow; ++k)
+            ;
+
+          description->spares[k] = description->spares[description->spares_used];
+          description->spares[description->spares_used] = shadow;
+        }
+
+      description->members[i] = description->spares[description->spares_used++];
+    }
+
+  if (leader != iProc)
+    return GASPI_SUCCESS;
+
+  gpi_cp_recruitment_t* const recruitment = (gpi_cp_recruitment_t*)
+    gpi_cp_ptr (description->segment_id_local_for_sender, gpi_cp_recruitment_offset (description));
+
+  recruitment->spares_used = description->spares_used;
+  recruitment->number_of_members = description->number_of_members;
+  memcpy ( recruitment + 1
+         , description->members
+         , description->number_of_members * sizeof (gaspi_rank_t)
+         );
+  memcpy ( (gaspi_rank_t*) (recruitment + 1) + description->number_of_members
+         , description->spares
+         , description->number_of_spares * sizeof (gaspi_rank_t)
+         );
+
+  for (i = first_recruit; i < description->spares_used; ++i)
+    {
+      gaspi_rank_t const spare = description->spares[i];
+
+      GASPI_SUCCESS_OR_RETURN
+        (gaspi_write_notify ( description->segment_id_local_for_sender
+                            , gpi_cp_recruitment_offset (description)
+                            , spare
+                            , description->segment_id_local_for_sender
+                            , gpi_cp_recruitment_offset (description)
+                            , gpi_cp_recruitment_size ()
+                            , gpi_cp_recruit_notification_id (description)
+                            , GPI_CP_RECRUITED
+                            , description->queue
+                            , timeout_ms
+                            )
+         );
+    }
+
+  return gaspi_wait (description->queue, timeout_ms);
+}
+
+/* a spare waits for its recruitment and takes the ring order from it
+
+   \return GASPI_SUCCESS with *recruited false if it was released */
+static gaspi_return_t
+gpi_cp_wait_for_recruitment ( gpi_cp_description_t description
+                            , bool* const recruited
+                            , const gaspi_timeout_t timeout_ms
+                            )
+{
+  gaspi_notification_id_t const id = gpi_cp_recruit_notification_id (description);
+  gaspi_notification_id_t first;
+
+  GASPI_SUCCESS_OR_RETURN
+    (gaspi_notify_waitsome (description->segment_id_local_for_sender, id, 1, &first, timeout_ms));
+
+  gaspi_notification_t value;
+  GASPI_SUCCESS_OR_RETURN (gaspi_notify_reset (description->segment_id_local_for_sender, id, &value));
+
+  *recruited = value == GPI_CP_RECRUITED;
+
+  if (!*recruited)
+    return GASPI_SUCCESS;
+
+  gpi_cp_recruitment_t const * const recruitment = (gpi_cp_recruitment_t*)
+    gpi_cp_ptr (description->segment_id_local_for_sender, gpi_cp_recruitment_offset (description));
+
+  gaspi_rank_t* const members = malloc (recruitment->number_of_members * sizeof (gaspi_rank_t));
+
+  if (members == NULL)
+    return GASPI_ERROR;
+
+  memcpy (members, recruitment + 1, recruitment->number_of_members * sizeof (gaspi_rank_t));
+  memcpy ( description->spares
+         , (gaspi_rank_t*) (recruitment + 1) + recruitment->number_of_members
+         , description->number_of_spares * sizeof (gaspi_rank_t)
+         );
+
+  free (description->members);
+  description->members = members;
+  description->number_of_members = recruitment->number_of_members;
+  description->spares_used = recruitment->spares_used;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_recover ( gpi_cp_description_t description
+               , gaspi_group_t* const new_group
+               , const gaspi_timeout_t timeout_ms
+               )
+{
+#ifdef CP_STATS
+  struct timeval tstart, tend;
+  gettimeofday(&tstart, NULL);
+#endif
+
+  if (!description->spare_pool || !description->state_initialized)
+    return GASPI_ERROR;
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if (description->spare)
+    {
+      bool recruited;
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_for_recruitment (description, &recruited, timeout_ms));
+
+      if (!recruited)
+        return GASPI_SUCCESS;
+    }
+  else
+    {
+      unsigned long failed[gpi_cp_view_words ()];
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_agree_on_failed (description, failed, timeout_ms));
+
+      gaspi_number_t i;
+      bool any = false;
+      for (i = 0; i < description->number_of_members; ++i)
+        any = any || gpi_cp_test_bit (failed, description->members[i]);
+
+      if (!any)
+        {
+          *new_group = description->group;
+          return GASPI_SUCCESS;
+        }
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_recruit (description, failed, iProc, timeout_ms));
+
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+      // the mirror is about to change
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_drain (description));
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_verifier (description));
+    }
+
+  gaspi_group_t group;
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_create (&group));
+
+  gaspi_number_t i;
+  for (i = 0; i < description->number_of_members; ++i)
+    GASPI_SUCCESS_OR_RETURN (gaspi_group_add (group, description->members[i]));
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_group_commit (group, timeout_ms));
+
+  description->group = group;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_rebind (description, iProc, timeout_ms));
+
+  *new_group = group;
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_restore.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_restore.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+bool
+gpi_cp_get_state_spare (const gpi_cp_description_t description)
+{
+  return description->spare;
+}
+
+bool
+gpi_cp_get_state_lazy_restore (const gpi_cp_description_t description)
+{
+  return description->lazy != NULL;
+}
+
+gaspi_return_t
+gpi_cp_restart_from_files ( const gaspi_segment_id_t segment_id_checkpoint
+                          , const gaspi_offset_t offset
+                          , const gaspi_size_t size
+                          , const gaspi_queue_id_t queue
+                          , const gpi_cp_policy_t policy
+                          , const gaspi_group_t group
+                          , gpi_cp_description_t description
+                          , const gaspi_timeout_t timeout_ms
+                          )
+{
+  if (description->persistent_path == NULL && description->mirror_path == NULL)
+    return GASPI_ERROR;
+
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_init ( segment_id_checkpoint
+                                       , offset
+                                       , size
+                                       , queue
+                                       , policy
+                                       , group
+                                       , description
+                                       , timeout_ms
+                                       )
+                          );
+
+  gaspi_rank_t iProc;
+  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+
+  if (!gpi_cp_is_in_group (group, iProc))
+    return GASPI_SUCCESS;
+
 #ifdef CP_STATS
   struct timeval tstart, tend;
   gettimeofday(&tstart, NULL);
 #endif
 
-  gaspi_rank_t iProc;
-  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
-  
-  if(gpi_cp_is_in_group(description->group, iProc))
+  // the newest epoch every rank holds for its sender, in its files or
+  // in its mirror file
+  unsigned long const in_mirror = gpi_cp_find_mirror_snapshot (description);
+  unsigned long newest = in_mirror;
+  unsigned long epoch;
+
+  if (description->persistent_path != NULL)
+    newest = MAX (newest, gpi_cp_find_snapshot (description, description->senders[0]));
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_allreduce ( &newest
+                                           , &epoch
+                                           , 1
+                                           , GASPI_OP_MIN
+                                           , GASPI_TYPE_ULONG
+                                           , group
+                                           , timeout_ms
+                                           )
+                          );
+
+  if (epoch == 0)
+    {
+      fprintf (stderr, "No complete set of snapshot files\n");
+      return GASPI_ERROR;
+    }
+
+  gpi_cp_adopt_epoch (description, epoch);
+
+  // all ranks read in parallel, each into its mirror: the data of the
+  // sender is back in the committed slot of the epoch; a mirror file
+  // holding the epoch already has it there
+  unsigned long loaded = epoch == in_mirror;
+
+  if (!loaded && description->persistent_path != NULL)
+    {
+      loaded = gpi_cp_load_snapshot ( description
+                                    , description->senders[0]
+                                    , epoch
+                                    , (char*) gpi_cp_get_receiver_ptr (description)
+                                      + description->committed_snapshot
+                                    ) == 0;
+
+      if (  loaded
+         && description->mirror.data != NULL
+         && (  gpi_cp_mirror_flush ( &description->mirror
+                                   , description->committed_snapshot
+                                   , description->size
+                                   ) != 0
+            || gpi_cp_commit_mirror (description, epoch) != GASPI_SUCCESS
+            )
+         )
+        {
+          loaded = 0;
+        }
+    }
+
+  unsigned long all_loaded;
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_allreduce ( &loaded
+                                           , &all_loaded
+                                           , 1
+                                           , GASPI_OP_MIN
+                                           , GASPI_TYPE_ULONG
+                                           , group
+                                           , timeout_ms
+                                           )
+                          );
+
+  if (!all_loaded)
+    {
+      fprintf (stderr, "Could not load snapshot %lu\n", epoch);
+      return GASPI_ERROR;
+    }
+
+  *(unsigned long*) gpi_cp_ptr ( description->segment_id_local_for_sender
+                               , gpi_cp_epoch_offset (description, 0, description->committed_snapshot)
+                               ) = epoch;
+
+  // own data: from the own file if visible (shared file system),
+  // otherwise from the mirror of the receiver
+  if (  description->persistent_path == NULL
+     || gpi_cp_load_snapshot ( description
+                             , iProc
+                             , epoch
+                             , gpi_cp_ptr (segment_id_checkpoint, offset)
+                             ) != 0
+     )
+    {
+      GASPI_SUCCESS_OR_RETURN
+        ( gpi_cp_read_chunked ( description
+                              , segment_id_checkpoint
+                              , offset
+                              , description->receivers[0]
+                              , description->segment_ids_remote_on_receivers[0]
+                              , description->committed_snapshot
+                              , size
+                              , timeout_ms
+                              )
+        );
+      GASPI_SUCCESS_OR_RETURN (gpi_cp_wait_chunked (description, timeout_ms));
+    }
+
+  GASPI_SUCCESS_OR_RETURN (gaspi_barrier (group, timeout_ms));
+
+#ifdef CP_STATS
+  gettimeofday(&tend, NULL);
+  description->in_restore.tv_usec += (tend.tv_usec - tstart.tv_usec);
+  description->in_restore.tv_sec += (tend.tv_sec - tstart.tv_sec);
+#endif
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_read_buddy( const gpi_cp_description_t description
+                 , const gaspi_timeout_t timeout_ms )
+{
+  GASPI_SUCCESS_OR_RETURN (gpi_cp_finish_lazy_restore (description));
+
+  /* Get from receiver */
+  // compressed: the slot as it is
+  if (description->compression > 0)
+    {
+      GASPI_SUCCESS_OR_RETURN ( gpi_cp_read_chunked
+                          ( description
+                            , description->segment_id_local_for_sender
+                            , description->active_snapshot
+                            , description->receivers[0]
+                            , description->segment_ids_remote_on_receivers[0]
+                            , description->committed_snapshot
+                            , gpi_cp_slot_size (description)
+                            , timeout_ms
+                            )
+                     );
+
+      return gpi_cp_wait_chunked (description, timeout_ms);
+    }
+
+  gaspi_number_t j;
+  for (j = 0; j < description->number_of_stripes; ++j)
+    {
+      if (gpi_cp_stripe_length (description, j) == 0)
+        continue;
+
+      GASPI_SUCCESS_OR_RETURN ( gpi_cp_read_chunked
+                          ( description
+                            , description->segment_id_local_for_sender
+                            , description->active_snapshot + gpi_cp_stripe_offset (description, j)
+                            , description->receivers[j]
+                            , description->segment_ids_remote_on_receivers[j]
+                            , description->committed_snapshot + gpi_cp_stripe_offset (description, j)
+                            , gpi_cp_stripe_length (description, j)
+                            , timeout_ms
+                            )
+                     );
+    }
+  GASPI_SUCCESS_OR_RETURN(gpi_cp_wait_chunked(description, timeout_ms));
+
+  return GASPI_SUCCESS;
+}
+
+bool
+gpi_cp_get_state_in_progress(const gpi_cp_description_t description)
+{
+  // a pipelined description may start while the barrier is outstanding
+  return description->state_in_progress
+    || (  description->state_commit_pending
+       && description->number_of_snapshots < 3
+       );
+}
+
+gaspi_return_t
+gpi_cp_set_stripes ( gpi_cp_description_t description
+                   , const gaspi_number_t stripes
+                   )
+{
+  if ( description->state_initialized
+     || stripes < 1
+     || stripes > GPI_CP_STRIPES_MAX
+     )
+    return GASPI_ERROR;
+
+  description->stripes = stripes;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_persistent_path ( gpi_cp_description_t description
+                           , const char* path
+                           )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
+
+  free (description->persistent_path);
+  description->persistent_path = NULL;
+
+  if (path != NULL)
+    {
+      description->persistent_path = strdup (path);
+
+      if (description->persistent_path == NULL)
+        return GASPI_ERROR;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_lazy_restore ( gpi_cp_description_t description
+                        , const bool on_demand_paging
+                        , const gaspi_queue_id_t queue
+                        )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
+
+  description->lazy_restore = on_demand_paging;
+  description->lazy_queue = queue;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_restore_queues ( gpi_cp_description_t description
+                          , const gaspi_number_t number_of_queues
+                          )
+{
+  description->restore_queues = number_of_queues;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_checksums ( gpi_cp_description_t description
+                     , const bool checksums
+                     )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
+
+  description->checksums = checksums;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_mirror_path ( gpi_cp_description_t description
+                       , const char* path
+                       )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
+
+  free (description->mirror_path);
+  description->mirror_path = NULL;
+
+  if (path != NULL)
     {
-      if (description->state_in_progress)
-       {
-         GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
-         
-         GASPI_SUCCESS_OR_RETURN( gpi_cp_wait_for_notification_from ( description->segment_id_remote_on_receiver
-                                                      , description->sender
-                                                      , (description->sender)+1
-                                                      , timeout_ms
-                                                     )
-                            );
-         GASPI_SUCCESS_OR_RETURN (gaspi_barrier (description->group, timeout_ms));
-         
-         // make persistent copies here!
-         
-         description->active_snapshot = description->size - description->active_snapshot;
-         description->state_in_progress = false;
-       }
+      description->mirror_path = strdup (path);
+
+      if (description->mirror_path == NULL)
+        return GASPI_ERROR;
     }
-#ifdef CP_STATS
-  gettimeofday(&tend, NULL);
-  description->in_commit.tv_usec += (tend.tv_usec - tstart.tv_usec);
-  description->in_commit.tv_sec += (tend.tv_sec - tstart.tv_sec);
-#endif
 
   return GASPI_SUCCESS;
 }
 
 gaspi_return_t
-gpi_cp_restore ( const gaspi_segment_id_t segment_id_checkpoint
-               , const gaspi_offset_t offset
-               , const gaspi_size_t size
-               , const gaspi_queue_id_t queue
-               , const gpi_cp_policy_t policy
-               , const gaspi_group_t new_group
-               , gpi_cp_description_t description
-               , const gaspi_timeout_t timeout_ms
-               )
+gpi_cp_set_pipelined ( gpi_cp_description_t description
+                     , const bool pipelined
+                     )
 {
-#ifdef CP_STATS
-  struct timeval tstart, tend;
-  gettimeofday(&tstart, NULL);
-#endif
+  if (description->state_initialized)
+    return GASPI_ERROR;
 
-  description->offset = offset;
-  description->size = size;
-  description->segment_id_local_client_source = segment_id_checkpoint;
-  description->queue = queue;
-  description->group = new_group;
+  description->number_of_snapshots = pipelined ? 3 : 2;
 
-  gaspi_rank_t iProc;
-  GASPI_SUCCESS_OR_RETURN (gaspi_proc_rank (&iProc));
+  return GASPI_SUCCESS;
+}
 
-  // case joiner
-  if (!description->state_initialized)
-    {
-      CP_SUCCESS_OR_RETURN( gpi_cp_sender (policy, new_group, iProc, &(description->sender)) );
-      CP_SUCCESS_OR_RETURN( gpi_cp_receiver (policy, new_group, iProc, &(description->receiver)) );
-      description->state_initialized = true;
+gaspi_return_t
+gpi_cp_set_neighbourhood_commit ( gpi_cp_description_t description
+                                , const gaspi_number_t agreement_interval
+                                )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
 
-      // in case of two consecutive joiners: one needs to go into a send!?
-      {
-       gaspi_rank_t notifier;
+  description->agreement_interval = agreement_interval;
 
-       GASPI_SUCCESS_OR_RETURN
-         ( gaspi_passive_receive ( segment_id_checkpoint
-                                , offset
-                                , &notifier
-                                , 1
-                                , timeout_ms
-                                )
-           );
+  return GASPI_SUCCESS;
+}
 
-       if (notifier == description->sender)
-         {
-           description->active_snapshot = 0;
-         }
-       else if (notifier == description->receiver)
-         {
-           description->active_snapshot = size;
-         }
-       else
-         {
-           fprintf (stderr, "BUMMER: Got message from unexpected source\n");
-           return GASPI_ERROR;  //! \todo specific error code
-         }
-      }
-      gaspi_barrier(description->group, timeout_ms);
+gaspi_return_t
+gpi_cp_set_spares ( gpi_cp_description_t description
+                  , const gaspi_group_t spares
+                  )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
 
-      gpi_cp_allocate_and_register_local_segment
-       ( &description->segment_id_local_for_sender
-         , description->size
-         , description->sender
-         , timeout_ms
-         );
-      
-      gpi_cp_tell_sender_about_the_local_segment_id
-       ( description->segment_id_local_for_sender
-         , description->active_snapshot
-         , description->sender
-         );
+  description->spare_pool = true;
+  description->spare_group = spares;
 
-      CP_SUCCESS_OR_RETURN( gpi_cp_receive_segment_id ( description->segment_id_local_for_sender
-                                                       , description->active_snapshot
-                                                       , description->receiver
-                                                       , timeout_ms
-                                                       , &(description->segment_id_remote_on_receiver))
-          );
+  return GASPI_SUCCESS;
+}
 
-      gpi_cp_make_sure_receiver_got_local_segment_id
-       ( description->segment_id_local_for_sender
-         , description->active_snapshot
-         , description->sender
-         , timeout_ms
-         );
+gaspi_return_t
+gpi_cp_set_spare_shadows ( gpi_cp_description_t description
+                         , const bool shadows
+                         )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
 
-      GASPI_SUCCESS_OR_RETURN
-       ( gaspi_read
-         ( description->segment_id_local_client_source
-           , description->offset
-           , description->receiver
-           , description->segment_id_remote_on_receiver
-           , (gaspi_offset_t) (description->size - description->active_snapshot)
-           , description->size
-           , description->queue
-           , timeout_ms
-           )
-         );
-      
-      gpi_cp_wait_for_notification_from
-       ( description->segment_id_local_for_sender
-         , description->sender
-         , (description->sender)+1
-         , timeout_ms
-         );
+  description->shadows = shadows;
 
-      GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
-    }
+  return GASPI_SUCCESS;
+}
 
-  // case affected_missing_sender
-  else if (!gpi_cp_is_in_group (new_group, description->sender))
-    {
-      CP_SUCCESS_OR_RETURN( gpi_cp_sender (policy, new_group, iProc, &(description->sender)) );
+gaspi_return_t
+gpi_cp_set_compression ( gpi_cp_description_t description
+                       , const gaspi_size_t element_size
+                       , const gaspi_size_t capacity
+                       )
+{
+  if (description->state_initialized || element_size > UINT32_MAX)
+    return GASPI_ERROR;
 
-      if (description->active_snapshot == description->size)
-       {
-         // V.B.: hope I have connected the correct segment
-         GASPI_SUCCESS_OR_RETURN
-           ( gaspi_passive_send ( description->segment_id_local_for_sender
-                               , description->active_snapshot
-                               , description->sender
-                               , 1
-                               , timeout_ms
-                               )
-             );
-       }
-      gaspi_barrier(description->group, timeout_ms);
+  description->compression = element_size;
+  description->compression_capacity = capacity;
+  description->lossy_dropped_bits = 0;
 
-      GASPI_SUCCESS_OR_RETURN
-       ( gaspi_segment_register
-         ( description->segment_id_local_for_sender
-           , description->sender
-           , timeout_ms
-           )
-         );
-      
-      gpi_cp_tell_sender_about_the_local_segment_id
-       ( description->segment_id_local_for_sender
-         , description->active_snapshot
-         , description->sender
-         );
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_lossy_compression ( gpi_cp_description_t description
+                             , const gpi_cp_float_type_t type
+                             , const double relative_error
+                             , const gaspi_size_t capacity
+                             )
+{
+  if (description->state_initialized || !(relative_error > 0))
+    return GASPI_ERROR;
+
+  switch (type)
+    {
+    case GPI_CP_FLOAT:
+      description->compression = sizeof (float);
+      description->lossy_dropped_bits = gpi_cp_compress_dropped_bits (relative_error, 23);
+      break;
+    case GPI_CP_DOUBLE:
+      description->compression = sizeof (double);
+      description->lossy_dropped_bits = gpi_cp_compress_dropped_bits (relative_error, 52);
+      break;
+    default:
+      return GASPI_ERROR;
     }
 
-  // case affected_missing_receiver
-  else if (!gpi_cp_is_in_group (new_group, description->receiver))
+  description->compression_capacity = capacity;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_delta ( gpi_cp_description_t description
+                 , const gaspi_size_t element_size
+                 )
+{
+  if (description->state_initialized || element_size > UINT32_MAX)
+    return GASPI_ERROR;
+
+  description->delta = element_size;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_block_elimination ( gpi_cp_description_t description
+                             , const gaspi_size_t block_size
+                             , const bool deduplicate
+                             )
+{
+  if (description->state_initialized || (deduplicate && block_size == 0))
+    return GASPI_ERROR;
+
+  description->block_size = block_size;
+  description->deduplicate = deduplicate;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_get_saved_bytes ( const gpi_cp_description_t description
+                       , gaspi_size_t* const zero
+                       , gaspi_size_t* const duplicate
+                       )
+{
+  if (zero != NULL)
+    *zero = description->zero_bytes_saved;
+  if (duplicate != NULL)
+    *duplicate = description->duplicate_bytes_saved;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_size_t
+gpi_cp_get_compressed_size (const gpi_cp_description_t description)
+{
+  return description->compressed_size;
+}
+
+gaspi_return_t
+gpi_cp_set_copy_threads ( gpi_cp_description_t description
+                        , const gaspi_number_t threads
+                        )
+{
+  if (description->state_initialized || threads == 0)
+    return GASPI_ERROR;
+
+  description->copy_threads = threads;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_local_copy ( gpi_cp_description_t description
+                      , const bool local_copy
+                      )
+{
+  if (description->state_initialized)
+    return GASPI_ERROR;
+
+  description->local_copy = local_copy;
+
+  return GASPI_SUCCESS;
+}
+
+/* our data as an arena, NULL if it holds none and format is false */
+static gpi_cp_arena_header_t*
+gpi_cp_arena ( gpi_cp_description_t description
+             , const bool format
+             )
+{
+  // the data must not change while it is being sent
+  if (  !description->state_initialized
+     || gpi_cp_get_state_in_progress (description)
+     || gpi_cp_finish_lazy_restore (description) != GASPI_SUCCESS
+     )
     {
-      CP_SUCCESS_OR_RETURN( gpi_cp_receiver (policy, new_group, iProc, &(description->receiver)) );
+      return NULL;
+    }
 
-      if (description->active_snapshot == 0)
-       {
-         GASPI_SUCCESS_OR_RETURN
-           (gaspi_passive_send ( description->segment_id_local_for_sender
-                              , description->active_snapshot
-                              , description->receiver
-                              , 1
-                              , timeout_ms
-                              )
-            );
-       }
-      gaspi_barrier(description->group, timeout_ms);
+  void* const data =
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
 
-      CP_SUCCESS_OR_RETURN( gpi_cp_receive_segment_id ( description->segment_id_local_for_sender
-                                                      , description->active_snapshot
-                                                      , description->receiver
-                                                      , timeout_ms
-                                                      , &(description->segment_id_remote_on_receiver))
-          );
+  if (data == NULL)
+    return NULL;
 
-      if (description->state_in_progress)
-       {
-         GASPI_SUCCESS_OR_RETURN (gaspi_wait (description->queue, timeout_ms));
-         description->state_in_progress = false;
-       }
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena_find (data, description->size);
+
+  if (arena == NULL && format)
+    return gpi_cp_arena_format (data, description->size);
+
+  return arena;
+}
+
+void*
+gpi_cp_alloc ( gpi_cp_description_t description
+             , const gaspi_size_t bytes
+             , const gaspi_size_t align
+             )
+{
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena (description, true);
+
+  if (arena == NULL)
+    return NULL;
+
+  return gpi_cp_arena_alloc (arena, bytes, align);
+}
+
+gaspi_return_t
+gpi_cp_free ( gpi_cp_description_t description
+            , void* const pointer
+            )
+{
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena (description, false);
+
+  if (arena == NULL || gpi_cp_arena_free (arena, pointer) != 0)
+    return GASPI_ERROR;
+
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_root ( gpi_cp_description_t description
+                , void* const pointer
+                )
+{
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena (description, true);
 
-      gpi_cp_start ( description
-                   , timeout_ms);
+  if (arena == NULL)
+    return GASPI_ERROR;
 
-      GASPI_SUCCESS_OR_RETURN ( gaspi_wait (description->queue, timeout_ms));
+  if (pointer == NULL)
+    {
+      arena->root = 0;
+      return GASPI_SUCCESS;
     }
 
-  // case unaffected
-  else
+  uintptr_t const offset = (uintptr_t) pointer - (uintptr_t) arena;
+
+  if (  (uintptr_t) pointer < (uintptr_t) arena
+     || offset < sizeof (gpi_cp_arena_header_t)
+     || offset >= arena->size
+     )
     {
-      gaspi_printf("Unaffected\n");
-      assert (gpi_cp_is_in_group (new_group, description->receiver));
-      assert (gpi_cp_is_in_group (new_group, description->sender));
+      return GASPI_ERROR;
+    }
+
+  arena->root = offset;
+
+  return GASPI_SUCCESS;
+}
+
+void*
+gpi_cp_get_root (gpi_cp_description_t description)
+{
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena (description, false);
+
+  if (arena == NULL || arena->root == 0)
+    return NULL;
+
+  return (char*) arena + arena->root;
+}
+
+gaspi_return_t
+gpi_cp_register ( gpi_cp_description_t description
+                , const char* name
+                , void* const pointer
+                , const gaspi_size_t bytes
+                , const unsigned int flags
+                )
+{
+  if (!description->state_initialized || (flags & ~GPI_CP_VARIABLE_ALWAYS) != 0)
+    return GASPI_ERROR;
 
-      // do nothing: the data still resides in local memory
-      gaspi_barrier(description->group, timeout_ms);
+  if (gpi_cp_registry_add ( &description->registry
+                          , name
+                          , pointer
+                          , bytes
+                          , (flags & GPI_CP_VARIABLE_ALWAYS) != 0
+                          , description->size
+                          ) != 0
+     )
+    {
+      return GASPI_ERROR;
     }
 
-  //! \todo is this correct?
-  description->state_in_progress = false;
+  return GASPI_SUCCESS;
+}
+
+gaspi_return_t
+gpi_cp_set_variable_interval ( gpi_cp_description_t description
+                             , const char* name
+                             , const gaspi_number_t interval
+                             )
+{
+  gpi_cp_variable_t* const variable = gpi_cp_registry_find (&description->registry, name);
 
-  //! \todo required!? -> maybe yes to allow immediate checkpoint_start
-  GASPI_SUCCESS_OR_RETURN (gaspi_barrier (description->group, timeout_ms));
+  if (variable == NULL || interval == 0)
+    return GASPI_ERROR;
 
-#ifdef CP_STATS
-  gettimeofday(&tend, NULL);
-  description->in_restore.tv_usec += (tend.tv_usec - tstart.tv_usec);
-  description->in_restore.tv_sec += (tend.tv_sec - tstart.tv_sec);
-#endif
+  variable->interval = interval;
 
   return GASPI_SUCCESS;
 }
 
 gaspi_return_t
-gpi_cp_read_buddy( const gpi_cp_description_t description
-                 , const gaspi_timeout_t timeout_ms )
+gpi_cp_mark_dirty ( gpi_cp_description_t description
+                  , const char* name
+                  )
 {
-  /* Get from receiver */
-  GASPI_SUCCESS_OR_RETURN ( gaspi_read
-                      ( description->segment_id_local_for_sender
-                        , description->active_snapshot
-                        , description->receiver
-                        , description->segment_id_remote_on_receiver
-                        , (gaspi_offset_t) description->size - description->active_snapshot
-                        , description->size
-                        , description->queue
-                        , timeout_ms
-                        )
-                 );
-  GASPI_SUCCESS_OR_RETURN(gaspi_wait(description->queue, timeout_ms));
+  gpi_cp_variable_t* const variable = gpi_cp_registry_find (&description->registry, name);
+
+  if (variable == NULL)
+    return GASPI_ERROR;
+
+  variable->dirty = true;
 
   return GASPI_SUCCESS;
 }
 
-bool
-gpi_cp_get_state_in_progress(const gpi_cp_description_t description)
+gaspi_return_t
+gpi_cp_restore_variables (gpi_cp_description_t description)
+{
+  if (  !description->state_initialized
+     || gpi_cp_finish_lazy_restore (description) != GASPI_SUCCESS
+     )
+    {
+      return GASPI_ERROR;
+    }
+
+  const void* const data =
+    gpi_cp_ptr (description->segment_id_local_client_source, description->offset);
+
+  if (  data == NULL
+     || gpi_cp_registry_unpack (&description->registry, data, description->size) != 0
+     )
+    {
+      return GASPI_ERROR;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+unsigned long
+gpi_cp_get_variable_epoch ( gpi_cp_description_t description
+                          , const char* name
+                          )
+{
+  const gpi_cp_variable_t* const variable =
+    gpi_cp_registry_find (&description->registry, name);
+
+  return (variable == NULL) ? 0 : variable->epoch;
+}
+
+gaspi_size_t
+gpi_cp_get_packed_size (const gpi_cp_description_t description)
+{
+  return description->packed_size;
+}
+
+unsigned long
+gpi_cp_get_global_epoch (const gpi_cp_description_t description)
 {
-  return description->state_in_progress;
+  return description->global_epoch;
 }
 
 gaspi_offset_t
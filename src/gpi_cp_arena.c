@@ -0,0 +1,253 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gpi_cp_arena.h"
+
+#define GPI_CP_ARENA_USED ((uint64_t) 1)
+#define GPI_CP_ARENA_TAG_SIZE (sizeof (gpi_cp_arena_block_t))
+#define GPI_CP_ARENA_MIN_BLOCK (2 * GPI_CP_ARENA_TAG_SIZE)
+
+#define ROUND_UP(n,a) ((((n) + (a) - 1) / (a)) * (a))
+
+static gpi_cp_arena_header_t*
+gpi_cp_arena_header (void* base)
+{
+  return (gpi_cp_arena_header_t*)
+    ROUND_UP ((uintptr_t) base, (uintptr_t) GPI_CP_ARENA_ALIGNMENT);
+}
+
+static gpi_cp_arena_block_t*
+gpi_cp_arena_block ( gpi_cp_arena_header_t* arena
+                   , uint64_t offset
+                   )
+{
+  return (gpi_cp_arena_block_t*) ((char*) arena + offset);
+}
+
+static uint64_t
+gpi_cp_arena_block_size (const gpi_cp_arena_block_t* block)
+{
+  return block->size & ~GPI_CP_ARENA_USED;
+}
+
+/* tell the block behind offset (if any) the size of its predecessor */
+static void
+gpi_cp_arena_link ( gpi_cp_arena_header_t* arena
+                  , uint64_t offset
+                  , uint64_t size
+                  )
+{
+  if (offset + size < arena->size)
+    gpi_cp_arena_block (arena, offset + size)->previous = size;
+}
+
+gpi_cp_arena_header_t*
+gpi_cp_arena_find (void* base, size_t size)
+{
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena_header (base);
+  size_t const padding = (size_t) ((char*) arena - (char*) base);
+
+  if (  size < padding + sizeof (gpi_cp_arena_header_t)
+     || memcmp (arena->magic, GPI_CP_ARENA_MAGIC, sizeof (arena->magic)) != 0
+     || arena->version != GPI_CP_ARENA_VERSION
+     || arena->size > size - padding
+     )
+    {
+      return NULL;
+    }
+
+  return arena;
+}
+
+gpi_cp_arena_header_t*
+gpi_cp_arena_format (void* base, size_t size)
+{
+  gpi_cp_arena_header_t* const arena = gpi_cp_arena_header (base);
+  size_t const padding = (size_t) ((char*) arena - (char*) base);
+
+  if (size < padding + sizeof (gpi_cp_arena_header_t) + GPI_CP_ARENA_MIN_BLOCK)
+    return NULL;
+
+  uint64_t const arena_size =
+    (size - padding) / GPI_CP_ARENA_ALIGNMENT * GPI_CP_ARENA_ALIGNMENT;
+
+  memset (arena, 0, sizeof (gpi_cp_arena_header_t));
+  arena->version = GPI_CP_ARENA_VERSION;
+  arena->size = arena_size;
+
+  // one free block
+  gpi_cp_arena_block_t* const block = gpi_cp_arena_block (arena, sizeof (gpi_cp_arena_header_t));
+  block->size = arena_size - sizeof (gpi_cp_arena_header_t);
+  block->previous = 0;
+
+  // valid only once complete
+  memcpy (arena->magic, GPI_CP_ARENA_MAGIC, sizeof (arena->magic));
+
+  return arena;
+}
+
+void*
+gpi_cp_arena_alloc ( gpi_cp_arena_header_t* arena
+                   , size_t bytes
+                   , size_t align
+                   )
+{
+  if (align < GPI_CP_ARENA_ALIGNMENT)
+    align = GPI_CP_ARENA_ALIGNMENT;
+
+  if (  (align & (align - 1)) != 0
+     || align > GPI_CP_ARENA_ALIGNMENT_MAX
+     || bytes > arena->size
+     )
+    return NULL;
+
+  uint64_t const need =
+    GPI_CP_ARENA_TAG_SIZE + ROUND_UP (bytes > 0 ? bytes : 1, GPI_CP_ARENA_ALIGNMENT);
+
+  uint64_t offset = sizeof (gpi_cp_arena_header_t);
+
+  while (offset < arena->size)
+    {
+      gpi_cp_arena_block_t* const block = gpi_cp_arena_block (arena, offset);
+      uint64_t const size = gpi_cp_arena_block_size (block);
+
+      if (block->size & GPI_CP_ARENA_USED)
+        {
+          offset += size;
+          continue;
+        }
+
+      // a gap in front of the aligned data becomes a free block of its
+      // own, so it needs room for one
+      uintptr_t const first = (uintptr_t) block + GPI_CP_ARENA_TAG_SIZE;
+      uintptr_t data = ROUND_UP (first, (uintptr_t) align);
+
+      if (data != first && data - first < GPI_CP_ARENA_MIN_BLOCK)
+        data = ROUND_UP (first + GPI_CP_ARENA_MIN_BLOCK, (uintptr_t) align);
+
+      uint64_t const gap = data - first;
+
+      if (gap + need > size)
+        {
+          offset += size;
+          continue;
+        }
+
+      uint64_t rest = size - gap - need;
+      uint64_t used = need;
+
+      // too small for a block of its own
+      if (rest < GPI_CP_ARENA_MIN_BLOCK)
+        {
+          used += rest;
+          rest = 0;
+        }
+
+      if (gap > 0)
+        {
+          block->size = gap;
+          offset += gap;
+        }
+
+      gpi_cp_arena_block_t* const allocated = gpi_cp_arena_block (arena, offset);
+      allocated->size = used | GPI_CP_ARENA_USED;
+      allocated->previous = (gap > 0) ? gap : block->previous;
+
+      if (rest > 0)
+        {
+          gpi_cp_arena_block_t* const remainder = gpi_cp_arena_block (arena, offset + used);
+          remainder->size = rest;
+          remainder->previous = used;
+          gpi_cp_arena_link (arena, offset + used, rest);
+        }
+      else
+        {
+          gpi_cp_arena_link (arena, offset, used);
+        }
+
+      arena->allocated += used;
+
+      return (char*) allocated + GPI_CP_ARENA_TAG_SIZE;
+    }
+
+  return NULL;
+}
+
+int
+gpi_cp_arena_free ( gpi_cp_arena_header_t* arena
+                  , void* pointer
+                  )
+{
+  uintptr_t const address = (uintptr_t) pointer;
+  uintptr_t const first = (uintptr_t) arena + sizeof (gpi_cp_arena_header_t) + GPI_CP_ARENA_TAG_SIZE;
+
+  if (  address < first
+     || address >= (uintptr_t) arena + arena->size
+     || (address - (uintptr_t) arena) % GPI_CP_ARENA_ALIGNMENT != 0
+     )
+    {
+      return -1;
+    }
+
+  uint64_t const wanted = address - (uintptr_t) arena - GPI_CP_ARENA_TAG_SIZE;
+  uint64_t offset = sizeof (gpi_cp_arena_header_t);
+
+  // only the beginnings of used blocks
+  while (offset < wanted)
+    offset += gpi_cp_arena_block_size (gpi_cp_arena_block (arena, offset));
+
+  gpi_cp_arena_block_t* block = gpi_cp_arena_block (arena, offset);
+
+  if (offset != wanted || !(block->size & GPI_CP_ARENA_USED))
+    return -1;
+
+  uint64_t size = gpi_cp_arena_block_size (block);
+
+  arena->allocated -= size;
+
+  // merge with the free neighbours
+  if (offset + size < arena->size)
+    {
+      gpi_cp_arena_block_t const* const next = gpi_cp_arena_block (arena, offset + size);
+
+      if (!(next->size & GPI_CP_ARENA_USED))
+        size += next->size;
+    }
+
+  if (block->previous > 0)
+    {
+      gpi_cp_arena_block_t* const previous = gpi_cp_arena_block (arena, offset - block->previous);
+
+      if (!(previous->size & GPI_CP_ARENA_USED))
+        {
+          offset -= block->previous;
+          size += previous->size;
+          block = previous;
+        }
+    }
+
+  block->size = size;
+  gpi_cp_arena_link (arena, offset, size);
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_arena.h
+ *
+ * @brief  Internal: a heap inside the checkpointed data.
+ *
+ */
+
+#ifndef _GPI_CP_ARENA_H_
+#define _GPI_CP_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Arena
+
+   [padding to 16][header][block][block]...[padding]
+
+   the blocks cover the arena, each starts with its boundary tag; all
+   references are offsets from the header, so the arena is the same
+   wherever the data is mapped and a restored snapshot holds a usable
+   heap; adjacent free blocks are always merged
+*/
+#define GPI_CP_ARENA_MAGIC "GPICPARN"
+#define GPI_CP_ARENA_VERSION (1)
+#define GPI_CP_ARENA_ALIGNMENT (16)
+#define GPI_CP_ARENA_ALIGNMENT_MAX (4096) /* segments are page aligned */
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t size;        /* bytes from the header to the end of the blocks */
+  uint64_t root;        /* offset of the root object, 0: none */
+  uint64_t allocated;   /* bytes in used blocks, with their tags */
+  uint64_t padding;
+} gpi_cp_arena_header_t;
+
+typedef struct
+{
+  uint64_t size;        /* with the tag, bit 0: in use */
+  uint64_t previous;    /* size of the previous block, 0: first */
+} gpi_cp_arena_block_t;
+
+/** the arena in size bytes at base, NULL if there is none */
+gpi_cp_arena_header_t*
+gpi_cp_arena_find (void* base, size_t size);
+
+/** make size bytes at base an empty arena
+ *
+ * \return the arena, NULL if size is too small
+ */
+gpi_cp_arena_header_t*
+gpi_cp_arena_format (void* base, size_t size);
+
+/** first fit of bytes at a multiple of align
+ *
+ * \param align: a power of two up to GPI_CP_ARENA_ALIGNMENT_MAX, so the
+ *               alignment survives a restore at another address
+ * \return NULL if there is no room
+ */
+void*
+gpi_cp_arena_alloc ( gpi_cp_arena_header_t* arena
+                   , size_t bytes
+                   , size_t align
+                   );
+
+/** \return 0 in case of success, -1 if pointer was not allocated */
+int
+gpi_cp_arena_free ( gpi_cp_arena_header_t* arena
+                  , void* pointer
+                  );
+
+#endif //_GPI_CP_ARENA_H_
@@ -0,0 +1,503 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__x86_64__) && defined (__GNUC__)
+#include <nmmintrin.h>
+#define GPI_CP_CRC32C_SSE42 1
+#endif
+
+#include "gpi_cp_checksum.h"
+
+#define GPI_CP_CRC32C_POLYNOMIAL (0x82f63b78) /* reflected */
+
+/* bytes per lane of the interleaved hardware loop */
+#define GPI_CP_CRC32C_LANE (8192)
+
+static uint32_t gpi_cp_crc32c_table[8][256];
+static pthread_once_t gpi_cp_crc32c_once = PTHREAD_ONCE_INIT;
+
+#ifdef GPI_CP_CRC32C_SSE42
+static bool gpi_cp_crc32c_hardware = false;
+
+/* x^(8 * lane) and x^(16 * lane) modulo the polynomial */
+static uint32_t gpi_cp_crc32c_shift_1;
+static uint32_t gpi_cp_crc32c_shift_2;
+
+/* a * b modulo the polynomial, reflected */
+static uint32_t
+gpi_cp_crc32c_multiply (uint32_t a, uint32_t b)
+{
+  uint32_t m = (uint32_t) 1 << 31;
+  uint32_t p = 0;
+
+  while (m != 0)
+    {
+      if (a & m)
+        p ^= b;
+
+      m >>= 1;
+      b = (b & 1) ? (b >> 1) ^ GPI_CP_CRC32C_POLYNOMIAL : b >> 1;
+    }
+
+  return p;
+}
+
+/* x^(8 * bytes) modulo the polynomial */
+static uint32_t
+gpi_cp_crc32c_power (size_t bytes)
+{
+  uint32_t power = (uint32_t) 1 << 31;      /* x^0 */
+  uint32_t square = (uint32_t) 1 << 23;     /* x^8 */
+
+  while (bytes != 0)
+    {
+      if (bytes & 1)
+        power = gpi_cp_crc32c_multiply (power, square);
+
+      square = gpi_cp_crc32c_multiply (square, square);
+      bytes >>= 1;
+    }
+
+  return power;
+}
+
+__attribute__ ((target ("sse4.2")))
+static uint32_t
+gpi_cp_crc32c_sse42_serial (uint32_t crc, const unsigned char* data, size_t size)
+{
+  uint64_t crc64 = crc;
+
+  while (size >= 8)
+    {
+      uint64_t word;
+      memcpy (&word, data, 8);
+      crc64 = _mm_crc32_u64 (crc64, word);
+      data += 8;
+      size -= 8;
+    }
+
+  crc = (uint32_t) crc64;
+
+  while (size > 0)
+    {
+      crc = _mm_crc32_u8 (crc, *data++);
+      --size;
+    }
+
+  return crc;
+}
+
+/* three independent lanes hide the latency of the crc32 instruction,
+   the lanes are combined by shifting */
+__attribute__ ((target ("sse4.2")))
+static uint32_t
+gpi_cp_crc32c_sse42 (uint32_t crc, const unsigned char* data, size_t size)
+{
+  while (size >= 3 * GPI_CP_CRC32C_LANE)
+    {
+      uint64_t crc0 = crc;
+      uint64_t crc1 = 0;
+      uint64_t crc2 = 0;
+      size_t i;
+
+      for (i = 0; i < GPI_CP_CRC32C_LANE; i += 8)
+        {
+          uint64_t word0, word1, word2;
+          memcpy (&word0, data + i, 8);
+          memcpy (&word1, data + GPI_CP_CRC32C_LANE + i, 8);
+          memcpy (&word2, data + 2 * GPI_CP_CRC32C_LANE + i, 8);
+          crc0 = _mm_crc32_u64 (crc0, word0);
+          crc1 = _mm_crc32_u64 (crc1, word1);
+          crc2 = _mm_crc32_u64 (crc2, word2);
+        }
+
+      crc = gpi_cp_crc32c_multiply (gpi_cp_crc32c_shift_2, (uint32_t) crc0)
+        ^ gpi_cp_crc32c_multiply (gpi_cp_crc32c_shift_1, (uint32_t) crc1)
+        ^ (uint32_t) crc2;
+
+      data += 3 * GPI_CP_CRC32C_LANE;
+      size -= 3 * GPI_CP_CRC32C_LANE;
+    }
+
+  return gpi_cp_crc32c_sse42_serial (crc, data, size);
+}
+#endif
+
+static void
+gpi_cp_crc32c_init_table (void)
+{
+  unsigned n, k;
+
+  for (n = 0; n < 256; ++n)
+    {
+      uint32_t crc = n;
+
+      for (k = 0; k < 8; ++k)
+        crc = (crc & 1) ? (crc >> 1) ^ GPI_CP_CRC32C_POLYNOMIAL : crc >> 1;
+
+      gpi_cp_crc32c_table[0][n] = crc;
+    }
+
+  for (n = 0; n < 256; ++n)
+    for (k = 1; k < 8; ++k)
+      gpi_cp_crc32c_table[k][n] =
+        (gpi_cp_crc32c_table[k - 1][n] >> 8)
+        ^ gpi_cp_crc32c_table[0][gpi_cp_crc32c_table[k - 1][n] & 0xff];
+
+#ifdef GPI_CP_CRC32C_SSE42
+  gpi_cp_crc32c_hardware = __builtin_cpu_supports ("sse4.2");
+  gpi_cp_crc32c_shift_1 = gpi_cp_crc32c_power (GPI_CP_CRC32C_LANE);
+  gpi_cp_crc32c_shift_2 = gpi_cp_crc32c_power (2 * GPI_CP_CRC32C_LANE);
+#endif
+}
+
+/* slicing-by-8, little endian */
+static uint32_t
+gpi_cp_crc32c_slice8 (uint32_t crc, const unsigned char* data, size_t size)
+{
+  while (size > 0 && ((uintptr_t) data & 7) != 0)
+    {
+      crc = gpi_cp_crc32c_table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+      --size;
+    }
+
+  while (size >= 8)
+    {
+      uint64_t word;
+      memcpy (&word, data, 8);
+      word ^= crc;
+
+      crc = gpi_cp_crc32c_table[7][word & 0xff]
+        ^ gpi_cp_crc32c_table[6][(word >> 8) & 0xff]
+        ^ gpi_cp_crc32c_table[5][(word >> 16) & 0xff]
+        ^ gpi_cp_crc32c_table[4][(word >> 24) & 0xff]
+        ^ gpi_cp_crc32c_table[3][(word >> 32) & 0xff]
+        ^ gpi_cp_crc32c_table[2][(word >> 40) & 0xff]
+        ^ gpi_cp_crc32c_table[1][(word >> 48) & 0xff]
+        ^ gpi_cp_crc32c_table[0][word >> 56];
+
+      data += 8;
+      size -= 8;
+    }
+
+  while (size > 0)
+    {
+      crc = gpi_cp_crc32c_table[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+      --size;
+    }
+
+  return crc;
+}
+
+uint32_t
+gpi_cp_crc32c (uint32_t crc, const void* data, size_t size)
+{
+  pthread_once (&gpi_cp_crc32c_once, gpi_cp_crc32c_init_table);
+
+#ifdef GPI_CP_CRC32C_SSE42
+  if (gpi_cp_crc32c_hardware)
+    return ~gpi_cp_crc32c_sse42 (~crc, data, size);
+#endif
+
+  return ~gpi_cp_crc32c_slice8 (~crc, data, size);
+}
+
+#define GPI_CP_HASH64_PRIME_1 (11400714785074694791ULL)
+#define GPI_CP_HASH64_PRIME_2 (14029467366897019727ULL)
+#define GPI_CP_HASH64_PRIME_3 (1609587929392839161ULL)
+#define GPI_CP_HASH64_PRIME_4 (9650029242287828579ULL)
+#define GPI_CP_HASH64_PRIME_5 (2870177450012600261ULL)
+
+static uint64_t
+gpi_cp_hash64_rotate (uint64_t x, int bits)
+{
+  return (x << bits) | (x >> (64 - bits));
+}
+
+static uint64_t
+gpi_cp_hash64_round (uint64_t accumulator, uint64_t input)
+{
+  accumulator += input * GPI_CP_HASH64_PRIME_2;
+  accumulator = gpi_cp_hash64_rotate (accumulator, 31);
+
+  return accumulator * GPI_CP_HASH64_PRIME_1;
+}
+
+static uint64_t
+gpi_cp_hash64_merge (uint64_t hash, uint64_t accumulator)
+{
+  hash ^= gpi_cp_hash64_round (0, accumulator);
+
+  return hash * GPI_CP_HASH64_PRIME_1 + GPI_CP_HASH64_PRIME_4;
+}
+
+static uint64_t
+gpi_cp_hash64_read64 (const unsigned char* p)
+{
+  uint64_t v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+static uint32_t
+gpi_cp_hash64_read32 (const unsigned char* p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+uint64_t
+gpi_cp_hash64 (const void* data, size_t size)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  const unsigned char* const end = p + size;
+  uint64_t hash;
+
+  if (size >= 32)
+    {
+      // four independent lanes of 8 bytes
+      uint64_t v1 = GPI_CP_HASH64_PRIME_1 + GPI_CP_HASH64_PRIME_2;
+      uint64_t v2 = GPI_CP_HASH64_PRIME_2;
+      uint64_t v3 = 0;
+      uint64_t v4 = -GPI_CP_HASH64_PRIME_1;
+
+      for (; p + 32 <= end; p += 32)
+        {
+          v1 = gpi_cp_hash64_round (v1, gpi_cp_hash64_read64 (p));
+          v2 = gpi_cp_hash64_round (v2, gpi_cp_hash64_read64 (p + 8));
+          v3 = gpi_cp_hash64_round (v3, gpi_cp_hash64_read64 (p + 16));
+          v4 = gpi_cp_hash64_round (v4, gpi_cp_hash64_read64 (p + 24));
+        }
+
+      hash = gpi_cp_hash64_rotate (v1, 1) + gpi_cp_hash64_rotate (v2, 7)
+        + gpi_cp_hash64_rotate (v3, 12) + gpi_cp_hash64_rotate (v4, 18);
+
+      hash = gpi_cp_hash64_merge (hash, v1);
+      hash = gpi_cp_hash64_merge (hash, v2);
+      hash = gpi_cp_hash64_merge (hash, v3);
+      hash = gpi_cp_hash64_merge (hash, v4);
+    }
+  else
+    hash = GPI_CP_HASH64_PRIME_5;
+
+  hash += size;
+
+  for (; p + 8 <= end; p += 8)
+    {
+      hash ^= gpi_cp_hash64_round (0, gpi_cp_hash64_read64 (p));
+      hash = gpi_cp_hash64_rotate (hash, 27) * GPI_CP_HASH64_PRIME_1 + GPI_CP_HASH64_PRIME_4;
+    }
+
+  if (p + 4 <= end)
+    {
+      hash ^= gpi_cp_hash64_read32 (p) * GPI_CP_HASH64_PRIME_1;
+      hash = gpi_cp_hash64_rotate (hash, 23) * GPI_CP_HASH64_PRIME_2 + GPI_CP_HASH64_PRIME_3;
+      p += 4;
+    }
+
+  for (; p < end; ++p)
+    {
+      hash ^= *p * GPI_CP_HASH64_PRIME_5;
+      hash = gpi_cp_hash64_rotate (hash, 11) * GPI_CP_HASH64_PRIME_1;
+    }
+
+  hash ^= hash >> 33;
+  hash *= GPI_CP_HASH64_PRIME_2;
+  hash ^= hash >> 29;
+  hash *= GPI_CP_HASH64_PRIME_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+int
+gpi_cp_is_zero (const void* data, size_t size)
+{
+  const unsigned char* const p = (const unsigned char*) data;
+  size_t i = 0;
+
+#ifdef GPI_CP_CRC32C_SSE42
+  // SSE2 is part of x86-64; a test per 256 bytes
+  for (; i + 256 <= size; i += 256)
+    {
+      __m128i any = _mm_setzero_si128 ();
+      size_t k;
+
+      for (k = 0; k < 256; k += 16)
+        any = _mm_or_si128 (any, _mm_loadu_si128 ((const __m128i*) (p + i + k)));
+
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (any, _mm_setzero_si128 ())) != 0xffff)
+        return 0;
+    }
+#endif
+
+  for (; i < size; ++i)
+    {
+      if (p[i] != 0)
+        return 0;
+    }
+
+  return 1;
+}
+
+struct gpi_cp_verifier
+{
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* the current job */
+  const void* data;
+  size_t size;
+  gpi_cp_checksum_record_t record;
+
+  bool busy;
+  bool stop;
+  int status;
+};
+
+static void*
+gpi_cp_verifier_thread (void* argument)
+{
+  gpi_cp_verifier_t* const verifier = argument;
+
+  pthread_mutex_lock (&verifier->mutex);
+
+  while (true)
+    {
+      while (!verifier->stop && !verifier->busy)
+        pthread_cond_wait (&verifier->cond, &verifier->mutex);
+
+      if (verifier->busy)
+        {
+          const void* const data = verifier->data;
+          size_t const size = verifier->size;
+          uint32_t const expected = verifier->record.checksum;
+
+          pthread_mutex_unlock (&verifier->mutex);
+
+          uint32_t const checksum = gpi_cp_crc32c (0, data, size);
+
+          pthread_mutex_lock (&verifier->mutex);
+
+          verifier->status = checksum == expected ? 0 : -1;
+          verifier->busy = false;
+          pthread_cond_broadcast (&verifier->cond);
+        }
+      else if (verifier->stop)
+        {
+          break;
+        }
+    }
+
+  pthread_mutex_unlock (&verifier->mutex);
+
+  return NULL;
+}
+
+gpi_cp_verifier_t*
+gpi_cp_verifier_create (void)
+{
+  gpi_cp_verifier_t* const verifier = calloc (1, sizeof (gpi_cp_verifier_t));
+
+  if (verifier == NULL)
+    return NULL;
+
+  pthread_mutex_init (&verifier->mutex, NULL);
+  pthread_cond_init (&verifier->cond, NULL);
+
+  if (pthread_create (&verifier->thread, NULL, gpi_cp_verifier_thread, verifier) != 0)
+    {
+      pthread_cond_destroy (&verifier->cond);
+      pthread_mutex_destroy (&verifier->mutex);
+      free (verifier);
+      return NULL;
+    }
+
+  return verifier;
+}
+
+int
+gpi_cp_verifier_post ( gpi_cp_verifier_t* verifier
+                     , const void* data
+                     , size_t size
+                     , const gpi_cp_checksum_record_t* record
+                     )
+{
+  pthread_mutex_lock (&verifier->mutex);
+
+  if (verifier->busy)
+    {
+      pthread_mutex_unlock (&verifier->mutex);
+      return -1;
+    }
+
+  verifier->data = data;
+  verifier->size = size;
+  verifier->record = *record;
+  verifier->busy = true;
+  verifier->status = 0;
+
+  pthread_cond_broadcast (&verifier->cond);
+  pthread_mutex_unlock (&verifier->mutex);
+
+  return 0;
+}
+
+int
+gpi_cp_verifier_wait (gpi_cp_verifier_t* verifier)
+{
+  pthread_mutex_lock (&verifier->mutex);
+
+  while (verifier->busy)
+    pthread_cond_wait (&verifier->cond, &verifier->mutex);
+
+  int const status = verifier->status;
+
+  /* report a mismatch once */
+  verifier->status = 0;
+
+  pthread_mutex_unlock (&verifier->mutex);
+
+  return status;
+}
+
+void
+gpi_cp_verifier_destroy (gpi_cp_verifier_t* verifier)
+{
+  gpi_cp_verifier_wait (verifier);
+
+  pthread_mutex_lock (&verifier->mutex);
+  verifier->stop = true;
+  pthread_cond_broadcast (&verifier->cond);
+  pthread_mutex_unlock (&verifier->mutex);
+
+  pthread_join (verifier->thread, NULL);
+
+  pthread_cond_destroy (&verifier->cond);
+  pthread_mutex_destroy (&verifier->mutex);
+  free (verifier);
+}
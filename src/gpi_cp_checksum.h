@@ -0,0 +1,90 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+ * @file   gpi_cp_checksum.h
+ *
+ * @brief  Internal: checksums of snapshot data.
+ *
+ */
+
+#ifndef _GPI_CP_CHECKSUM_H_
+#define _GPI_CP_CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** CRC32C (Castagnoli) of size bytes at data
+ *
+ * \param crc: 0 to start, or the result of a previous call to continue
+ */
+uint32_t
+gpi_cp_crc32c (uint32_t crc, const void* data, size_t size);
+
+/** 64 bit hash (XXH64, seed 0) of size bytes at data, to tell blocks
+ *  of equal content apart */
+uint64_t
+gpi_cp_hash64 (const void* data, size_t size);
+
+/** whether the size bytes at data are all zero */
+int
+gpi_cp_is_zero (const void* data, size_t size);
+
+/* checksum of a snapshot, stored on the receiver next to the slot */
+typedef struct
+{
+  uint64_t epoch;     /* the snapshot becomes this epoch when committed */
+  uint32_t checksum;  /* CRC32C of the data */
+  uint32_t reserved;
+} gpi_cp_checksum_record_t;
+
+typedef struct gpi_cp_verifier gpi_cp_verifier_t;
+
+/** start a background verifier
+ *
+ * \return NULL in case of error
+ */
+gpi_cp_verifier_t*
+gpi_cp_verifier_create (void);
+
+/** check size bytes at data against record in the background
+ *
+ * \note data must stay untouched until gpi_cp_verifier_wait returned
+ * \return 0 in case of success, -1 if the verifier is still busy
+ */
+int
+gpi_cp_verifier_post ( gpi_cp_verifier_t* verifier
+                     , const void* data
+                     , size_t size
+                     , const gpi_cp_checksum_record_t* record
+                     );
+
+/** wait for the last posted check
+ *
+ * \return 0 if the data matched (or nothing was posted), -1 otherwise;
+ *         a mismatch is reported once
+ */
+int
+gpi_cp_verifier_wait (gpi_cp_verifier_t* verifier);
+
+/** wait for the verifier and stop it */
+void
+gpi_cp_verifier_destroy (gpi_cp_verifier_t* verifier);
+
+#endif //_GPI_CP_CHECKSUM_H_
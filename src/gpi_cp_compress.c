@@ -0,0 +1,505 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined (__x86_64__) && defined (__GNUC__)
+#include <emmintrin.h>
+#define GPI_CP_COMPRESS_SSE2 1
+#endif
+
+#include "gpi_cp_compress.h"
+
+/* LZ77 in the format of LZ4 blocks: a token with the number of
+   literals and the match length (4 bits each, 15: more bytes follow,
+   each adding up to 255), the literals, a 2 byte offset, the match.
+   The last sequence has literals only. */
+#define GPI_CP_LZ_MIN_MATCH (4)
+#define GPI_CP_LZ_MAX_OFFSET (65535)
+#define GPI_CP_LZ_HASH_BITS (13)
+
+size_t
+gpi_cp_compress_table_size (size_t size)
+{
+  size_t const chunks =
+    (size + GPI_CP_COMPRESS_CHUNK_SIZE - 1) / GPI_CP_COMPRESS_CHUNK_SIZE;
+  size_t const bytes =
+    sizeof (gpi_cp_compressed_header_t) + chunks * sizeof (uint32_t);
+
+  return (bytes + 7) & ~(size_t) 7;
+}
+
+size_t
+gpi_cp_compress_bound (size_t size)
+{
+  return gpi_cp_compress_table_size (size) + ((size + 7) & ~(size_t) 7);
+}
+
+static uint32_t
+gpi_cp_lz_read32 (const uint8_t* p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+static uint32_t
+gpi_cp_lz_hash (uint32_t v)
+{
+  return (v * 2654435761U) >> (32 - GPI_CP_LZ_HASH_BITS);
+}
+
+/* a length beyond the 4 bits of the token */
+static uint8_t*
+gpi_cp_lz_put_length (uint8_t* op, const uint8_t* oend, size_t length)
+{
+  for (; length >= 255; length -= 255)
+    {
+      if (op >= oend)
+        return NULL;
+      *op++ = 255;
+    }
+
+  if (op >= oend)
+    return NULL;
+  *op++ = (uint8_t) length;
+
+  return op;
+}
+
+/* one sequence, match 0 for the last one */
+static uint8_t*
+gpi_cp_lz_put_sequence ( uint8_t* op
+                       , const uint8_t* oend
+                       , const uint8_t* literals
+                       , size_t number_of_literals
+                       , size_t offset
+                       , size_t match
+                       )
+{
+  size_t const match_code = match ? match - GPI_CP_LZ_MIN_MATCH : 0;
+
+  if (op >= oend)
+    return NULL;
+
+  uint8_t* const token = op++;
+  *token = (uint8_t) (((number_of_literals < 15 ? number_of_literals : 15) << 4)
+                     | (match_code < 15 ? match_code : 15));
+
+  if (number_of_literals >= 15)
+    {
+      op = gpi_cp_lz_put_length (op, oend, number_of_literals - 15);
+      if (op == NULL)
+        return NULL;
+    }
+
+  if ((size_t) (oend - op) < number_of_literals)
+    return NULL;
+  memcpy (op, literals, number_of_literals);
+  op += number_of_literals;
+
+  if (match == 0)
+    return op;
+
+  if (oend - op < 2)
+    return NULL;
+  *op++ = (uint8_t) (offset & 0xff);
+  *op++ = (uint8_t) (offset >> 8);
+
+  if (match_code >= 15)
+    op = gpi_cp_lz_put_length (op, oend, match_code - 15);
+
+  return op;
+}
+
+static size_t
+gpi_cp_lz_compress ( uint8_t* dst
+                   , size_t capacity
+                   , const uint8_t* src
+                   , size_t size
+                   )
+{
+  uint32_t table[1 << GPI_CP_LZ_HASH_BITS];
+  memset (table, 0, sizeof (table));
+
+  uint8_t* op = dst;
+  const uint8_t* const oend = dst + capacity;
+  size_t ip = 0;
+  size_t anchor = 0;
+
+  while (ip + GPI_CP_LZ_MIN_MATCH <= size)
+    {
+      uint32_t const sequence = gpi_cp_lz_read32 (src + ip);
+      uint32_t const h = gpi_cp_lz_hash (sequence);
+      size_t const candidate = table[h];
+      table[h] = (uint32_t) ip;
+
+      if ( candidate >= ip
+         || ip - candidate > GPI_CP_LZ_MAX_OFFSET
+         || gpi_cp_lz_read32 (src + candidate) != sequence
+         )
+        {
+          ++ip;
+          continue;
+        }
+
+      size_t match = GPI_CP_LZ_MIN_MATCH;
+      while (ip + match < size && src[candidate + match] == src[ip + match])
+        ++match;
+
+      op = gpi_cp_lz_put_sequence ( op, oend
+                                  , src + anchor, ip - anchor
+                                  , ip - candidate, match
+                                  );
+      if (op == NULL)
+        return 0;
+
+      ip += match;
+      anchor = ip;
+    }
+
+  if (anchor < size)
+    {
+      op = gpi_cp_lz_put_sequence (op, oend, src + anchor, size - anchor, 0, 0);
+      if (op == NULL)
+        return 0;
+    }
+
+  return (size_t) (op - dst);
+}
+
+/* a length beyond the 4 bits of the token, -1 if the input ends */
+static int
+gpi_cp_lz_get_length (const uint8_t** ip, const uint8_t* iend, size_t* length)
+{
+  uint8_t byte;
+
+  do
+    {
+      if (*ip >= iend)
+        return -1;
+
+      byte = *(*ip)++;
+      *length += byte;
+    }
+  while (byte == 255);
+
+  return 0;
+}
+
+static int
+gpi_cp_lz_decompress ( uint8_t* dst
+                     , size_t size
+                     , const uint8_t* src
+                     , size_t length
+                     )
+{
+  const uint8_t* ip = src;
+  const uint8_t* const iend = src + length;
+  uint8_t* op = dst;
+  uint8_t* const oend = dst + size;
+
+  while (ip < iend)
+    {
+      uint8_t const token = *ip++;
+      size_t number_of_literals = token >> 4;
+
+      if (number_of_literals == 15 && gpi_cp_lz_get_length (&ip, iend, &number_of_literals))
+        return -1;
+
+      if ( (size_t) (iend - ip) < number_of_literals
+         || (size_t) (oend - op) < number_of_literals
+         )
+        return -1;
+
+      memcpy (op, ip, number_of_literals);
+      ip += number_of_literals;
+      op += number_of_literals;
+
+      if (ip == iend)
+        break;
+
+      if (iend - ip < 2)
+        return -1;
+
+      size_t const offset = ip[0] | ((size_t) ip[1] << 8);
+      ip += 2;
+
+      size_t match = token & 15;
+
+      if (match == 15 && gpi_cp_lz_get_length (&ip, iend, &match))
+        return -1;
+
+      match += GPI_CP_LZ_MIN_MATCH;
+
+      if ( offset == 0
+         || offset > (size_t) (op - dst)
+         || (size_t) (oend - op) < match
+         )
+        return -1;
+
+      // may overlap, byte by byte
+      const uint8_t* from = op - offset;
+      for (size_t k = 0; k < match; ++k)
+        *op++ = *from++;
+    }
+
+  return op == oend ? 0 : -1;
+}
+
+/* byte k of every element together, the bytes beyond the last whole
+   element stay where they are */
+static void
+gpi_cp_shuffle ( uint8_t* dst
+               , const uint8_t* src
+               , size_t size
+               , size_t element_size
+               )
+{
+  size_t const n = size / element_size;
+
+  for (size_t k = 0; k < element_size; ++k)
+    {
+      for (size_t i = 0; i < n; ++i)
+        dst[k * n + i] = src[i * element_size + k];
+    }
+
+  memcpy (dst + n * element_size, src + n * element_size, size - n * element_size);
+}
+
+static void
+gpi_cp_unshuffle ( uint8_t* dst
+                 , const uint8_t* src
+                 , size_t size
+                 , size_t element_size
+                 )
+{
+  size_t const n = size / element_size;
+
+  for (size_t k = 0; k < element_size; ++k)
+    {
+      for (size_t i = 0; i < n; ++i)
+        dst[i * element_size + k] = src[k * n + i];
+    }
+
+  memcpy (dst + n * element_size, src + n * element_size, size - n * element_size);
+}
+
+unsigned int
+gpi_cp_compress_dropped_bits (double relative_error, unsigned int mantissa_bits)
+{
+  // rounding to kept bits errs by at most 2^-(kept + 1)
+  double error = 0.5;
+  unsigned int kept = 0;
+
+  while (error > relative_error && kept < mantissa_bits)
+    {
+      error /= 2;
+      ++kept;
+    }
+
+  return mantissa_bits - kept;
+}
+
+/* round every element to the nearest value with dropped_bits zero
+   mantissa bits (ties away from zero); infinities and NaNs stay, as
+   does a value that would round to infinity */
+static void
+gpi_cp_round_doubles ( uint8_t* dst
+                     , const uint8_t* src
+                     , size_t n
+                     , unsigned int dropped_bits
+                     )
+{
+  uint64_t const half = (uint64_t) 1 << (dropped_bits - 1);
+  uint64_t const mask = ~(((uint64_t) 1 << dropped_bits) - 1);
+  uint64_t const exponent = (uint64_t) 0x7ff << 52;
+  size_t i = 0;
+
+#ifdef GPI_CP_COMPRESS_SSE2
+  __m128i const half_v = _mm_set1_epi64x ((long long) half);
+  __m128i const mask_v = _mm_set1_epi64x ((long long) mask);
+  __m128i const exponent_v = _mm_set1_epi32 (0x7ff00000);
+
+  for (; i + 2 <= n; i += 2)
+    {
+      __m128i const x = _mm_loadu_si128 ((const __m128i*) (src + 8 * i));
+      __m128i const r = _mm_and_si128 (_mm_add_epi64 (x, half_v), mask_v);
+
+      // the exponent lies in the upper half of each element
+      __m128i const special_x =
+        _mm_cmpeq_epi32 (_mm_and_si128 (x, exponent_v), exponent_v);
+      __m128i const special_r =
+        _mm_cmpeq_epi32 (_mm_and_si128 (r, exponent_v), exponent_v);
+      __m128i const special =
+        _mm_shuffle_epi32 (_mm_or_si128 (special_x, special_r), _MM_SHUFFLE (3, 3, 1, 1));
+
+      _mm_storeu_si128 ( (__m128i*) (dst + 8 * i)
+                       , _mm_or_si128 ( _mm_and_si128 (special, x)
+                                      , _mm_andnot_si128 (special, r)
+                                      )
+                       );
+    }
+#endif
+
+  for (; i < n; ++i)
+    {
+      uint64_t x;
+      memcpy (&x, src + 8 * i, sizeof (x));
+
+      uint64_t const r = (x + half) & mask;
+
+      if ((x & exponent) != exponent && (r & exponent) != exponent)
+        x = r;
+
+      memcpy (dst + 8 * i, &x, sizeof (x));
+    }
+}
+
+static void
+gpi_cp_round_floats ( uint8_t* dst
+                    , const uint8_t* src
+                    , size_t n
+                    , unsigned int dropped_bits
+                    )
+{
+  uint32_t const half = (uint32_t) 1 << (dropped_bits - 1);
+  uint32_t const mask = ~(((uint32_t) 1 << dropped_bits) - 1);
+  uint32_t const exponent = (uint32_t) 0xff << 23;
+  size_t i = 0;
+
+#ifdef GPI_CP_COMPRESS_SSE2
+  __m128i const half_v = _mm_set1_epi32 ((int) half);
+  __m128i const mask_v = _mm_set1_epi32 ((int) mask);
+  __m128i const exponent_v = _mm_set1_epi32 ((int) exponent);
+
+  for (; i + 4 <= n; i += 4)
+    {
+      __m128i const x = _mm_loadu_si128 ((const __m128i*) (src + 4 * i));
+      __m128i const r = _mm_and_si128 (_mm_add_epi32 (x, half_v), mask_v);
+      __m128i const special =
+        _mm_or_si128 ( _mm_cmpeq_epi32 (_mm_and_si128 (x, exponent_v), exponent_v)
+                     , _mm_cmpeq_epi32 (_mm_and_si128 (r, exponent_v), exponent_v)
+                     );
+
+      _mm_storeu_si128 ( (__m128i*) (dst + 4 * i)
+                       , _mm_or_si128 ( _mm_and_si128 (special, x)
+                                      , _mm_andnot_si128 (special, r)
+                                      )
+                       );
+    }
+#endif
+
+  for (; i < n; ++i)
+    {
+      uint32_t x;
+      memcpy (&x, src + 4 * i, sizeof (x));
+
+      uint32_t const r = (x + half) & mask;
+
+      if ((x & exponent) != exponent && (r & exponent) != exponent)
+        x = r;
+
+      memcpy (dst + 4 * i, &x, sizeof (x));
+    }
+}
+
+size_t
+gpi_cp_compress_chunk ( void* dst
+                      , size_t capacity
+                      , const void* src
+                      , size_t size
+                      , size_t element_size
+                      , unsigned int dropped_bits
+                      , void* scratch
+                      , uint32_t* length
+                      )
+{
+  const uint8_t* input = (const uint8_t*) src;
+  uint8_t* const rounded = (uint8_t*) scratch + GPI_CP_COMPRESS_CHUNK_SIZE;
+
+  if (dropped_bits > 0 && (element_size == 4 || element_size == 8))
+    {
+      size_t const n = size / element_size;
+
+      if (element_size == 8)
+        gpi_cp_round_doubles (rounded, input, n, dropped_bits);
+      else
+        gpi_cp_round_floats (rounded, input, n, dropped_bits);
+
+      memcpy (rounded + n * element_size, input + n * element_size, size - n * element_size);
+      input = rounded;
+    }
+
+  if (element_size > 1)
+    {
+      gpi_cp_shuffle ((uint8_t*) scratch, input, size, element_size);
+      input = (const uint8_t*) scratch;
+    }
+
+  // smaller than the data, or not at all
+  size_t const bound = (capacity < size) ? capacity : size - 1;
+  size_t const compressed =
+    (size > 0) ? gpi_cp_lz_compress ((uint8_t*) dst, bound, input, size) : 0;
+
+  if (compressed > 0)
+    {
+      *length = (uint32_t) compressed;
+      return compressed;
+    }
+
+  if (capacity < size)
+    return 0;
+
+  memcpy (dst, src, size);
+  *length = (uint32_t) size | GPI_CP_COMPRESS_STORED;
+
+  return size;
+}
+
+int
+gpi_cp_decompress_chunk ( void* dst
+                        , size_t size
+                        , const void* src
+                        , uint32_t length
+                        , size_t element_size
+                        , void* scratch
+                        )
+{
+  if (length & GPI_CP_COMPRESS_STORED)
+    {
+      if ((length & ~GPI_CP_COMPRESS_STORED) != size)
+        return -1;
+
+      memcpy (dst, src, size);
+      return 0;
+    }
+
+  if (element_size <= 1)
+    return gpi_cp_lz_decompress ((uint8_t*) dst, size, (const uint8_t*) src, length);
+
+  if (gpi_cp_lz_decompress ((uint8_t*) scratch, size, (const uint8_t*) src, length))
+    return -1;
+
+  gpi_cp_unshuffle ((uint8_t*) dst, (const uint8_t*) scratch, size, element_size);
+
+  return 0;
+}
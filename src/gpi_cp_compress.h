@@ -0,0 +1,107 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_compress.h
+ *
+ * @brief  Internal: lossless compression of snapshots.
+ *
+ */
+
+#ifndef _GPI_CP_COMPRESS_H_
+#define _GPI_CP_COMPRESS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* chunks are compressed on their own, so that the transfer of one
+   overlaps with the compression of the next */
+#define GPI_CP_COMPRESS_CHUNK_SIZE (256 * 1024)
+
+/* Compressed snapshot
+
+   [header][length of every chunk][padding to 8 bytes][chunks]
+
+   a chunk is the byte shuffled data (byte k of every element, then
+   byte k + 1, ...), LZ compressed; one that does not get smaller is
+   stored as it is, flagged in its length. Lossy compression rounds
+   the floating point elements to fewer mantissa bits before, the rest
+   is the same.
+*/
+#define GPI_CP_COMPRESS_STORED (1U << 31)
+
+typedef struct
+{
+  uint64_t size;          /* bytes of data */
+  uint64_t payload;       /* bytes of the chunks */
+  uint32_t chunk_size;
+  uint32_t element_size;  /* of the shuffle, 1: none */
+} gpi_cp_compressed_header_t;
+
+/** bytes before the chunks */
+size_t
+gpi_cp_compress_table_size (size_t size);
+
+/** bytes of the largest compressed snapshot of size bytes */
+size_t
+gpi_cp_compress_bound (size_t size);
+
+/** compress one chunk of size bytes (at most GPI_CP_COMPRESS_CHUNK_SIZE)
+ *
+ * \param dropped_bits: of the mantissa of every element (4 or 8 bytes:
+ *                      float or double), 0 for lossless compression
+ * \param scratch: 2 * GPI_CP_COMPRESS_CHUNK_SIZE bytes
+ * \param length: gets the entry of the chunk in the table
+ * \return bytes written to dst, 0 if they do not fit into capacity
+ */
+size_t
+gpi_cp_compress_chunk ( void* dst
+                      , size_t capacity
+                      , const void* src
+                      , size_t size
+                      , size_t element_size
+                      , unsigned int dropped_bits
+                      , void* scratch
+                      , uint32_t* length
+                      );
+
+/** mantissa bits to drop so that rounding keeps the relative error of
+ *  normal numbers within relative_error
+ *
+ * \param mantissa_bits: 23 for float, 52 for double
+ */
+unsigned int
+gpi_cp_compress_dropped_bits (double relative_error, unsigned int mantissa_bits);
+
+/** decompress one chunk with entry length into size bytes at dst
+ *
+ * \param scratch: GPI_CP_COMPRESS_CHUNK_SIZE bytes
+ * \return 0 in case of success, -1 if the chunk is corrupt
+ */
+int
+gpi_cp_decompress_chunk ( void* dst
+                        , size_t size
+                        , const void* src
+                        , uint32_t length
+                        , size_t element_size
+                        , void* scratch
+                        );
+
+#endif //_GPI_CP_COMPRESS_H_
@@ -0,0 +1,327 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__x86_64__) && defined (__GNUC__)
+#include <emmintrin.h>
+#define GPI_CP_COPY_SSE2 1
+#endif
+
+#include "gpi_cp_copy.h"
+
+void
+gpi_cp_stream_copy ( void* dst
+                   , const void* src
+                   , size_t size
+                   )
+{
+  uint8_t* d = (uint8_t*) dst;
+  const uint8_t* s = (const uint8_t*) src;
+
+#ifdef GPI_CP_COPY_SSE2
+  // up to the first aligned destination, the streaming stores need it
+  size_t const head = (16 - ((uintptr_t) d & 15)) & 15;
+
+  if (size >= head + 64)
+    {
+      memcpy (d, s, head);
+      d += head;
+      s += head;
+      size -= head;
+
+      for (; size >= 64; size -= 64, d += 64, s += 64)
+        {
+          __m128i const v0 = _mm_loadu_si128 ((const __m128i*) (s));
+          __m128i const v1 = _mm_loadu_si128 ((const __m128i*) (s + 16));
+          __m128i const v2 = _mm_loadu_si128 ((const __m128i*) (s + 32));
+          __m128i const v3 = _mm_loadu_si128 ((const __m128i*) (s + 48));
+
+          _mm_stream_si128 ((__m128i*) (d), v0);
+          _mm_stream_si128 ((__m128i*) (d + 16), v1);
+          _mm_stream_si128 ((__m128i*) (d + 32), v2);
+          _mm_stream_si128 ((__m128i*) (d + 48), v3);
+        }
+
+      _mm_sfence ();
+    }
+#endif
+
+  memcpy (d, s, size);
+}
+
+typedef struct
+{
+  gpi_cp_copy_team_t* team;
+  pthread_t thread;
+  unsigned int index;
+} gpi_cp_copy_worker_t;
+
+struct gpi_cp_copy_team
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  gpi_cp_copy_worker_t* workers;
+  unsigned int threads;
+
+  /* the current job */
+  unsigned long job; /* counts the posts */
+  char* dst;
+  const char* src;
+  size_t size;
+  size_t chunks;
+  size_t* done; /* indices of the chunks done, in that order */
+  size_t done_capacity;
+  size_t number_done;
+  size_t number_returned;
+
+  bool busy;
+  bool stop;
+};
+
+static void*
+gpi_cp_copy_worker_thread (void* argument)
+{
+  gpi_cp_copy_worker_t* const worker = argument;
+  gpi_cp_copy_team_t* const team = worker->team;
+  unsigned long job = 0;
+
+  pthread_mutex_lock (&team->mutex);
+
+  while (true)
+    {
+      while (!team->stop && team->job == job)
+        pthread_cond_wait (&team->cond, &team->mutex);
+
+      if (team->stop)
+        break;
+
+      job = team->job;
+
+      char* const dst = team->dst;
+      const char* const src = team->src;
+      size_t const size = team->size;
+      size_t const first = team->chunks * worker->index / team->threads;
+      size_t const last = team->chunks * (worker->index + 1) / team->threads;
+
+      size_t k;
+      for (k = first; k < last; ++k)
+        {
+          size_t const offset = k * GPI_CP_COPY_CHUNK_SIZE;
+          size_t const length =
+            (size - offset < GPI_CP_COPY_CHUNK_SIZE) ? size - offset : GPI_CP_COPY_CHUNK_SIZE;
+
+          pthread_mutex_unlock (&team->mutex);
+
+          gpi_cp_stream_copy (dst + offset, src + offset, length);
+
+          pthread_mutex_lock (&team->mutex);
+
+          team->done[team->number_done++] = k;
+          pthread_cond_broadcast (&team->cond);
+        }
+    }
+
+  pthread_mutex_unlock (&team->mutex);
+
+  return NULL;
+}
+
+/* the i-th of n CPUs spread over the affinity mask of the process */
+static void
+gpi_cp_copy_bind ( pthread_t thread
+                 , const cpu_set_t* allowed
+                 , unsigned int i
+                 , unsigned int n
+                 )
+{
+  int const count = CPU_COUNT (allowed);
+
+  if (count == 0)
+    return;
+
+  int const wanted = (int) ((unsigned long) i * count / n);
+  int seen = 0;
+  int cpu;
+
+  for (cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (!CPU_ISSET (cpu, allowed))
+        continue;
+
+      if (seen++ == wanted)
+        {
+          cpu_set_t set;
+          CPU_ZERO (&set);
+          CPU_SET (cpu, &set);
+
+          /* an unbound thread is only slower */
+          pthread_setaffinity_np (thread, sizeof (set), &set);
+          return;
+        }
+    }
+}
+
+gpi_cp_copy_team_t*
+gpi_cp_copy_team_create (unsigned int threads)
+{
+  if (threads == 0)
+    return NULL;
+
+  gpi_cp_copy_team_t* const team = calloc (1, sizeof (gpi_cp_copy_team_t));
+
+  if (team == NULL)
+    return NULL;
+
+  team->workers = calloc (threads, sizeof (gpi_cp_copy_worker_t));
+
+  if (team->workers == NULL)
+    {
+      free (team);
+      return NULL;
+    }
+
+  pthread_mutex_init (&team->mutex, NULL);
+  pthread_cond_init (&team->cond, NULL);
+
+  cpu_set_t allowed;
+  bool const bind = sched_getaffinity (0, sizeof (allowed), &allowed) == 0;
+
+  for (team->threads = 0; team->threads < threads; ++team->threads)
+    {
+      gpi_cp_copy_worker_t* const worker = &team->workers[team->threads];
+
+      worker->team = team;
+      worker->index = team->threads;
+
+      if (pthread_create (&worker->thread, NULL, gpi_cp_copy_worker_thread, worker) != 0)
+        {
+          gpi_cp_copy_team_destroy (team);
+          return NULL;
+        }
+
+      if (bind)
+        gpi_cp_copy_bind (worker->thread, &allowed, worker->index, threads);
+    }
+
+  return team;
+}
+
+int
+gpi_cp_copy_team_post ( gpi_cp_copy_team_t* team
+                      , void* dst
+                      , const void* src
+                      , size_t size
+                      )
+{
+  size_t const chunks = (size + GPI_CP_COPY_CHUNK_SIZE - 1) / GPI_CP_COPY_CHUNK_SIZE;
+
+  pthread_mutex_lock (&team->mutex);
+
+  if (team->busy)
+    {
+      pthread_mutex_unlock (&team->mutex);
+      return -1;
+    }
+
+  if (chunks > team->done_capacity)
+    {
+      size_t* const done = realloc (team->done, chunks * sizeof (size_t));
+
+      if (done == NULL)
+        {
+          pthread_mutex_unlock (&team->mutex);
+          return -1;
+        }
+
+      team->done = done;
+      team->done_capacity = chunks;
+    }
+
+  team->dst = (char*) dst;
+  team->src = (const char*) src;
+  team->size = size;
+  team->chunks = chunks;
+  team->number_done = 0;
+  team->number_returned = 0;
+  team->busy = true;
+  team->job++;
+
+  pthread_cond_broadcast (&team->cond);
+  pthread_mutex_unlock (&team->mutex);
+
+  return 0;
+}
+
+long
+gpi_cp_copy_team_next (gpi_cp_copy_team_t* team)
+{
+  long chunk = -1;
+
+  pthread_mutex_lock (&team->mutex);
+
+  if (team->busy)
+    {
+      if (team->number_returned == team->chunks)
+        {
+          team->busy = false;
+        }
+      else
+        {
+          while (team->number_returned == team->number_done)
+            pthread_cond_wait (&team->cond, &team->mutex);
+
+          chunk = (long) team->done[team->number_returned++];
+        }
+    }
+
+  pthread_mutex_unlock (&team->mutex);
+
+  return chunk;
+}
+
+void
+gpi_cp_copy_team_destroy (gpi_cp_copy_team_t* team)
+{
+  while (gpi_cp_copy_team_next (team) >= 0)
+    ;
+
+  pthread_mutex_lock (&team->mutex);
+  team->stop = true;
+  pthread_cond_broadcast (&team->cond);
+  pthread_mutex_unlock (&team->mutex);
+
+  unsigned int i;
+  for (i = 0; i < team->threads; ++i)
+    pthread_join (team->workers[i].thread, NULL);
+
+  pthread_cond_destroy (&team->cond);
+  pthread_mutex_destroy (&team->mutex);
+  free (team->done);
+  free (team->workers);
+  free (team);
+}
@@ -0,0 +1,91 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_copy.h
+ *
+ * @brief  Internal: copies of snapshots that bypass the caches.
+ *
+ */
+
+#ifndef _GPI_CP_COPY_H_
+#define _GPI_CP_COPY_H_
+
+#include <stddef.h>
+
+/* granularity of the team: chunks are handed out when copied */
+#define GPI_CP_COPY_CHUNK_SIZE (4 * 1024 * 1024)
+
+/** copy size bytes from src to dst with non-temporal stores
+ *
+ * for copies that are not read again soon, they do not evict the data
+ * of the application from the caches; the stores are complete (fenced)
+ * on return
+ */
+void
+gpi_cp_stream_copy ( void* dst
+                   , const void* src
+                   , size_t size
+                   );
+
+typedef struct gpi_cp_copy_team gpi_cp_copy_team_t;
+
+/** start threads to copy with
+ *
+ * thread i is bound to the i-th of threads CPUs spread evenly over
+ * those the process may run on, so with an application that touched
+ * its data first in a static schedule every thread copies memory of
+ * its own NUMA node
+ *
+ * \return NULL in case of error
+ */
+gpi_cp_copy_team_t*
+gpi_cp_copy_team_create (unsigned int threads);
+
+/** hand size bytes from src to dst to the team
+ *
+ * thread i copies the i-th contiguous share of the chunks, in chunks
+ * of GPI_CP_COPY_CHUNK_SIZE bytes, with gpi_cp_stream_copy
+ *
+ * \return 0 in case of success, -1 if the team is still busy or out
+ *         of memory
+ */
+int
+gpi_cp_copy_team_post ( gpi_cp_copy_team_t* team
+                      , void* dst
+                      , const void* src
+                      , size_t size
+                      );
+
+/** wait for the next chunk of the posted copy that is done
+ *
+ * chunks are returned once each, in the order they were done
+ *
+ * \return the index of the chunk, -1 once all were returned (the team
+ *         is idle then)
+ */
+long
+gpi_cp_copy_team_next (gpi_cp_copy_team_t* team);
+
+/** wait for the team and stop it */
+void
+gpi_cp_copy_team_destroy (gpi_cp_copy_team_t* team);
+
+#endif //_GPI_CP_COPY_H_
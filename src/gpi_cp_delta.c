@@ -0,0 +1,126 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdint.h>
+
+#if defined (__x86_64__) && defined (__GNUC__)
+#include <emmintrin.h>
+#define GPI_CP_DELTA_SSE2 1
+#endif
+
+#include "gpi_cp_delta.h"
+
+size_t
+gpi_cp_delta_table_size (size_t size)
+{
+  size_t const chunks = (size + GPI_CP_DELTA_CHUNK_SIZE - 1) / GPI_CP_DELTA_CHUNK_SIZE;
+
+  return (chunks * sizeof (uint32_t) + 7) & ~(size_t) 7;
+}
+
+size_t
+gpi_cp_delta_slot_size (size_t size)
+{
+  return ((size + 7) & ~(size_t) 7)
+    + gpi_cp_delta_table_size (size)
+    + sizeof (gpi_cp_delta_header_t);
+}
+
+/* x = a ^ b, and a = b if update (a is read only otherwise) */
+static void
+gpi_cp_delta_xor ( uint8_t* x
+                 , uint8_t* a
+                 , const uint8_t* b
+                 , size_t size
+                 , int update
+                 )
+{
+  size_t i = 0;
+
+#ifdef GPI_CP_DELTA_SSE2
+  for (; i + 16 <= size; i += 16)
+    {
+      __m128i const va = _mm_loadu_si128 ((const __m128i*) (a + i));
+      __m128i const vb = _mm_loadu_si128 ((const __m128i*) (b + i));
+
+      _mm_storeu_si128 ((__m128i*) (x + i), _mm_xor_si128 (va, vb));
+
+      if (update)
+        _mm_storeu_si128 ((__m128i*) (a + i), vb);
+    }
+#endif
+
+  for (; i < size; ++i)
+    {
+      uint8_t const vb = b[i];
+
+      x[i] = a[i] ^ vb;
+
+      if (update)
+        a[i] = vb;
+    }
+}
+
+size_t
+gpi_cp_delta_encode_chunk ( void* dst
+                          , size_t capacity
+                          , void* previous
+                          , const void* current
+                          , size_t size
+                          , size_t element_size
+                          , void* scratch
+                          , uint32_t* length
+                          )
+{
+  // the compression uses the first two chunks of scratch
+  uint8_t* const difference = (uint8_t*) scratch + 2 * GPI_CP_DELTA_CHUNK_SIZE;
+
+  gpi_cp_delta_xor (difference, (uint8_t*) previous, (const uint8_t*) current, size, 1);
+
+  return gpi_cp_compress_chunk ( dst
+                               , capacity
+                               , difference
+                               , size
+                               , element_size
+                               , 0
+                               , scratch
+                               , length
+                               );
+}
+
+int
+gpi_cp_delta_apply_chunk ( void* dst
+                         , const void* base
+                         , size_t size
+                         , const void* src
+                         , uint32_t length
+                         , size_t element_size
+                         , void* scratch
+                         )
+{
+  uint8_t* const difference = (uint8_t*) scratch + 2 * GPI_CP_DELTA_CHUNK_SIZE;
+
+  if (gpi_cp_decompress_chunk (difference, size, src, length, element_size, scratch))
+    return -1;
+
+  // src is consumed, dst may be overwritten; base is not changed
+  gpi_cp_delta_xor ((uint8_t*) dst, (uint8_t*) base, difference, size, 0);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_delta.h
+ *
+ * @brief  Internal: XOR deltas of snapshots against the previous one.
+ *
+ */
+
+#ifndef _GPI_CP_DELTA_H_
+#define _GPI_CP_DELTA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gpi_cp_compress.h"
+
+/* chunks of the compression */
+#define GPI_CP_DELTA_CHUNK_SIZE GPI_CP_COMPRESS_CHUNK_SIZE
+#define GPI_CP_DELTA_SCRATCH_SIZE (3 * GPI_CP_DELTA_CHUNK_SIZE)
+
+/* Slot of a delta snapshot
+
+   [data][free][length of every chunk][chunks][header]
+
+   the data is where it is in every other slot. A delta is the XOR of
+   the data with the one of base_epoch, compressed chunk by chunk like
+   a compressed snapshot; it lands right before the header, so that it
+   can be applied in place: chunk k is decompressed before the data of
+   chunk k overwrites it, and never reaches later chunks. Without a
+   base epoch the data was written as it is.
+*/
+typedef struct
+{
+  uint64_t base_epoch;    /* 0: no delta */
+  uint64_t size;          /* bytes of data */
+  uint64_t payload;       /* bytes of the chunks */
+  uint32_t chunk_size;
+  uint32_t element_size;  /* of the shuffle, 1: none */
+} gpi_cp_delta_header_t;
+
+/** bytes of the lengths of the chunks */
+size_t
+gpi_cp_delta_table_size (size_t size);
+
+/** bytes of a slot for size bytes of data */
+size_t
+gpi_cp_delta_slot_size (size_t size);
+
+/** encode the difference of one chunk of size bytes to previous and
+ *  make previous the current data
+ *
+ * \param scratch: GPI_CP_DELTA_SCRATCH_SIZE bytes
+ * \param length: gets the entry of the chunk in the table
+ * \return bytes written to dst, 0 if they do not fit into capacity
+ *         (previous is updated nevertheless)
+ */
+size_t
+gpi_cp_delta_encode_chunk ( void* dst
+                          , size_t capacity
+                          , void* previous
+                          , const void* current
+                          , size_t size
+                          , size_t element_size
+                          , void* scratch
+                          , uint32_t* length
+                          );
+
+/** dst = base XOR the decoded chunk at src
+ *
+ * dst may overlap src, not base
+ *
+ * \param scratch: GPI_CP_DELTA_SCRATCH_SIZE bytes
+ * \return 0 in case of success, -1 if the chunk is corrupt
+ */
+int
+gpi_cp_delta_apply_chunk ( void* dst
+                         , const void* base
+                         , size_t size
+                         , const void* src
+                         , uint32_t length
+                         , size_t element_size
+                         , void* scratch
+                         );
+
+#endif //_GPI_CP_DELTA_H_
@@ -0,0 +1,864 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef GPI_CP_WITH_LIBURING
+#include <liburing.h>
+#endif
+
+#include "gpi_cp_checksum.h"
+#include "gpi_cp_io.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+#ifdef GPI_CP_WITH_LIBURING
+#define GPI_CP_IO_BUFFERS GPI_CP_IO_QUEUE_DEPTH
+#else
+#define GPI_CP_IO_BUFFERS 1
+#endif
+
+#define ROUND_UP(n,a) ((((n) + (a) - 1) / (a)) * (a))
+
+struct gpi_cp_drain
+{
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* the current job */
+  char* file_name;
+  gpi_cp_snapshot_header_t header;
+  const void* data;
+
+  bool busy;
+  bool stop;
+  int status;
+
+  /* aligned bounce buffers, one per write in flight */
+  char* bounce;
+};
+
+static bool
+gpi_cp_io_is_aligned (const void* pointer, size_t length)
+{
+  return ((uintptr_t) pointer) % GPI_CP_IO_BLOCK_SIZE == 0
+    && length % GPI_CP_IO_BLOCK_SIZE == 0;
+}
+
+/* source of a chunk: in place if O_DIRECT allows it, otherwise padded
+   copy in the given bounce buffer */
+static const void*
+gpi_cp_io_chunk ( const char* data
+                , size_t length
+                , bool direct
+                , char* bounce
+                , size_t* write_length
+                )
+{
+  if (!direct || gpi_cp_io_is_aligned (data, length))
+    {
+      *write_length = length;
+      return data;
+    }
+
+  *write_length = ROUND_UP (length, GPI_CP_IO_BLOCK_SIZE);
+  memcpy (bounce, data, length);
+  memset (bounce + length, 0, *write_length - length);
+
+  return bounce;
+}
+
+static int
+gpi_cp_io_pwrite_all (int fd, const char* buffer, size_t length, off_t offset)
+{
+  while (length > 0)
+    {
+      ssize_t const written = pwrite (fd, buffer, length, offset);
+
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return -1;
+        }
+
+      buffer += written;
+      length -= written;
+      offset += written;
+    }
+
+  return 0;
+}
+
+#ifdef GPI_CP_WITH_LIBURING
+static int
+gpi_cp_io_write_chunks ( int fd
+                       , const char* data
+                       , size_t size
+                       , off_t file_offset
+                       , bool direct
+                       , char* bounce
+                       )
+{
+  struct io_uring ring;
+
+  /* the failures set errno, like those of pwrite */
+  int const ret = io_uring_queue_init (GPI_CP_IO_QUEUE_DEPTH, &ring, 0);
+  if (ret < 0)
+    {
+      errno = -ret;
+      return -1;
+    }
+
+  struct
+  {
+    const void* buffer;
+    size_t length;
+    off_t offset;
+  } in_flight[GPI_CP_IO_QUEUE_DEPTH];
+
+  bool slot_busy[GPI_CP_IO_QUEUE_DEPTH] = { false };
+  unsigned busy = 0;
+  size_t offset = 0;
+  int status = 0;
+
+  while ((offset < size && status == 0) || busy > 0)
+    {
+      /* fill the ring up to the budget */
+      while (offset < size && status == 0 && busy < GPI_CP_IO_QUEUE_DEPTH)
+        {
+          unsigned slot = 0;
+          while (slot_busy[slot])
+            ++slot;
+
+          size_t const length = MIN (size - offset, (size_t) GPI_CP_IO_CHUNK_SIZE);
+
+          in_flight[slot].offset = file_offset + offset;
+          in_flight[slot].buffer =
+            gpi_cp_io_chunk ( data + offset
+                            , length
+                            , direct
+                            , bounce + slot * (size_t) GPI_CP_IO_CHUNK_SIZE
+                            , &in_flight[slot].length
+                            );
+
+          struct io_uring_sqe* const sqe = io_uring_get_sqe (&ring);
+          io_uring_prep_write ( sqe, fd
+                              , in_flight[slot].buffer
+                              , in_flight[slot].length
+                              , in_flight[slot].offset
+                              );
+          io_uring_sqe_set_data (sqe, (void*) (uintptr_t) slot);
+
+          slot_busy[slot] = true;
+          ++busy;
+          offset += length;
+        }
+
+      int const submitted = io_uring_submit (&ring);
+      if (submitted < 0)
+        {
+          errno = -submitted;
+          status = -1;
+        }
+
+      if (busy == 0)
+        break;
+
+      struct io_uring_cqe* cqe;
+      int const waited = io_uring_wait_cqe (&ring, &cqe);
+      if (waited < 0)
+        {
+          errno = -waited;
+          status = -1;
+          break;
+        }
+
+      unsigned const slot = (unsigned) (uintptr_t) io_uring_cqe_get_data (cqe);
+      int const result = cqe->res;
+      io_uring_cqe_seen (&ring, cqe);
+
+      if (result < 0)
+        {
+          errno = -result;
+          status = -1;
+        }
+      else if ((size_t) result < in_flight[slot].length)
+        {
+          /* rare short write: finish the rest synchronously */
+          status = gpi_cp_io_pwrite_all
+            ( fd
+            , (const char*) in_flight[slot].buffer + result
+            , in_flight[slot].length - result
+            , in_flight[slot].offset + result
+            );
+        }
+
+      slot_busy[slot] = false;
+      --busy;
+    }
+
+  io_uring_queue_exit (&ring);
+
+  return status;
+}
+#else
+static int
+gpi_cp_io_write_chunks ( int fd
+                       , const char* data
+                       , size_t size
+                       , off_t file_offset
+                       , bool direct
+                       , char* bounce
+                       )
+{
+  size_t offset;
+
+  for (offset = 0; offset < size; offset += GPI_CP_IO_CHUNK_SIZE)
+    {
+      size_t const length = MIN (size - offset, (size_t) GPI_CP_IO_CHUNK_SIZE);
+      size_t write_length;
+      const void* const buffer =
+        gpi_cp_io_chunk (data + offset, length, direct, bounce, &write_length);
+
+      if (gpi_cp_io_pwrite_all (fd, buffer, write_length, file_offset + offset) != 0)
+        return -1;
+    }
+
+  return 0;
+}
+#endif
+
+static size_t
+gpi_cp_io_header_size (uint64_t number_of_chunks)
+{
+  return ROUND_UP ( sizeof (gpi_cp_snapshot_header_t)
+                  + number_of_chunks * sizeof (gpi_cp_snapshot_chunk_t)
+                  , GPI_CP_IO_BLOCK_SIZE
+                  );
+}
+
+static uint32_t
+gpi_cp_io_header_checksum ( const gpi_cp_snapshot_header_t* header
+                          , const gpi_cp_snapshot_chunk_t* index
+                          )
+{
+  gpi_cp_snapshot_header_t copy = *header;
+  copy.header_checksum = 0;
+
+  uint32_t const crc = gpi_cp_crc32c (0, &copy, sizeof (copy));
+
+  return gpi_cp_crc32c
+    (crc, index, header->number_of_chunks * sizeof (gpi_cp_snapshot_chunk_t));
+}
+
+/* header and index, padded to header_size, ready for an aligned write */
+static char*
+gpi_cp_io_make_header ( const gpi_cp_snapshot_header_t* job
+                      , const char* data
+                      )
+{
+  uint64_t const number_of_chunks =
+    (job->size + GPI_CP_IO_CHUNK_SIZE - 1) / GPI_CP_IO_CHUNK_SIZE;
+  size_t const header_size = gpi_cp_io_header_size (number_of_chunks);
+
+  char* buffer;
+  if (posix_memalign ((void**) &buffer, GPI_CP_IO_BLOCK_SIZE, header_size) != 0)
+    return NULL;
+
+  memset (buffer, 0, header_size);
+
+  gpi_cp_snapshot_header_t* const header = (gpi_cp_snapshot_header_t*) buffer;
+  gpi_cp_snapshot_chunk_t* const index =
+    (gpi_cp_snapshot_chunk_t*) (buffer + sizeof (gpi_cp_snapshot_header_t));
+
+  memcpy (header->magic, GPI_CP_SNAPSHOT_MAGIC, sizeof (header->magic));
+  header->version = GPI_CP_SNAPSHOT_VERSION;
+  header->header_size = header_size;
+  header->epoch = job->epoch;
+  header->rank = job->rank;
+  header->group_size = job->group_size;
+  header->policy = job->policy;
+  header->chunk_size = GPI_CP_IO_CHUNK_SIZE;
+  header->size = job->size;
+  header->number_of_chunks = number_of_chunks;
+
+  uint64_t chunk;
+  for (chunk = 0; chunk < number_of_chunks; ++chunk)
+    {
+      uint64_t const offset = chunk * GPI_CP_IO_CHUNK_SIZE;
+
+      index[chunk].offset = header_size + offset;
+      index[chunk].length = MIN (job->size - offset, (uint64_t) GPI_CP_IO_CHUNK_SIZE);
+      index[chunk].checksum =
+        gpi_cp_crc32c (0, data + offset, index[chunk].length);
+    }
+
+  header->header_checksum = gpi_cp_io_header_checksum (header, index);
+
+  return buffer;
+}
+
+/* the rename of a file is durable once its directory is synced */
+static int
+gpi_cp_io_sync_directory (const char* file_name)
+{
+  const char* const slash = strrchr (file_name, '/');
+  size_t const length = (slash == NULL) ? 0 : (size_t) (slash - file_name);
+
+  char directory[length + 2];
+  if (slash == NULL)
+    strcpy (directory, ".");
+  else if (length == 0)
+    strcpy (directory, "/");
+  else
+    {
+      memcpy (directory, file_name, length);
+      directory[length] = '\0';
+    }
+
+  int const fd = open (directory, O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+    return -1;
+
+  int status = 0;
+  if (fsync (fd) != 0)
+    status = -1;
+
+  int const error = errno;
+  close (fd);
+  errno = error;
+
+  return status;
+}
+
+static int
+gpi_cp_io_write_file ( const char* file_name
+                     , const gpi_cp_snapshot_header_t* job
+                     , const void* data
+                     , char* bounce
+                     )
+{
+  char* const header = gpi_cp_io_make_header (job, data);
+  if (header == NULL)
+    return -1;
+
+  size_t const header_size = ((gpi_cp_snapshot_header_t*) header)->header_size;
+  size_t const size = job->size;
+
+  char temporary_name[strlen (file_name) + 5];
+  sprintf (temporary_name, "%s.tmp", file_name);
+
+  /* O_DIRECT is not supported everywhere (e.g. tmpfs) */
+  bool direct = true;
+  int fd = open (temporary_name, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+  if (fd < 0 && errno == EINVAL)
+    {
+      direct = false;
+      fd = open (temporary_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+  if (fd < 0)
+    {
+      fprintf (stderr, "Could not open %s: %s\n", temporary_name, strerror (errno));
+      free (header);
+      return -1;
+    }
+
+  /* errno of the first failure, the cleanup may change it */
+  int error = 0;
+
+  /* data first, the header makes the file valid */
+  int status =
+    gpi_cp_io_write_chunks (fd, data, size, header_size, direct, bounce);
+
+  if (status == 0)
+    status = gpi_cp_io_pwrite_all (fd, header, header_size, 0);
+
+  if (status != 0)
+    error = errno;
+
+  free (header);
+
+  /* cut the padding of the last block */
+  if (status == 0 && ftruncate (fd, header_size + size) != 0)
+    {
+      error = errno;
+      status = -1;
+    }
+
+  if (status == 0 && fdatasync (fd) != 0)
+    {
+      error = errno;
+      status = -1;
+    }
+
+  if (close (fd) != 0 && status == 0)
+    {
+      error = errno;
+      status = -1;
+    }
+
+  if (status == 0 && rename (temporary_name, file_name) != 0)
+    {
+      error = errno;
+      status = -1;
+    }
+
+  if (status != 0)
+    {
+      fprintf (stderr, "Could not write %s: %s\n", file_name, strerror (error));
+      unlink (temporary_name);
+    }
+  else if (gpi_cp_io_sync_directory (file_name) != 0)
+    {
+      fprintf (stderr, "Could not sync the directory of %s: %s\n", file_name, strerror (errno));
+      status = -1;
+    }
+
+  return status;
+}
+
+static void*
+gpi_cp_drain_thread (void* argument)
+{
+  gpi_cp_drain_t* const drain = argument;
+
+  pthread_mutex_lock (&drain->mutex);
+
+  while (true)
+    {
+      while (!drain->stop && (!drain->busy || drain->file_name == NULL))
+        pthread_cond_wait (&drain->cond, &drain->mutex);
+
+      if (drain->busy && drain->file_name != NULL)
+        {
+          char* const file_name = drain->file_name;
+          gpi_cp_snapshot_header_t const header = drain->header;
+          const void* const data = drain->data;
+
+          pthread_mutex_unlock (&drain->mutex);
+
+          int const status =
+            gpi_cp_io_write_file (file_name, &header, data, drain->bounce);
+
+          pthread_mutex_lock (&drain->mutex);
+
+          free (drain->file_name);
+          drain->file_name = NULL;
+          drain->status = status;
+          drain->busy = false;
+          pthread_cond_broadcast (&drain->cond);
+        }
+      else if (drain->stop)
+        {
+          break;
+        }
+    }
+
+  pthread_mutex_unlock (&drain->mutex);
+
+  return NULL;
+}
+
+gpi_cp_drain_t*
+gpi_cp_drain_create (void)
+{
+  gpi_cp_drain_t* const drain = calloc (1, sizeof (gpi_cp_drain_t));
+
+  if (drain == NULL)
+    return NULL;
+
+  if (posix_memalign ( (void**) &drain->bounce
+                     , GPI_CP_IO_BLOCK_SIZE
+                     , (size_t) GPI_CP_IO_BUFFERS * GPI_CP_IO_CHUNK_SIZE
+                     ) != 0)
+    {
+      free (drain);
+      return NULL;
+    }
+
+  pthread_mutex_init (&drain->mutex, NULL);
+  pthread_cond_init (&drain->cond, NULL);
+
+  if (pthread_create (&drain->thread, NULL, gpi_cp_drain_thread, drain) != 0)
+    {
+      pthread_cond_destroy (&drain->cond);
+      pthread_mutex_destroy (&drain->mutex);
+      free (drain->bounce);
+      free (drain);
+      return NULL;
+    }
+
+  return drain;
+}
+
+int
+gpi_cp_drain_post ( gpi_cp_drain_t* drain
+                  , const char* file_name
+                  , const gpi_cp_snapshot_header_t* header
+                  , const void* data
+                  )
+{
+  pthread_mutex_lock (&drain->mutex);
+
+  if (drain->busy)
+    {
+      pthread_mutex_unlock (&drain->mutex);
+      return -1;
+    }
+
+  drain->file_name = strdup (file_name);
+  drain->header = *header;
+  drain->data = data;
+  drain->busy = drain->file_name != NULL;
+  drain->status = drain->busy ? 0 : -1;
+
+  int const status = drain->status;
+
+  pthread_cond_broadcast (&drain->cond);
+  pthread_mutex_unlock (&drain->mutex);
+
+  return status;
+}
+
+int
+gpi_cp_drain_wait (gpi_cp_drain_t* drain)
+{
+  pthread_mutex_lock (&drain->mutex);
+
+  while (drain->busy)
+    pthread_cond_wait (&drain->cond, &drain->mutex);
+
+  int const status = drain->status;
+
+  /* reported once */
+  drain->status = 0;
+
+  pthread_mutex_unlock (&drain->mutex);
+
+  return status;
+}
+
+void
+gpi_cp_drain_destroy (gpi_cp_drain_t* drain)
+{
+  gpi_cp_drain_wait (drain);
+
+  pthread_mutex_lock (&drain->mutex);
+  drain->stop = true;
+  pthread_cond_broadcast (&drain->cond);
+  pthread_mutex_unlock (&drain->mutex);
+
+  pthread_join (drain->thread, NULL);
+
+  pthread_cond_destroy (&drain->cond);
+  pthread_mutex_destroy (&drain->mutex);
+  free (drain->bounce);
+  free (drain);
+}
+
+/* open file_name and check header and index, the index is returned in
+   *index (to be freed by the caller) */
+static int
+gpi_cp_snapshot_open ( const char* file_name
+                     , gpi_cp_snapshot_header_t* header
+                     , gpi_cp_snapshot_chunk_t** index
+                     )
+{
+  int const fd = open (file_name, O_RDONLY);
+
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+
+  if ( fstat (fd, &st) != 0
+     || pread (fd, header, sizeof (*header), 0) != sizeof (*header)
+     || memcmp (header->magic, GPI_CP_SNAPSHOT_MAGIC, sizeof (header->magic)) != 0
+     || header->version != GPI_CP_SNAPSHOT_VERSION
+     || header->chunk_size == 0
+     || header->number_of_chunks
+        != (header->size + header->chunk_size - 1) / header->chunk_size
+     || header->header_size != gpi_cp_io_header_size (header->number_of_chunks)
+     || (uint64_t) st.st_size < header->header_size + header->size
+     )
+    {
+      close (fd);
+      return -1;
+    }
+
+  size_t const index_size =
+    header->number_of_chunks * sizeof (gpi_cp_snapshot_chunk_t);
+
+  *index = malloc (index_size > 0 ? index_size : 1);
+
+  if ( *index == NULL
+     || pread (fd, *index, index_size, sizeof (*header)) != (ssize_t) index_size
+     || gpi_cp_io_header_checksum (header, *index) != header->header_checksum
+     )
+    {
+      free (*index);
+      *index = NULL;
+      close (fd);
+      return -1;
+    }
+
+  return fd;
+}
+
+int
+gpi_cp_snapshot_read_header ( const char* file_name
+                            , gpi_cp_snapshot_header_t* header
+                            )
+{
+  gpi_cp_snapshot_chunk_t* index;
+  int const fd = gpi_cp_snapshot_open (file_name, header, &index);
+
+  if (fd < 0)
+    return -1;
+
+  free (index);
+  close (fd);
+
+  return 0;
+}
+
+static int
+gpi_cp_io_pread_all (int fd, char* buffer, size_t length, off_t offset)
+{
+  while (length > 0)
+    {
+      ssize_t const got = pread (fd, buffer, length, offset);
+
+      if (got < 0 && errno == EINTR)
+        continue;
+      if (got <= 0)
+        return -1;
+
+      buffer += got;
+      length -= got;
+      offset += got;
+    }
+
+  return 0;
+}
+
+int
+gpi_cp_snapshot_read ( const char* file_name
+                     , const gpi_cp_snapshot_header_t* expected
+                     , void* data
+                     )
+{
+  gpi_cp_snapshot_header_t header;
+  gpi_cp_snapshot_chunk_t* index;
+  int const fd = gpi_cp_snapshot_open (file_name, &header, &index);
+
+  if (fd < 0)
+    return -1;
+
+  int status = 0;
+
+  if ( header.epoch != expected->epoch
+     || header.rank != expected->rank
+     || header.size != expected->size
+     )
+    {
+      status = -1;
+    }
+
+  /* sequential, keep the device busy with the next chunks */
+  posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  posix_fadvise ( fd
+                , header.header_size
+                , MIN (header.size, (uint64_t) GPI_CP_IO_QUEUE_DEPTH * header.chunk_size)
+                , POSIX_FADV_WILLNEED
+                );
+
+  uint64_t chunk;
+  for (chunk = 0; chunk < header.number_of_chunks && status == 0; ++chunk)
+    {
+      uint64_t const ahead = chunk + GPI_CP_IO_QUEUE_DEPTH;
+
+      if (ahead < header.number_of_chunks)
+        posix_fadvise ( fd
+                      , index[ahead].offset
+                      , index[ahead].length
+                      , POSIX_FADV_WILLNEED
+                      );
+
+      char* const target =
+        (char*) data + (index[chunk].offset - header.header_size);
+
+      if ( index[chunk].offset < header.header_size
+         || index[chunk].offset - header.header_size + index[chunk].length
+            > header.size
+         || gpi_cp_io_pread_all ( fd
+                                , target
+                                , index[chunk].length
+                                , index[chunk].offset
+                                ) != 0
+         || gpi_cp_crc32c (0, target, index[chunk].length)
+            != index[chunk].checksum
+         )
+        {
+          fprintf (stderr, "Corrupt chunk %lu in %s\n", (unsigned long) chunk, file_name);
+          status = -1;
+        }
+    }
+
+  free (index);
+  close (fd);
+
+  return status;
+}
+
+static size_t
+gpi_cp_io_page_size (void)
+{
+  long const page_size = sysconf (_SC_PAGESIZE);
+
+  return page_size > 0 ? (size_t) page_size : GPI_CP_IO_BLOCK_SIZE;
+}
+
+int
+gpi_cp_mirror_map ( const char* file_name
+                  , size_t size
+                  , gpi_cp_mirror_t* mirror
+                  )
+{
+  mirror->size = size;
+  mirror->mapped_size = ROUND_UP (size, GPI_CP_IO_BLOCK_SIZE)
+    + ROUND_UP (sizeof (gpi_cp_mirror_state_t), GPI_CP_IO_BLOCK_SIZE);
+  mirror->fd = open (file_name, O_RDWR | O_CREAT, 0644);
+
+  if (mirror->fd < 0)
+    {
+      fprintf (stderr, "Could not open %s: %s\n", file_name, strerror (errno));
+      return -1;
+    }
+
+  if (ftruncate (mirror->fd, mirror->mapped_size) != 0)
+    {
+      fprintf (stderr, "Could not resize %s: %s\n", file_name, strerror (errno));
+      close (mirror->fd);
+      return -1;
+    }
+
+  mirror->data = MAP_FAILED;
+
+#if defined (MAP_SYNC) && defined (MAP_SHARED_VALIDATE)
+  mirror->data = mmap ( NULL, mirror->mapped_size
+                      , PROT_READ | PROT_WRITE
+                      , MAP_SHARED_VALIDATE | MAP_SYNC
+                      , mirror->fd, 0
+                      );
+#endif
+
+  if (mirror->data == MAP_FAILED)
+    mirror->data = mmap ( NULL, mirror->mapped_size
+                        , PROT_READ | PROT_WRITE
+                        , MAP_SHARED
+                        , mirror->fd, 0
+                        );
+
+  if (mirror->data == MAP_FAILED)
+    {
+      fprintf (stderr, "Could not map %s: %s\n", file_name, strerror (errno));
+      close (mirror->fd);
+      return -1;
+    }
+
+  return 0;
+}
+
+int
+gpi_cp_mirror_flush ( const gpi_cp_mirror_t* mirror
+                    , size_t offset
+                    , size_t length
+                    )
+{
+  /* msync wants a page aligned start; on DAX it flushes the CPU
+     caches, the page cache is bypassed anyway */
+  size_t const page_size = gpi_cp_io_page_size();
+  size_t const begin = offset - offset % page_size;
+
+  return msync ( (char*) mirror->data + begin
+               , offset + length - begin
+               , MS_SYNC
+               );
+}
+
+static size_t
+gpi_cp_mirror_state_offset (const gpi_cp_mirror_t* mirror)
+{
+  return mirror->mapped_size
+    - ROUND_UP (sizeof (gpi_cp_mirror_state_t), GPI_CP_IO_BLOCK_SIZE);
+}
+
+int
+gpi_cp_mirror_commit ( const gpi_cp_mirror_t* mirror
+                     , const gpi_cp_mirror_state_t* state
+                     )
+{
+  size_t const offset = gpi_cp_mirror_state_offset (mirror);
+
+  gpi_cp_mirror_state_t* const target =
+    (gpi_cp_mirror_state_t*) ((char*) mirror->data + offset);
+
+  *target = *state;
+  memcpy (target->magic, GPI_CP_MIRROR_MAGIC, sizeof (target->magic));
+
+  return gpi_cp_mirror_flush (mirror, offset, sizeof (gpi_cp_mirror_state_t));
+}
+
+int
+gpi_cp_mirror_read_state ( const gpi_cp_mirror_t* mirror
+                         , gpi_cp_mirror_state_t* state
+                         )
+{
+  *state = *(const gpi_cp_mirror_state_t*)
+    ((const char*) mirror->data + gpi_cp_mirror_state_offset (mirror));
+
+  /* a new file is all zeros */
+  return memcmp (state->magic, GPI_CP_MIRROR_MAGIC, sizeof (state->magic)) == 0
+    ? 0 : -1;
+}
+
+void
+gpi_cp_mirror_unmap (gpi_cp_mirror_t* mirror)
+{
+  munmap (mirror->data, mirror->mapped_size);
+  close (mirror->fd);
+  mirror->data = NULL;
+  mirror->fd = -1;
+}
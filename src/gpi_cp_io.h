@@ -0,0 +1,201 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+ * @file   gpi_cp_io.h
+ *
+ * @brief  Internal: persistent copies of snapshots on local storage.
+ *
+ */
+
+#ifndef _GPI_CP_IO_H_
+#define _GPI_CP_IO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* large aligned writes, at most that many in flight */
+#define GPI_CP_IO_BLOCK_SIZE (4096)
+#define GPI_CP_IO_CHUNK_SIZE (4 * 1024 * 1024)
+#define GPI_CP_IO_QUEUE_DEPTH (8)
+
+/* On-disk snapshot format
+
+   [header][chunk index][padding to GPI_CP_IO_BLOCK_SIZE][data]
+
+   integers in host byte order; the data starts at header_size, which
+   is block aligned, so the file can be mmap'ed or read with O_DIRECT;
+   the index holds one entry per chunk_size bytes of data
+*/
+#define GPI_CP_SNAPSHOT_MAGIC "GPICPSNP"
+#define GPI_CP_SNAPSHOT_VERSION (1)
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;      /* bytes before the data */
+  uint64_t epoch;            /* number of the committed checkpoint */
+  uint32_t rank;             /* owner of the data */
+  uint32_t group_size;
+  uint32_t policy;
+  uint32_t chunk_size;
+  uint64_t size;             /* bytes of data */
+  uint64_t number_of_chunks;
+  uint32_t header_checksum;  /* over header (this field 0) and index */
+  uint32_t reserved;
+} gpi_cp_snapshot_header_t;
+
+typedef struct
+{
+  uint64_t offset;           /* in the file */
+  uint64_t length;
+  uint32_t checksum;         /* CRC32C */
+  uint32_t reserved;
+} gpi_cp_snapshot_chunk_t;
+
+typedef struct gpi_cp_drain gpi_cp_drain_t;
+
+/** start a background writer
+ *
+ * \return NULL in case of error
+ */
+gpi_cp_drain_t*
+gpi_cp_drain_create (void);
+
+/** hand header->size bytes at data to the writer, to be stored in file_name
+ *
+ * the file is written under a temporary name and renamed when
+ * complete, so file_name always holds a complete snapshot
+ *
+ * \note data must stay untouched until gpi_cp_drain_wait returned
+ * \param header: epoch, rank, group_size, policy and size, the rest is
+ *                filled in by the writer
+ * \return 0 in case of success, -1 if the writer is still busy
+ */
+int
+gpi_cp_drain_post ( gpi_cp_drain_t* drain
+                  , const char* file_name
+                  , const gpi_cp_snapshot_header_t* header
+                  , const void* data
+                  );
+
+/** wait until the last posted snapshot is on disk
+ *
+ * \return 0 in case of success, -1 if writing failed (e.g. no space
+ *         left, or fdatasync or rename failed); a failure is returned
+ *         once
+ */
+int
+gpi_cp_drain_wait (gpi_cp_drain_t* drain);
+
+/** wait for the writer and stop it */
+void
+gpi_cp_drain_destroy (gpi_cp_drain_t* drain);
+
+/** read and check the header of a snapshot file
+ *
+ * \return 0 in case of a valid header, -1 otherwise
+ */
+int
+gpi_cp_snapshot_read_header ( const char* file_name
+                            , gpi_cp_snapshot_header_t* header
+                            );
+
+/** read the data of a snapshot file, checking every chunk
+ *
+ * \param header: as returned by gpi_cp_snapshot_read_header
+ * \param data: header->size bytes
+ * \return 0 in case of success, -1 otherwise
+ */
+int
+gpi_cp_snapshot_read ( const char* file_name
+                     , const gpi_cp_snapshot_header_t* header
+                     , void* data
+                     );
+
+/* File backed mirror
+
+   [snapshot slots][padding to GPI_CP_IO_BLOCK_SIZE][state]
+
+   the segment is mapped onto the slots, remote writes land in the
+   file directly; the state records the last committed slot, a restart
+   takes the snapshot from there
+*/
+#define GPI_CP_MIRROR_MAGIC "GPICPMIR"
+
+typedef struct
+{
+  char magic[8];
+  uint64_t epoch;
+  uint64_t committed_snapshot;   /* offset of the committed slot */
+  uint64_t size;                 /* bytes per slot */
+  uint32_t rank;                 /* owner of the data, the sender */
+  uint32_t number_of_snapshots;
+} gpi_cp_mirror_state_t;
+
+typedef struct
+{
+  int fd;
+  void* data;
+  size_t size;                   /* of the segment */
+  size_t mapped_size;            /* including the state */
+} gpi_cp_mirror_t;
+
+/** create (or reuse) file_name and map size bytes plus the state
+ *
+ * uses MAP_SYNC on DAX file systems, a plain shared mapping otherwise
+ * (e.g. tmpfs)
+ *
+ * \return 0 in case of success, -1 otherwise
+ */
+int
+gpi_cp_mirror_map ( const char* file_name
+                  , size_t size
+                  , gpi_cp_mirror_t* mirror
+                  );
+
+/** make [offset, offset + length) of the mirror persistent */
+int
+gpi_cp_mirror_flush ( const gpi_cp_mirror_t* mirror
+                    , size_t offset
+                    , size_t length
+                    );
+
+/** record and flush the committed slot */
+int
+gpi_cp_mirror_commit ( const gpi_cp_mirror_t* mirror
+                     , const gpi_cp_mirror_state_t* state
+                     );
+
+/** the state recorded by the last gpi_cp_mirror_commit, e.g. of an
+ *  earlier run
+ *
+ * \return 0 in case of a valid state, -1 otherwise
+ */
+int
+gpi_cp_mirror_read_state ( const gpi_cp_mirror_t* mirror
+                         , gpi_cp_mirror_state_t* state
+                         );
+
+void
+gpi_cp_mirror_unmap (gpi_cp_mirror_t* mirror);
+
+#endif //_GPI_CP_IO_H_
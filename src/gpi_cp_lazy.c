@@ -0,0 +1,303 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/userfaultfd.h>
+
+#include "gpi_cp_lazy.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+
+struct gpi_cp_lazy
+{
+  int uffd;
+  pthread_t thread;
+
+  /* the page aligned part handled by faults */
+  char* begin;
+  size_t size;
+  size_t number_of_chunks;
+  bool* done;
+  size_t next; // prefetch cursor
+
+  /* offset of begin in the region */
+  size_t offset;
+  gpi_cp_lazy_fetch_t fetch;
+  void* context;
+
+  int status;
+};
+
+static int
+gpi_cp_lazy_open (void)
+{
+  /* only faults from user space are needed, which does not require
+     privileges on recent kernels */
+  int uffd = syscall (SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+
+  if (uffd < 0)
+    uffd = syscall (SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+
+  if (uffd < 0)
+    return -1;
+
+  struct uffdio_api api;
+  memset (&api, 0, sizeof (api));
+  api.api = UFFD_API;
+
+  if (ioctl (uffd, UFFDIO_API, &api) != 0)
+    {
+      close (uffd);
+      return -1;
+    }
+
+  return uffd;
+}
+
+/* place a chunk, waking up the threads waiting for it */
+static void
+gpi_cp_lazy_fill (gpi_cp_lazy_t* lazy, size_t chunk)
+{
+  size_t const offset = chunk * GPI_CP_LAZY_CHUNK_SIZE;
+  size_t const length = MIN (lazy->size - offset, (size_t) GPI_CP_LAZY_CHUNK_SIZE);
+
+  const void* const data =
+    lazy->status == 0 ? lazy->fetch (lazy->context, lazy->offset + offset, length) : NULL;
+
+  if (data == NULL)
+    {
+      /* do not leave the application hanging */
+      lazy->status = -1;
+
+      struct uffdio_zeropage zero;
+      memset (&zero, 0, sizeof (zero));
+      zero.range.start = (uintptr_t) (lazy->begin + offset);
+      zero.range.len = length;
+      ioctl (lazy->uffd, UFFDIO_ZEROPAGE, &zero);
+    }
+  else
+    {
+      struct uffdio_copy copy;
+      memset (&copy, 0, sizeof (copy));
+      copy.dst = (uintptr_t) (lazy->begin + offset);
+      copy.src = (uintptr_t) data;
+      copy.len = length;
+
+      if (ioctl (lazy->uffd, UFFDIO_COPY, &copy) != 0 && errno != EEXIST)
+        lazy->status = -1;
+    }
+
+  /* pages that were present already (EEXIST) still have waiters */
+  struct uffdio_range range;
+  range.start = (uintptr_t) (lazy->begin + offset);
+  range.len = length;
+  ioctl (lazy->uffd, UFFDIO_WAKE, &range);
+
+  lazy->done[chunk] = true;
+}
+
+static void*
+gpi_cp_lazy_thread (void* argument)
+{
+  gpi_cp_lazy_t* const lazy = argument;
+  size_t remaining = lazy->number_of_chunks;
+
+  while (remaining > 0)
+    {
+      /* faults first, prefetch while there are none */
+      struct pollfd pfd = { lazy->uffd, POLLIN, 0 };
+
+      if (poll (&pfd, 1, 0) > 0)
+        {
+          struct uffd_msg message;
+
+          if (read (lazy->uffd, &message, sizeof (message)) == sizeof (message)
+             && message.event == UFFD_EVENT_PAGEFAULT
+             )
+            {
+              size_t const chunk =
+                ((char*) (uintptr_t) message.arg.pagefault.address - lazy->begin)
+                / GPI_CP_LAZY_CHUNK_SIZE;
+
+              if (chunk < lazy->number_of_chunks && !lazy->done[chunk])
+                {
+                  gpi_cp_lazy_fill (lazy, chunk);
+                  --remaining;
+                }
+              else if (chunk < lazy->number_of_chunks)
+                {
+                  struct uffdio_range range;
+                  range.start = message.arg.pagefault.address & ~((uint64_t) getpagesize() - 1);
+                  range.len = getpagesize();
+                  ioctl (lazy->uffd, UFFDIO_WAKE, &range);
+                }
+            }
+
+          continue;
+        }
+
+      while (lazy->next < lazy->number_of_chunks && lazy->done[lazy->next])
+        ++lazy->next;
+
+      if (lazy->next < lazy->number_of_chunks)
+        {
+          gpi_cp_lazy_fill (lazy, lazy->next);
+          --remaining;
+        }
+    }
+
+  return NULL;
+}
+
+/* copy the partial pages at the ends directly */
+static int
+gpi_cp_lazy_copy ( char* target
+                 , size_t offset
+                 , size_t length
+                 , gpi_cp_lazy_fetch_t fetch
+                 , void* context
+                 )
+{
+  while (length > 0)
+    {
+      size_t const part = MIN (length, (size_t) GPI_CP_LAZY_CHUNK_SIZE);
+      const void* const data = fetch (context, offset, part);
+
+      if (data == NULL)
+        return -1;
+
+      memcpy (target, data, part);
+
+      target += part;
+      offset += part;
+      length -= part;
+    }
+
+  return 0;
+}
+
+gpi_cp_lazy_t*
+gpi_cp_lazy_create ( void* data
+                   , size_t size
+                   , gpi_cp_lazy_fetch_t fetch
+                   , void* context
+                   )
+{
+  uintptr_t const page_size = getpagesize();
+  uintptr_t const first = (uintptr_t) data;
+  uintptr_t const last = first + size;
+  uintptr_t const begin = (first + page_size - 1) & ~(page_size - 1);
+  uintptr_t const end = last & ~(page_size - 1);
+
+  if (begin >= end)
+    return NULL;
+
+  gpi_cp_lazy_t* const lazy = calloc (1, sizeof (gpi_cp_lazy_t));
+
+  if (lazy == NULL)
+    return NULL;
+
+  lazy->begin = (char*) begin;
+  lazy->size = end - begin;
+  lazy->number_of_chunks = (lazy->size + GPI_CP_LAZY_CHUNK_SIZE - 1) / GPI_CP_LAZY_CHUNK_SIZE;
+  lazy->offset = begin - first;
+  lazy->fetch = fetch;
+  lazy->context = context;
+  lazy->done = calloc (lazy->number_of_chunks, sizeof (bool));
+  lazy->uffd = gpi_cp_lazy_open();
+
+  if (lazy->done == NULL || lazy->uffd < 0)
+    goto fail;
+
+  /* the ends are shared with data outside of the region */
+  if ( gpi_cp_lazy_copy (data, 0, begin - first, fetch, context) != 0
+     || gpi_cp_lazy_copy ((char*) end, end - first, last - end, fetch, context) != 0
+     )
+    lazy->status = -1;
+
+  /* drop the pages: shared memory needs the hole punched, private
+     memory is simply unmapped */
+  if ( madvise (lazy->begin, lazy->size, MADV_REMOVE) != 0
+     && madvise (lazy->begin, lazy->size, MADV_DONTNEED) != 0
+     )
+    goto fail;
+
+  struct uffdio_register reg;
+  memset (&reg, 0, sizeof (reg));
+  reg.range.start = begin;
+  reg.range.len = lazy->size;
+  reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+
+  if (ioctl (lazy->uffd, UFFDIO_REGISTER, &reg) != 0)
+    goto fail;
+
+  if (pthread_create (&lazy->thread, NULL, gpi_cp_lazy_thread, lazy) != 0)
+    {
+      ioctl (lazy->uffd, UFFDIO_UNREGISTER, &reg.range);
+      goto fail;
+    }
+
+  return lazy;
+
+ fail:
+  if (lazy->uffd >= 0)
+    close (lazy->uffd);
+  free (lazy->done);
+  free (lazy);
+
+  return NULL;
+}
+
+int
+gpi_cp_lazy_wait (gpi_cp_lazy_t* lazy)
+{
+  pthread_join (lazy->thread, NULL);
+
+  struct uffdio_range range;
+  range.start = (uintptr_t) lazy->begin;
+  range.len = lazy->size;
+  ioctl (lazy->uffd, UFFDIO_UNREGISTER, &range);
+
+  close (lazy->uffd);
+
+  int const status = lazy->status;
+
+  free (lazy->done);
+  free (lazy);
+
+  return status;
+}
@@ -0,0 +1,72 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_lazy.h
+ *
+ * @brief  Internal: restore of a memory region on first touch.
+ *
+ */
+
+#ifndef _GPI_CP_LAZY_H_
+#define _GPI_CP_LAZY_H_
+
+#include <stddef.h>
+
+/* granularity of fetches, a multiple of the page size */
+#define GPI_CP_LAZY_CHUNK_SIZE (1024 * 1024)
+
+/** fetch [offset, offset + length) of the region from its source
+ *
+ * \return the data, valid until the next call, NULL in case of error
+ */
+typedef const void* (*gpi_cp_lazy_fetch_t) ( void* context
+                                           , size_t offset
+                                           , size_t length
+                                           );
+
+typedef struct gpi_cp_lazy gpi_cp_lazy_t;
+
+/** restore size bytes at data lazily
+ *
+ * the partial pages at both ends are fetched right away, the pages in
+ * between are dropped and filled on first touch (userfaultfd) or by a
+ * background thread streaming the region in order, whichever comes
+ * first; after the ends fetch is called from that thread only
+ *
+ * \return NULL if userfaultfd is not available, the region is left
+ *         untouched then
+ */
+gpi_cp_lazy_t*
+gpi_cp_lazy_create ( void* data
+                   , size_t size
+                   , gpi_cp_lazy_fetch_t fetch
+                   , void* context
+                   );
+
+/** wait until the whole region is restored and release the resources
+ *
+ * \return 0 in case of success, -1 if a fetch failed (the rest of the
+ *         region is zero then)
+ */
+int
+gpi_cp_lazy_wait (gpi_cp_lazy_t* lazy);
+
+#endif //_GPI_CP_LAZY_H_
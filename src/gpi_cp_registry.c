@@ -0,0 +1,242 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gpi_cp_registry.h"
+
+#define ROUND_UP(n,a) ((((n) + (a) - 1) / (a)) * (a))
+
+static bool
+gpi_cp_registry_valid_name (const char* name)
+{
+  return name != NULL
+    && name[0] != '\0'
+    && memchr (name, '\0', GPI_CP_VARIABLE_NAME_MAX) != NULL;
+}
+
+gpi_cp_variable_t*
+gpi_cp_registry_find ( gpi_cp_registry_t* registry
+                     , const char* name
+                     )
+{
+  uint32_t i;
+  for (i = 0; i < registry->count; ++i)
+    {
+      if (strcmp (registry->variables[i].name, name) == 0)
+        return &registry->variables[i];
+    }
+
+  return NULL;
+}
+
+int
+gpi_cp_registry_add ( gpi_cp_registry_t* registry
+                    , const char* name
+                    , void* pointer
+                    , size_t size
+                    , bool always
+                    , size_t data_size
+                    )
+{
+  if (  !gpi_cp_registry_valid_name (name)
+     || gpi_cp_registry_find (registry, name) != NULL
+     || registry->count == GPI_CP_VARIABLES_MAX
+     || (pointer == NULL && size > 0)
+     )
+    {
+      return -1;
+    }
+
+  uint64_t const begin =
+    ROUND_UP ( (registry->end > 0) ? registry->end : GPI_CP_REGISTRY_DIRECTORY_SIZE
+             , GPI_CP_REGISTRY_ALIGNMENT
+             );
+
+  if (begin > data_size || size > data_size - begin)
+    return -1;
+
+  if (registry->count == registry->capacity)
+    {
+      uint32_t const capacity = (registry->capacity > 0) ? 2 * registry->capacity : 16;
+      gpi_cp_variable_t* const variables =
+        realloc (registry->variables, capacity * sizeof (gpi_cp_variable_t));
+
+      if (variables == NULL)
+        return -1;
+
+      registry->variables = variables;
+      registry->capacity = capacity;
+    }
+
+  gpi_cp_variable_t* const variable = &registry->variables[registry->count++];
+
+  memset (variable, 0, sizeof (gpi_cp_variable_t));
+  strcpy (variable->name, name);
+  variable->pointer = pointer;
+  variable->offset = begin;
+  variable->size = size;
+  variable->always = always;
+  variable->interval = 1;
+
+  registry->end = begin + size;
+
+  return 0;
+}
+
+size_t
+gpi_cp_registry_pack ( gpi_cp_registry_t* registry
+                     , void* data
+                     , unsigned long epoch
+                     )
+{
+  gpi_cp_registry_header_t* const header = (gpi_cp_registry_header_t*) data;
+  gpi_cp_registry_entry_t* const entries = (gpi_cp_registry_entry_t*) (header + 1);
+  size_t packed = 0;
+
+  uint32_t i;
+  for (i = 0; i < registry->count; ++i)
+    {
+      gpi_cp_variable_t* const variable = &registry->variables[i];
+
+      if (variable->checkpoints < variable->interval)
+        ++variable->checkpoints;
+
+      // a new variable is packed at once, a changed one when it is due
+      bool const due = variable->epoch == 0
+        || (  (variable->always || variable->dirty)
+           && variable->checkpoints >= variable->interval
+           );
+
+      if (due)
+        {
+          memcpy ((char*) data + variable->offset, variable->pointer, variable->size);
+
+          variable->epoch = epoch;
+          variable->dirty = false;
+          variable->checkpoints = 0;
+          packed += variable->size;
+        }
+
+      memset (&entries[i], 0, sizeof (gpi_cp_registry_entry_t));
+      strcpy (entries[i].name, variable->name);
+      entries[i].offset = variable->offset;
+      entries[i].size = variable->size;
+      entries[i].epoch = variable->epoch;
+    }
+
+  memset (header, 0, sizeof (gpi_cp_registry_header_t));
+  memcpy (header->magic, GPI_CP_REGISTRY_MAGIC, sizeof (header->magic));
+  header->version = GPI_CP_REGISTRY_VERSION;
+  header->count = registry->count;
+  header->end = registry->end;
+
+  return packed;
+}
+
+static const gpi_cp_registry_entry_t*
+gpi_cp_registry_entry ( const gpi_cp_registry_header_t* header
+                      , const char* name
+                      )
+{
+  const gpi_cp_registry_entry_t* const entries =
+    (const gpi_cp_registry_entry_t*) (header + 1);
+
+  uint32_t i;
+  for (i = 0; i < header->count; ++i)
+    {
+      if (  memchr (entries[i].name, '\0', GPI_CP_VARIABLE_NAME_MAX) != NULL
+         && strcmp (entries[i].name, name) == 0
+         )
+        {
+          return &entries[i];
+        }
+    }
+
+  return NULL;
+}
+
+int
+gpi_cp_registry_unpack ( gpi_cp_registry_t* registry
+                       , const void* data
+                       , size_t data_size
+                       )
+{
+  const gpi_cp_registry_header_t* const header =
+    (const gpi_cp_registry_header_t*) data;
+
+  if (  data_size < GPI_CP_REGISTRY_DIRECTORY_SIZE
+     || memcmp (header->magic, GPI_CP_REGISTRY_MAGIC, sizeof (header->magic)) != 0
+     || header->version != GPI_CP_REGISTRY_VERSION
+     || header->count > GPI_CP_VARIABLES_MAX
+     || header->end > data_size
+     )
+    {
+      return -1;
+    }
+
+  // all or nothing
+  uint32_t i;
+  for (i = 0; i < registry->count; ++i)
+    {
+      const gpi_cp_registry_entry_t* const entry =
+        gpi_cp_registry_entry (header, registry->variables[i].name);
+
+      if (  entry == NULL
+         || entry->size != registry->variables[i].size
+         || entry->offset < GPI_CP_REGISTRY_DIRECTORY_SIZE
+         || entry->offset > header->end
+         || entry->size > header->end - entry->offset
+         )
+        {
+          return -1;
+        }
+    }
+
+  uint64_t end = GPI_CP_REGISTRY_DIRECTORY_SIZE;
+
+  for (i = 0; i < registry->count; ++i)
+    {
+      gpi_cp_variable_t* const variable = &registry->variables[i];
+      const gpi_cp_registry_entry_t* const entry =
+        gpi_cp_registry_entry (header, variable->name);
+
+      memcpy (variable->pointer, (const char*) data + entry->offset, variable->size);
+
+      variable->offset = entry->offset;
+      variable->epoch = entry->epoch;
+      variable->dirty = false;
+      variable->checkpoints = 0;
+
+      if (entry->offset + entry->size > end)
+        end = entry->offset + entry->size;
+    }
+
+  registry->end = end;
+
+  return 0;
+}
+
+void
+gpi_cp_registry_clear (gpi_cp_registry_t* registry)
+{
+  free (registry->variables);
+  memset (registry, 0, sizeof (gpi_cp_registry_t));
+}
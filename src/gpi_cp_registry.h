@@ -0,0 +1,140 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+ * @file   gpi_cp_registry.h
+ *
+ * @brief  Internal: named variables packed into the checkpointed data.
+ *
+ */
+
+#ifndef _GPI_CP_REGISTRY_H_
+#define _GPI_CP_REGISTRY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Registry
+
+   [directory][padding][variable][padding][variable]...
+
+   the directory is a header and one entry per variable, with room for
+   GPI_CP_VARIABLES_MAX entries; every variable keeps its range of the
+   data, at a multiple of GPI_CP_REGISTRY_ALIGNMENT, from its
+   registration on; the entries carry the epoch the data of their
+   variable is from, so a restore finds the variables by name
+*/
+#define GPI_CP_REGISTRY_MAGIC "GPICPREG"
+#define GPI_CP_REGISTRY_VERSION (1)
+#define GPI_CP_REGISTRY_ALIGNMENT (64)
+#define GPI_CP_VARIABLES_MAX (256)
+#define GPI_CP_VARIABLE_NAME_MAX (40) /* with the terminating 0 */
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t count;       /* of entries */
+  uint64_t end;         /* offset behind the last variable */
+  uint64_t reserved[5];
+} gpi_cp_registry_header_t;
+
+typedef struct
+{
+  char name[GPI_CP_VARIABLE_NAME_MAX];
+  uint64_t offset;      /* in the data */
+  uint64_t size;
+  uint64_t epoch;       /* of the data of the variable */
+} gpi_cp_registry_entry_t;
+
+#define GPI_CP_REGISTRY_DIRECTORY_SIZE                                  \
+  (sizeof (gpi_cp_registry_header_t)                                    \
+  + GPI_CP_VARIABLES_MAX * sizeof (gpi_cp_registry_entry_t))
+
+typedef struct
+{
+  char name[GPI_CP_VARIABLE_NAME_MAX];
+  void* pointer;        /* of the application */
+  uint64_t offset;      /* in the data */
+  uint64_t size;
+  bool always;          /* changed at every checkpoint */
+  bool dirty;           /* changed since it was packed */
+  unsigned int interval; /* packed at most every interval-th checkpoint */
+  unsigned int checkpoints; /* since it was packed */
+  unsigned long epoch;  /* of its data in ours, 0: not packed yet */
+} gpi_cp_variable_t;
+
+typedef struct
+{
+  gpi_cp_variable_t* variables;
+  uint32_t count;
+  uint32_t capacity;
+  uint64_t end;         /* 0: nothing registered yet */
+} gpi_cp_registry_t;
+
+/** the variable called name, NULL if there is none */
+gpi_cp_variable_t*
+gpi_cp_registry_find ( gpi_cp_registry_t* registry
+                     , const char* name
+                     );
+
+/** give size bytes at pointer a range of data_size bytes of data
+ *
+ * \return 0 in case of success, -1 if the name is taken or too long,
+ *         or if there is no room
+ */
+int
+gpi_cp_registry_add ( gpi_cp_registry_t* registry
+                    , const char* name
+                    , void* pointer
+                    , size_t size
+                    , bool always
+                    , size_t data_size
+                    );
+
+/** copy the variables that changed and are due into data and write
+ *  the directory
+ *
+ * \return the bytes of the variables copied
+ */
+size_t
+gpi_cp_registry_pack ( gpi_cp_registry_t* registry
+                     , void* data
+                     , unsigned long epoch
+                     );
+
+/** copy every variable from the entry of its name in data_size bytes
+ *  at data, and take over the ranges of the entries
+ *
+ * \return 0 in case of success, -1 if data holds no registry or a
+ *         variable has no entry of its size (nothing is copied then)
+ */
+int
+gpi_cp_registry_unpack ( gpi_cp_registry_t* registry
+                       , const void* data
+                       , size_t data_size
+                       );
+
+/** forget all variables */
+void
+gpi_cp_registry_clear (gpi_cp_registry_t* registry);
+
+#endif //_GPI_CP_REGISTRY_H_
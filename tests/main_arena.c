@@ -0,0 +1,284 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks below nProc, except avoid, committed by its
+// members
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  if (iProc < nProc && iProc != avoid)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+#define NUM_ARRAYS 8
+
+// the objects, found from the root by offsets
+typedef struct
+{
+  uint64_t offsets[NUM_ARRAYS];
+  uint64_t lengths[NUM_ARRAYS];
+  uint64_t aligns[NUM_ARRAYS];
+} root_t;
+
+static int*
+array (root_t* root, int k)
+{
+  return (int*) ((char*) root + root->offsets[k]);
+}
+
+static int
+value (gaspi_rank_t rank, int epoch, int k, uint64_t i)
+{
+  return (int) (rank * 1000000 + epoch * 100000 + k * 10000 + i % 10000);
+}
+
+static void
+allocate (gpi_cp_description_t description, root_t* root, int k)
+{
+  root->lengths[k] = 1000 + 3000 * k;
+  root->aligns[k] = (uint64_t) 16 << (k % 9);
+
+  int* const data =
+    gpi_cp_alloc (description, root->lengths[k] * sizeof (int), root->aligns[k]);
+
+  ASSERT (data != NULL);
+  ASSERT ((uintptr_t) data % root->aligns[k] == 0);
+
+  root->offsets[k] = (uint64_t) ((char*) data - (char*) root);
+}
+
+static void
+fill (root_t* root, gaspi_rank_t rank, int epoch)
+{
+  for (int k = 0; k < NUM_ARRAYS; ++k)
+  {
+      for (uint64_t i = 0; i < root->lengths[k]; ++i)
+      {
+          array (root, k)[i] = value (rank, epoch, k, i);
+      }
+  }
+}
+
+static void
+check (root_t* root, gaspi_rank_t rank, int epoch)
+{
+  for (int k = 0; k < NUM_ARRAYS; ++k)
+  {
+      ASSERT ((uintptr_t) array (root, k) % root->aligns[k] == 0);
+
+      for (uint64_t i = 0; i < root->lengths[k]; ++i)
+      {
+          ASSERT (array (root, k)[i] == value (rank, epoch, k, i));
+      }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last rank joins in place of the one before it
+  gaspi_rank_t const joiner = nProc - 1;
+  gaspi_rank_t const culprit = nProc - 2;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024;
+  // the region does not start at a page
+  gaspi_offset_t const cp_offset = 40;
+  const int num_epochs = 2;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_offset + cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_group_t const g_members = create_group (joiner, joiner, iProc);
+  gaspi_group_t const g_new = create_group (nProc, culprit, iProc);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  // no data yet
+  ASSERT (gpi_cp_alloc (checkpoint_description, 16, 0) == NULL);
+
+  if (iProc != joiner)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , cp_offset
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_members
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      ASSERT (gpi_cp_get_root (checkpoint_description) == NULL);
+      ASSERT (gpi_cp_alloc (checkpoint_description, 16, 24) == NULL);
+      ASSERT (gpi_cp_alloc (checkpoint_description, 16, 8192) == NULL);
+      ASSERT (gpi_cp_alloc (checkpoint_description, 2 * cp_data_size, 0) == NULL);
+      ASSERT (gpi_cp_free (checkpoint_description, NULL) == GASPI_ERROR);
+
+      root_t* const root = gpi_cp_alloc (checkpoint_description, sizeof (root_t), 0);
+      ASSERT (root != NULL);
+
+      for (int k = 0; k < NUM_ARRAYS; ++k)
+      {
+          allocate (checkpoint_description, root, k);
+      }
+
+      // holes are reused
+      SUCCESS_OR_DIE ( gpi_cp_free (checkpoint_description, array (root, 2)) );
+      SUCCESS_OR_DIE ( gpi_cp_free (checkpoint_description, array (root, 5)) );
+      ASSERT (gpi_cp_free (checkpoint_description, array (root, 5)) == GASPI_ERROR);
+      ASSERT (gpi_cp_free (checkpoint_description, array (root, 4) + 1) == GASPI_ERROR);
+      allocate (checkpoint_description, root, 5);
+      allocate (checkpoint_description, root, 2);
+
+      SUCCESS_OR_DIE ( gpi_cp_set_root (checkpoint_description, root) );
+      ASSERT (gpi_cp_get_root (checkpoint_description) == root);
+
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          fill (root, iProc, epoch);
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+
+          // the heap is being sent
+          ASSERT (gpi_cp_alloc (checkpoint_description, 16, 0) == NULL);
+
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+      }
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_members, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // the culprit "failed", it keeps its mirror
+  if (iProc != culprit)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_restore ( segment_id_checkpoint
+                                      , cp_offset
+                                      , cp_data_size
+                                      , 0
+                                      , GPI_CP_POLICY_RING
+                                      , g_new
+                                      , checkpoint_description
+                                      , GASPI_BLOCK
+                                      )
+                     );
+
+      gaspi_rank_t const owner = (iProc == joiner) ? culprit : iProc;
+
+      // the heap of the owner, usable
+      root_t* const root = gpi_cp_get_root (checkpoint_description);
+      ASSERT (root != NULL);
+
+      check (root, owner, num_epochs - 1);
+
+      for (int k = 0; k < NUM_ARRAYS; ++k)
+      {
+          SUCCESS_OR_DIE ( gpi_cp_free (checkpoint_description, array (root, k)) );
+      }
+
+      // all merged again
+      void* const large = gpi_cp_alloc (checkpoint_description, cp_data_size - 4096, 0);
+      ASSERT (large != NULL);
+      SUCCESS_OR_DIE ( gpi_cp_free (checkpoint_description, large) );
+
+      for (int k = 0; k < NUM_ARRAYS; ++k)
+      {
+          allocate (checkpoint_description, root, k);
+      }
+
+      fill (root, iProc, num_epochs);
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_new, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
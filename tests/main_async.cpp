@@ -0,0 +1,233 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp_async.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+using async_checkpoint_t =
+  gpi_cp::async_checkpoint<gpi_cp::checkpoint<std::span<int>>>;
+
+static int
+value (gaspi_rank_t rank, int epoch, std::size_t i)
+{
+  return static_cast<int> (rank * 1000000 + epoch * 100000 + i % 100000);
+}
+
+static void
+fill (std::span<int> data, gaspi_rank_t rank, int epoch)
+{
+  for (std::size_t i = 0; i < data.size (); ++i)
+  {
+      data[i] = value (rank, epoch, i);
+  }
+}
+
+// our snapshot, read back from the receiver
+static void
+check_buddy (gpi_cp_description_t description, gaspi_rank_t rank, int epoch, std::size_t count)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description)
+    );
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+      ASSERT (buddy_data[i] == value (rank, epoch, i));
+  }
+}
+
+// the checkpoints of the time steps first_epoch to end_epoch
+static gpi_cp::task
+checkpointing ( async_checkpoint_t& checkpoint
+              , std::span<int> data
+              , gaspi_rank_t iProc
+              , int first_epoch
+              , int end_epoch
+              )
+{
+  for (int epoch = first_epoch; epoch < end_epoch; ++epoch)
+  {
+      fill (data, iProc, epoch);
+
+      gaspi_return_t ret = co_await checkpoint.start ();
+
+      if (ret != GASPI_SUCCESS)
+        co_return ret;
+
+      ret = co_await checkpoint.commit ();
+
+      if (ret != GASPI_SUCCESS)
+        co_return ret;
+  }
+
+  co_return GASPI_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 2)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  std::size_t const num_ints = 256 * 1024;
+  const int num_epochs = 3;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, num_ints * sizeof (int), GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  std::span<int> const data =
+    gpi_cp::segment_span<int> (segment_id_checkpoint, 0, num_ints);
+
+  gpi_cp::progress_engine engine;
+  async_checkpoint_t checkpoint
+    ( gpi_cp::checkpoint<std::span<int>> (data, segment_id_checkpoint, 0, 0, GASPI_GROUP_ALL)
+    , engine
+    );
+
+  // rank 0 is late, the others wait for it in their commits
+  if (iProc == 0)
+  {
+      usleep (200000);
+  }
+
+  gpi_cp::task task = checkpointing (checkpoint, data, iProc, 0, num_epochs);
+
+  // "compute" while the commits are outstanding
+  long computed = 0;
+
+  while (!task.done ())
+  {
+      if (engine.poll () > 0)
+      {
+          ++computed;
+      }
+  }
+
+  SUCCESS_OR_DIE ( task.result () );
+  ASSERT (engine.empty ());
+  ASSERT (iProc == 0 || computed > 0);
+
+  check_buddy (checkpoint.checkpoint ().get (), iProc, num_epochs - 1, num_ints);
+
+  // read_buddy uses the slot the next checkpoint writes
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // without a coroutine: test the operations
+  fill (data, iProc, num_epochs);
+
+  auto start = checkpoint.start ();
+  ASSERT (start.test ());
+  SUCCESS_OR_DIE ( start.result () );
+
+  auto commit = checkpoint.commit ();
+
+  while (!commit.test ())
+  {
+      ASSERT (commit.result () == GASPI_TIMEOUT);
+  }
+
+  SUCCESS_OR_DIE ( commit.result () );
+
+  check_buddy (checkpoint.checkpoint ().get (), iProc, num_epochs, num_ints);
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // a task destroyed while it waits for rank 0 in its commit: the
+  // engine forgets it, the commit is completed without a coroutine
+  if (iProc == 0)
+  {
+      usleep (200000);
+  }
+
+  bool finished;
+
+  {
+      gpi_cp::task abandoned = checkpointing (checkpoint, data, iProc, num_epochs + 1, num_epochs + 2);
+
+      finished = abandoned.done ();
+
+      if (finished)
+      {
+          SUCCESS_OR_DIE ( abandoned.result () );
+      }
+  }
+
+  ASSERT (engine.empty ());
+  ASSERT (engine.poll () == 0);
+
+  if (!finished)
+  {
+      SUCCESS_OR_DIE ( checkpoint.checkpoint ().commit (GASPI_BLOCK) );
+  }
+
+  check_buddy (checkpoint.checkpoint ().get (), iProc, num_epochs + 1, num_ints);
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( checkpoint.checkpoint ().finalize () );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
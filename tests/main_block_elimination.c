@@ -0,0 +1,248 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks below nProc, except avoid, committed by its
+// members
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  if (iProc < nProc && iProc != avoid)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+#define BLOCK_SIZE (64 * 1024)
+
+// quarters: our own data, zeros (but the first block in epoch 0), a
+// table all ranks share, our own data again
+static int
+value (int epoch, gaspi_rank_t rank, size_t i, size_t n)
+{
+  size_t const quarter = n / 4;
+
+  if (i < quarter)
+  {
+      return (epoch + 1) * 1000 + rank;
+  }
+  if (i < 2 * quarter)
+  {
+      return (epoch == 0 && i < quarter + BLOCK_SIZE / sizeof (int)) ? 7 : 0;
+  }
+  if (i < 3 * quarter)
+  {
+      return (int) i;
+  }
+
+  return rank + 1;
+}
+
+static void
+check_buddy (gpi_cp_description_t description, int epoch, gaspi_rank_t iProc, size_t n)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description)
+    );
+
+  for (size_t i = 0; i < n; ++i)
+  {
+      ASSERT (buddy_data[i] == value (epoch, iProc, i, n));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last rank joins in place of the one before it
+  gaspi_rank_t const joiner = nProc - 1;
+  gaspi_rank_t const culprit = nProc - 2;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024 + 4 * 3;
+  size_t const num_work_elems = cp_data_size / sizeof (int);
+  gaspi_size_t const quarter = (num_work_elems / 4) * sizeof (int);
+  const int num_epochs = 4;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  gaspi_group_t const g_members = create_group (joiner, joiner, iProc);
+  gaspi_group_t const g_new = create_group (nProc, culprit, iProc);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  ASSERT (gpi_cp_set_block_elimination (checkpoint_description, 0, true) == GASPI_ERROR);
+  SUCCESS_OR_DIE ( gpi_cp_set_block_elimination (checkpoint_description, BLOCK_SIZE, true) );
+
+  if (iProc != joiner)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , 0
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_members
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      ASSERT (gpi_cp_set_block_elimination (checkpoint_description, 0, false) == GASPI_ERROR);
+
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          for (size_t i = 0; i < num_work_elems; ++i)
+          {
+              work_array[i] = value (epoch, iProc, i, num_work_elems);
+          }
+
+          gaspi_size_t zero_before, duplicate_before;
+          SUCCESS_OR_DIE ( gpi_cp_get_saved_bytes (checkpoint_description, &zero_before, &duplicate_before) );
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+          // neither the zero quarter nor the shared table were sent; in
+          // epoch 0 the first block of the zero quarter is no zero block
+          // but the receiver holds the same one
+          gaspi_size_t zero, duplicate;
+          SUCCESS_OR_DIE ( gpi_cp_get_saved_bytes (checkpoint_description, &zero, &duplicate) );
+
+          ASSERT (zero - zero_before == quarter - (epoch == 0 ? BLOCK_SIZE : 0));
+          ASSERT (duplicate - duplicate_before == quarter + (epoch == 0 ? BLOCK_SIZE : 0));
+
+          check_buddy (checkpoint_description, epoch, iProc, num_work_elems);
+
+          SUCCESS_OR_DIE ( gaspi_barrier (g_members, GASPI_BLOCK) );
+      }
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // the culprit "failed", it keeps its mirror
+  if (iProc != culprit)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_restore ( segment_id_checkpoint
+                                      , 0
+                                      , cp_data_size
+                                      , 0
+                                      , GPI_CP_POLICY_RING
+                                      , g_new
+                                      , checkpoint_description
+                                      , GASPI_BLOCK
+                                      )
+                     );
+
+      if (iProc == joiner)
+      {
+          for (size_t i = 0; i < num_work_elems; ++i)
+          {
+              ASSERT (work_array[i] == value (num_epochs - 1, culprit, i, num_work_elems));
+          }
+      }
+
+      for (int epoch = num_epochs; epoch < num_epochs + 2; ++epoch)
+      {
+          for (size_t i = 0; i < num_work_elems; ++i)
+          {
+              work_array[i] = value (epoch, iProc, i, num_work_elems);
+          }
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+          check_buddy (checkpoint_description, epoch, iProc, num_work_elems);
+
+          SUCCESS_OR_DIE ( gaspi_barrier (g_new, GASPI_BLOCK) );
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
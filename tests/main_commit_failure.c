@@ -0,0 +1,231 @@
+/*
+Copyright (c) Fraunhofer ITWM 
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of ranks below nProc, without 'avoid'
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+
+  return group;
+}
+
+static void
+check_buddy (gpi_cp_description_t description, int expected, int num_work_elems)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description)
+    );
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (buddy_data[iwork] == expected);
+  }
+}
+
+// the same value on all ranks of group
+static void
+check_agreed (unsigned long value, gaspi_group_t group)
+{
+  unsigned long low, high;
+
+  SUCCESS_OR_DIE (gaspi_allreduce (&value, &low, 1, GASPI_OP_MIN, GASPI_TYPE_ULONG, group, GASPI_BLOCK));
+  SUCCESS_OR_DIE (gaspi_allreduce (&value, &high, 1, GASPI_OP_MAX, GASPI_TYPE_ULONG, group, GASPI_BLOCK));
+
+  ASSERT (low == value && high == value);
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      ERROR ("needs at least 3 ranks");
+  }
+
+  // the last rank is a spare, the one before fails
+  gaspi_rank_t const spare = nProc - 1;
+  gaspi_rank_t const culprit = nProc - 2;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024;
+  const int num_work_elems = cp_data_size / sizeof(int);
+  const int num_epochs = 2;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  // survivors refill the mirror of the joiner with the epoch that was
+  // not committed
+  SUCCESS_OR_DIE ( gpi_cp_set_local_copy (checkpoint_description, true) );
+
+  if (iProc != spare)
+  {
+      gaspi_group_t const g_active = create_group (spare, spare);
+
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , 0
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_active
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      for (int epoch = 1; epoch <= num_epochs; ++epoch)
+      {
+          for( int iwork = 0; iwork < num_work_elems; ++iwork)
+          {
+              work_array[iwork] = epoch * nProc + iProc;
+          }
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+      }
+
+      // the culprit fails after it sent the next epoch, before the
+      // barrier of the commit
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = (num_epochs + 1) * nProc + iProc;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+
+      if (iProc != culprit)
+      {
+          gaspi_return_t const ret = gpi_cp_commit (checkpoint_description, 500);
+          ASSERT (ret == GASPI_TIMEOUT);
+      }
+  }
+
+  if (iProc != culprit)
+  {
+      gaspi_group_t const g_new = create_group (nProc, culprit);
+
+      SUCCESS_OR_DIE ( gpi_cp_restore ( segment_id_checkpoint
+                                      , 0
+                                      , cp_data_size
+                                      , 0
+                                      , GPI_CP_POLICY_RING
+                                      , g_new
+                                      , checkpoint_description
+                                      , GASPI_BLOCK
+                                      )
+                     );
+
+      // all continue with the epoch the survivors started
+      unsigned long const epoch = gpi_cp_get_global_epoch (checkpoint_description);
+
+      check_agreed (epoch, g_new);
+      ASSERT (epoch == (unsigned long) num_epochs + 1);
+
+      // the joiner has the data of the culprit of that epoch, all
+      // receivers hold the data of their senders of it
+      gaspi_rank_t const owner = (iProc == spare) ? culprit : iProc;
+
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          ASSERT (work_array[iwork] == (int) epoch * nProc + owner);
+      }
+
+      check_buddy (checkpoint_description, epoch * nProc + owner, num_work_elems);
+
+      // read_buddy uses the slot the next checkpoint writes
+      SUCCESS_OR_DIE ( gaspi_barrier(g_new, GASPI_BLOCK) );
+
+      // checkpointing works again
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = (epoch + 1) * nProc + owner;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      check_agreed (gpi_cp_get_global_epoch (checkpoint_description), g_new);
+      check_buddy (checkpoint_description, (epoch + 1) * nProc + owner, num_work_elems);
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks below nProc, except avoid, committed by its
+// members
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  if (iProc < nProc && iProc != avoid)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+// the data in the segment, sent as it is; and data of the application,
+// copied by two threads, to a single stripe
+using in_place_checkpoint = gpi_cp::checkpoint<std::span<int>>;
+using copy_checkpoint =
+  gpi_cp::checkpoint<std::span<double>, gpi_cp::striped<1>, gpi_cp::copy<2>>;
+
+static_assert (!std::is_copy_constructible_v<in_place_checkpoint>);
+static_assert (!std::is_copy_assignable_v<in_place_checkpoint>);
+static_assert (std::is_nothrow_move_constructible_v<in_place_checkpoint>);
+static_assert (std::is_nothrow_move_assignable_v<copy_checkpoint>);
+
+template <class T>
+static T
+value (gaspi_rank_t rank, int epoch, std::size_t i)
+{
+  return static_cast<T> (rank * 1000000 + epoch * 100000 + i % 100000);
+}
+
+template <class T>
+static void
+fill (std::span<T> data, gaspi_rank_t rank, int epoch)
+{
+  for (std::size_t i = 0; i < data.size (); ++i)
+  {
+      data[i] = value<T> (rank, epoch, i);
+  }
+}
+
+template <class T>
+static void
+check (std::span<T> data, gaspi_rank_t rank, int epoch)
+{
+  for (std::size_t i = 0; i < data.size (); ++i)
+  {
+      ASSERT (data[i] == value<T> (rank, epoch, i));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last rank joins in place of the one before it
+  gaspi_rank_t const joiner = nProc - 1;
+  gaspi_rank_t const culprit = nProc - 2;
+
+  gaspi_segment_id_t segment_id_in_place = 1;
+  gaspi_segment_id_t segment_id_copy = 2;
+  std::size_t const num_ints = 256 * 1024;
+  std::size_t const num_doubles = 100000;
+  const int num_epochs = 2;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_in_place, num_ints * sizeof (int), GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_copy, num_doubles * sizeof (double), GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_group_t const g_members = create_group (joiner, joiner, iProc);
+  gaspi_group_t const g_new = create_group (nProc, culprit, iProc);
+
+  std::span<int> const ints =
+    gpi_cp::segment_span<int> (segment_id_in_place, 0, num_ints);
+  std::vector<double> application (num_doubles);
+  std::span<double> const doubles (application);
+
+  // in place, but not the data in the segment: nothing is initialized
+  try
+  {
+      in_place_checkpoint wrong (ints.subspan (1), segment_id_in_place, 0, 0, g_members);
+      ASSERT (false);
+  }
+  catch (const gpi_cp::error& e)
+  {
+      ASSERT (e.code () == GASPI_ERROR);
+  }
+
+  std::optional<in_place_checkpoint> in_place;
+  std::optional<copy_checkpoint> copied;
+
+  if (iProc != joiner)
+  {
+      in_place.emplace (ints, segment_id_in_place, 0, 0, g_members);
+
+      // pipelined, through the setup
+      copied.emplace ( doubles, segment_id_copy, 0, 0, g_members, GASPI_BLOCK
+                     , [] (gpi_cp_description_t description)
+                       {
+                         return gpi_cp_set_pipelined (description, true);
+                       }
+                     );
+
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          fill (ints, iProc, epoch);
+          fill (doubles, iProc, epoch);
+
+          SUCCESS_OR_DIE ( in_place->start () );
+          SUCCESS_OR_DIE ( in_place->commit () );
+          SUCCESS_OR_DIE ( copied->start () );
+          SUCCESS_OR_DIE ( copied->commit () );
+      }
+
+      // the handles move, the moved from ones are empty
+      in_place_checkpoint moved (std::move (*in_place));
+      ASSERT (!*in_place);
+      ASSERT (moved);
+      *in_place = std::move (moved);
+      ASSERT (!moved);
+      ASSERT (in_place->data ().data () == ints.data ());
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_members, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // the culprit "failed", it keeps its mirrors
+  if (iProc != culprit)
+  {
+      if (iProc == joiner)
+      {
+          fill (ints, iProc, -1);
+          fill (doubles, iProc, -1);
+
+          in_place.emplace (gpi_cp::join, ints, segment_id_in_place, 0, 0, g_new);
+          copied.emplace ( gpi_cp::join, doubles, segment_id_copy, 0, 0, g_new, GASPI_BLOCK
+                         , [] (gpi_cp_description_t description)
+                           {
+                             return gpi_cp_set_pipelined (description, true);
+                           }
+                         );
+      }
+      else
+      {
+          SUCCESS_OR_DIE ( in_place->restore (g_new) );
+          SUCCESS_OR_DIE ( copied->restore (g_new) );
+      }
+
+      gaspi_rank_t const owner = (iProc == joiner) ? culprit : iProc;
+
+      check (ints, owner, num_epochs - 1);
+      check (doubles, owner, num_epochs - 1);
+
+      fill (ints, iProc, num_epochs);
+      fill (doubles, iProc, num_epochs);
+
+      SUCCESS_OR_DIE ( in_place->start () );
+      SUCCESS_OR_DIE ( in_place->commit () );
+      SUCCESS_OR_DIE ( copied->start () );
+      SUCCESS_OR_DIE ( copied->commit () );
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_new, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( copied->finalize () );
+      ASSERT (!*copied);
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // the culprit "failed", no finalize
+  if (iProc == culprit)
+  {
+      free (in_place->release ());
+      free (copied->release ());
+  }
+  else
+  {
+      SUCCESS_OR_DIE ( in_place->finalize () );
+  }
+
+  // nothing left for the destructors
+  ASSERT (!*in_place && !*copied);
+  in_place.reset ();
+  copied.reset ();
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
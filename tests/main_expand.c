@@ -0,0 +1,239 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks in [first, last), committed by its members
+static gaspi_group_t
+create_group (gaspi_rank_t first, gaspi_rank_t last, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = first; rank < last; ++rank)
+  {
+      SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+  }
+
+  if (first <= iProc && iProc < last)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+static void
+check_buddy (gpi_cp_description_t description, unsigned char expected, gaspi_size_t size)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  unsigned char const * const buddy_data = (unsigned char *)
+    gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description);
+
+  for (gaspi_size_t i = 0; i < size; ++i)
+  {
+      ASSERT (buddy_data[i] == expected);
+  }
+}
+
+// the new rank takes the member_index-th slice of every member
+static gaspi_return_t
+slice_redistribution ( const gaspi_rank_t member
+                     , const gaspi_number_t member_index
+                     , const gaspi_size_t size
+                     , const gaspi_number_t position
+                     , const gaspi_number_t number_of_new_ranks
+                     , gpi_cp_part_t* const part
+                     , void* context
+                     )
+{
+  gaspi_number_t const number_of_members = *(const gaspi_number_t*) context;
+  gaspi_size_t const slice = size / number_of_members;
+
+  ASSERT (member == member_index);
+  ASSERT (position == 0 && number_of_new_ranks == 1);
+
+  part->offset = member_index * slice;
+  part->size = slice;
+  part->segment_id = 1;
+  part->segment_offset = member_index * slice;
+
+  return GASPI_SUCCESS;
+}
+
+static unsigned char
+pattern (int epoch, gaspi_rank_t rank)
+{
+  return (unsigned char) (epoch * 16 + rank + 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last rank arrives late
+  gaspi_rank_t const late = nProc - 1;
+  gaspi_number_t number_of_members = late;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024 + 3;
+  gaspi_size_t const slice = cp_data_size / number_of_members;
+  const int num_epochs = 3;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  unsigned char* const work_array = (unsigned char *) checkpoint_seg_ptr;
+
+  gaspi_group_t const g_members = create_group (0, late, iProc);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  if (iProc != late)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , 0
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_members
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          memset (work_array, pattern (epoch, iProc), cp_data_size);
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+      }
+
+      check_buddy (checkpoint_description, pattern (num_epochs - 1, iProc), cp_data_size);
+
+      // only the committed snapshot is handed over
+      memset (work_array, 0, cp_data_size);
+  }
+
+  // the size differs from the one of the members
+  if (iProc != late)
+  {
+      ASSERT (gpi_cp_expand ( segment_id_checkpoint, 0, cp_data_size + 1, 0
+                            , GPI_CP_POLICY_RING, GASPI_GROUP_ALL
+                            , NULL, NULL
+                            , checkpoint_description, GASPI_BLOCK
+                            ) == GASPI_ERROR);
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_expand ( segment_id_checkpoint
+                                 , 0
+                                 , cp_data_size
+                                 , 0
+                                 , GPI_CP_POLICY_RING
+                                 , GASPI_GROUP_ALL
+                                 , slice_redistribution
+                                 , &number_of_members
+                                 , checkpoint_description
+                                 , GASPI_BLOCK
+                                 )
+                 );
+
+  if (iProc == late)
+  {
+      for (gaspi_rank_t member = 0; member < number_of_members; ++member)
+      {
+          for (gaspi_size_t i = member * slice; i < (member + 1) * slice; ++i)
+          {
+              ASSERT (work_array[i] == pattern (num_epochs - 1, member));
+          }
+      }
+  }
+  else
+  {
+      SUCCESS_OR_DIE ( gaspi_group_delete (g_members) );
+  }
+
+  // checkpointing works on all ranks, the late one in the ring
+  for (int epoch = num_epochs; epoch < num_epochs + 2; ++epoch)
+  {
+      memset (work_array, pattern (epoch, iProc), cp_data_size);
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      check_buddy (checkpoint_description, pattern (epoch, iProc), cp_data_size);
+
+      // the buddy copy lands where the next epoch of the sender goes
+      SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
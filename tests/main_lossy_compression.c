@@ -0,0 +1,243 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks below nProc, except avoid, committed by its
+// members
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  if (iProc < nProc && iProc != avoid)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+// all mantissa bits in use, a few special values
+static double
+field (int epoch, gaspi_rank_t rank, size_t i)
+{
+  switch (i)
+  {
+  case 0: return INFINITY;
+  case 1: return -INFINITY;
+  case 2: return NAN;
+  case 3: return 0.0;
+  case 4: return DBL_MAX;
+  default: return (1.0 + epoch + rank) * sin (0.001 * i) / 3.0;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last rank joins in place of the one before it
+  gaspi_rank_t const joiner = nProc - 1;
+  gaspi_rank_t const culprit = nProc - 2;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024 + 8 * 3 + 5;
+  size_t const num_work_elems = cp_data_size / sizeof (double);
+  const int num_epochs = 3;
+  double const relative_error = 1e-4;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  double* const work_array = (double *) checkpoint_seg_ptr;
+  unsigned char* const tail = (unsigned char *) checkpoint_seg_ptr + num_work_elems * sizeof (double);
+
+  gaspi_group_t const g_members = create_group (joiner, joiner, iProc);
+  gaspi_group_t const g_new = create_group (nProc, culprit, iProc);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  ASSERT (gpi_cp_set_lossy_compression (checkpoint_description, GPI_CP_DOUBLE, 0.0, 0) == GASPI_ERROR);
+  ASSERT (gpi_cp_set_lossy_compression (checkpoint_description, 3, relative_error, 0) == GASPI_ERROR);
+
+  // half of the data per slot on the receivers, too little for
+  // lossless compression
+  SUCCESS_OR_DIE ( gpi_cp_set_lossy_compression ( checkpoint_description
+                                                , GPI_CP_DOUBLE
+                                                , relative_error
+                                                , cp_data_size / 2
+                                                )
+                 );
+
+  if (iProc != joiner)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , 0
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_members
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      ASSERT (gpi_cp_set_lossy_compression (checkpoint_description, GPI_CP_FLOAT, 1e-3, 0) == GASPI_ERROR);
+
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          for (size_t i = 0; i < num_work_elems; ++i)
+          {
+              work_array[i] = field (epoch, iProc, i);
+          }
+          for (size_t i = 0; i < cp_data_size % sizeof (double); ++i)
+          {
+              tail[i] = (unsigned char) (epoch + i);
+          }
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+          ASSERT (gpi_cp_get_compressed_size (checkpoint_description) > 0);
+          ASSERT (gpi_cp_get_compressed_size (checkpoint_description) < cp_data_size / 4);
+
+          // the data of the application stays exact
+          ASSERT (work_array[5 + epoch] == field (epoch, iProc, 5 + epoch));
+      }
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_members, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // the culprit "failed", it keeps its mirror
+  if (iProc != culprit)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_restore ( segment_id_checkpoint
+                                      , 0
+                                      , cp_data_size
+                                      , 0
+                                      , GPI_CP_POLICY_RING
+                                      , g_new
+                                      , checkpoint_description
+                                      , GASPI_BLOCK
+                                      )
+                     );
+
+      if (iProc == joiner)
+      {
+          size_t rounded = 0;
+
+          ASSERT (isinf (work_array[0]) && work_array[0] > 0);
+          ASSERT (isinf (work_array[1]) && work_array[1] < 0);
+          ASSERT (isnan (work_array[2]));
+          ASSERT (work_array[3] == 0.0);
+          ASSERT (work_array[4] == DBL_MAX);
+
+          for (size_t i = 5; i < num_work_elems; ++i)
+          {
+              double const expected = field (num_epochs - 1, culprit, i);
+
+              ASSERT (fabs (work_array[i] - expected) <= relative_error * fabs (expected));
+
+              rounded += (work_array[i] != expected);
+          }
+
+          ASSERT (rounded > num_work_elems / 2);
+
+          for (size_t i = 0; i < cp_data_size % sizeof (double); ++i)
+          {
+              ASSERT (tail[i] == (unsigned char) (num_epochs - 1 + i));
+          }
+      }
+
+      for (size_t i = 0; i < num_work_elems; ++i)
+      {
+          work_array[i] = field (num_epochs, iProc, i);
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_new, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
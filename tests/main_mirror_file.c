@@ -0,0 +1,187 @@
+/*
+Copyright (c) Fraunhofer ITWM 
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  // e.g. a pmem or tmpfs mount
+  const char* const path = argc > 1 ? argv[1] : "/dev/shm";
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024 + sizeof (int);
+  const int num_work_elems = cp_data_size / sizeof(int);
+  const int num_epochs = 5;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_mirror_path (checkpoint_description, path) );
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 4
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  ASSERT (gpi_cp_set_mirror_path (checkpoint_description, NULL) == GASPI_ERROR);
+
+  for (int epoch = 0; epoch < num_epochs; ++epoch)
+  {
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = epoch * nProc + iProc;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  // the file holds the last epoch of the sender in one of the slots
+  char file_name[256];
+  snprintf (file_name, sizeof (file_name), "%s/gpi_cp.%u.mirror", path, iProc);
+
+  int const fd = open (file_name, O_RDONLY);
+  ASSERT (fd >= 0);
+
+  int const * const mirror = (int *)
+    mmap (NULL, 2 * cp_data_size, PROT_READ, MAP_SHARED, fd, 0);
+  ASSERT (mirror != MAP_FAILED);
+
+  gaspi_rank_t const sender = (iProc + nProc - 1) % nProc;
+  int const expected = (num_epochs - 1) * nProc + sender;
+
+  int found = 0;
+  for (int slot = 0; slot < 2; ++slot)
+  {
+      int const * const data = mirror + slot * num_work_elems;
+      int complete = 1;
+
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          complete &= data[iwork] == expected;
+      }
+
+      found |= complete;
+  }
+
+  ASSERT (found);
+
+  munmap ((void *) mirror, 2 * cp_data_size);
+  close (fd);
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  free (checkpoint_description);
+
+  // the whole job lost its memory, the mirror files survived: the
+  // restart takes the committed slot recorded in their state
+  memset (work_array, 0, cp_data_size);
+
+  checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_mirror_path (checkpoint_description, path) );
+
+  SUCCESS_OR_DIE ( gpi_cp_restart_from_files ( segment_id_checkpoint
+                                             , 0
+                                             , cp_data_size
+                                             , 4
+                                             , GPI_CP_POLICY_RING
+                                             , GASPI_GROUP_ALL
+                                             , checkpoint_description
+                                             , GASPI_BLOCK
+                                             )
+                 );
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (work_array[iwork] == (num_epochs - 1) * nProc + iProc);
+  }
+
+  // checkpointing continues
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      work_array[iwork] = num_epochs * nProc + iProc;
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  unlink (file_name);
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of all ranks except avoid
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+
+  return group;
+}
+
+// every element differs, so that a misplaced chunk shows
+static void
+check_data (int const* data, int owner, int num_work_elems)
+{
+  for (int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (data[iwork] == owner + 1 + iwork);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  const gaspi_rank_t spare = nProc-1;
+  const gaspi_rank_t culprit = nProc-2;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_offset_t const cp_offset = 0;
+  gaspi_size_t const cp_data_size = 1024 * sizeof(int);
+  const int num_work_elems = cp_data_size / sizeof(int);
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_offset + cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  // the lowest unused segment id differs: 2 on rank 0, 0 elsewhere
+  if (iProc == 0)
+  {
+      SUCCESS_OR_DIE (gaspi_segment_alloc (0, 64, GASPI_MEM_INITIALIZED));
+  }
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) ((char *) checkpoint_seg_ptr + cp_offset);
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      work_array[iwork] = iProc + 1 + iwork;
+  }
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  gaspi_group_t g_active = GASPI_GROUP_ALL;
+
+  if ( iProc != spare)
+  {
+      g_active = create_group (nProc, spare);
+
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , cp_offset
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_active
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      // the mirrors took the lowest id unused on all members
+      gaspi_pointer_t mirror_ptr;
+      SUCCESS_OR_DIE (gaspi_segment_ptr (2, &mirror_ptr));
+      ASSERT (mirror_ptr == gpi_cp_get_receiver_ptr (checkpoint_description));
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  if (iProc != culprit)
+  {
+      if ( iProc != spare)
+      {
+          SUCCESS_OR_DIE(gaspi_group_delete(g_active));
+      }
+
+      g_active = create_group (nProc, culprit);
+
+      // the spare uses the id of the mirrors: nobody restores
+      if (iProc == spare)
+      {
+          SUCCESS_OR_DIE (gaspi_segment_alloc (2, 64, GASPI_MEM_INITIALIZED));
+      }
+
+      ASSERT ( gpi_cp_restore ( segment_id_checkpoint
+                              , cp_offset
+                              , cp_data_size
+                              , 0
+                              , GPI_CP_POLICY_RING
+                              , g_active
+                              , checkpoint_description
+                              , GASPI_BLOCK
+                              )
+               == GASPI_ERROR
+             );
+
+      if (iProc == spare)
+      {
+          SUCCESS_OR_DIE (gaspi_segment_delete (2));
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_restore ( segment_id_checkpoint
+                                      , cp_offset
+                                      , cp_data_size
+                                      , 0
+                                      , GPI_CP_POLICY_RING
+                                      , g_active
+                                      , checkpoint_description
+                                      , GASPI_BLOCK
+                                      )
+                     );
+
+      check_data (work_array, (iProc == spare) ? culprit : iProc, num_work_elems);
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( gpi_cp_read_buddy (checkpoint_description, GASPI_BLOCK) );
+
+      check_data ( (int const *) ((char *) gpi_cp_get_receiver_ptr (checkpoint_description)
+                                 + gpi_cp_get_active_snapshot (checkpoint_description)
+                                 )
+                 , (iProc == spare) ? culprit : iProc
+                 , num_work_elems
+                 );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/*
+Copyright (c) Fraunhofer ITWM 
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+
+// the sender of rank in the ring
+static gaspi_rank_t
+sender_of (gaspi_rank_t rank, gaspi_rank_t nProc)
+{
+  return (rank + nProc - 1) % nProc;
+}
+
+// read the snapshot file of owner back, in the format of the README:
+// [header][chunk index][padding][data]
+static void
+check_file ( const char* path
+           , gaspi_rank_t owner
+           , unsigned long epoch
+           , int expected
+           , gaspi_size_t cp_data_size
+           )
+{
+  char file_name[256];
+  sprintf (file_name, "%s/gpi_cp.%u.%lu.snapshot", path, owner, epoch % 2);
+
+  FILE* const file = fopen (file_name, "rb");
+  ASSERT (file != NULL);
+
+  // magic, version, header size, epoch, rank
+  char magic[8];
+  uint32_t version, header_size, rank;
+  uint64_t file_epoch;
+
+  ASSERT (fread (magic, sizeof (magic), 1, file) == 1);
+  ASSERT (fread (&version, sizeof (version), 1, file) == 1);
+  ASSERT (fread (&header_size, sizeof (header_size), 1, file) == 1);
+  ASSERT (fread (&file_epoch, sizeof (file_epoch), 1, file) == 1);
+  ASSERT (fread (&rank, sizeof (rank), 1, file) == 1);
+
+  ASSERT (memcmp (magic, "GPICPSNP", sizeof (magic)) == 0);
+  ASSERT (file_epoch == epoch);
+  ASSERT (rank == owner);
+
+  int* const data = malloc (cp_data_size);
+  ASSERT (data != NULL);
+
+  ASSERT (fseek (file, header_size, SEEK_SET) == 0);
+  ASSERT (fread (data, cp_data_size, 1, file) == 1);
+  ASSERT (fgetc (file) == EOF);
+
+  for (gaspi_size_t i = 0; i < cp_data_size / sizeof (int); ++i)
+  {
+      ASSERT (data[i] == expected);
+  }
+
+  free (data);
+  fclose (file);
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  // a directory visible to all ranks
+  const char* const path = argc > 1 ? argv[1] : "/tmp";
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 6 * 1024 * 1024;
+  const int num_work_elems = cp_data_size / sizeof(int);
+  const int num_epochs = 3;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_persistent_path (checkpoint_description, path) );
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 0
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  for (int epoch = 0; epoch < num_epochs; ++epoch)
+  {
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = epoch * nProc + iProc;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  // waits for the last copy
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  free (checkpoint_description);
+
+  // we hold the copies of our sender, the last two epochs
+  gaspi_rank_t const sender = sender_of (iProc, nProc);
+
+  check_file (path, sender, num_epochs, (num_epochs - 1) * nProc + sender, cp_data_size);
+  check_file (path, sender, num_epochs - 1, (num_epochs - 2) * nProc + sender, cp_data_size);
+
+  // a directory that does not exist: the copy of the first epoch
+  // fails, the next commit and finalize report it once
+  checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_persistent_path (checkpoint_description, "/nonexistent/gpi_cp") );
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 0
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+  ASSERT (gpi_cp_commit (checkpoint_description, GASPI_BLOCK) == GASPI_ERROR);
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  ASSERT (gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) == GASPI_ERROR);
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*
+Copyright (c) Fraunhofer ITWM 
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024;
+  const int num_work_elems = cp_data_size / sizeof(int);
+  const int num_epochs = 10;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_pipelined (checkpoint_description, true) );
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 4
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  // not possible once initialized
+  ASSERT (gpi_cp_set_pipelined (checkpoint_description, false) == GASPI_ERROR);
+
+  for (int epoch = 0; epoch < num_epochs; ++epoch)
+  {
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = epoch * nProc + iProc;
+      }
+
+      ASSERT (!gpi_cp_get_state_in_progress (checkpoint_description));
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+
+      ASSERT (gpi_cp_get_state_in_progress (checkpoint_description));
+      ASSERT (gpi_cp_start (checkpoint_description, GASPI_BLOCK) == GASPI_ERROR);
+
+      // wait for the local part only: the next start overlaps the barrier
+      gaspi_return_t ret;
+      do
+      {
+          ret = gpi_cp_commit (checkpoint_description, GASPI_TEST);
+      }
+      while ( ret == GASPI_TIMEOUT
+            && gpi_cp_get_state_in_progress (checkpoint_description)
+            );
+
+      ASSERT (ret == GASPI_SUCCESS || ret == GASPI_TIMEOUT);
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+  ASSERT (!gpi_cp_get_state_in_progress (checkpoint_description));
+
+  // the buddy holds the last epoch
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (checkpoint_description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (checkpoint_description)
+    + gpi_cp_get_active_snapshot (checkpoint_description)
+    );
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (buddy_data[iwork] == (num_epochs - 1) * nProc + iProc);
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks in [first, last), committed by its members
+static gaspi_group_t
+create_group (gaspi_rank_t first, gaspi_rank_t last, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = first; rank < last; ++rank)
+  {
+      SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+  }
+
+  if (first <= iProc && iProc < last)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+static void
+check_buddy (gpi_cp_description_t description, int expected, int num_work_elems)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description)
+    );
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (buddy_data[iwork] == expected);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 4)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last ranks are spares, one of them is not needed with 5 ranks
+  // or more; a member in the middle of the ring fails
+  gaspi_rank_t const number_of_spares = (nProc >= 5) ? 2 : 1;
+  gaspi_rank_t const first_spare = nProc - number_of_spares;
+  gaspi_rank_t const culprit = 1;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024;
+  const int num_work_elems = cp_data_size / sizeof(int);
+  const int num_epochs = 4;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  gaspi_group_t const g_active = create_group (0, first_spare, iProc);
+  gaspi_group_t const g_spares = create_group (first_spare, nProc, iProc);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_spares (checkpoint_description, g_spares) );
+
+  // members and spares
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 0
+                               , GPI_CP_POLICY_RING
+                               , g_active
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  // not possible once initialized
+  ASSERT (gpi_cp_set_spares (checkpoint_description, g_spares) == GASPI_ERROR);
+  ASSERT (gpi_cp_get_state_spare (checkpoint_description) == (iProc >= first_spare));
+
+  if (iProc < first_spare)
+  {
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          for( int iwork = 0; iwork < num_work_elems; ++iwork)
+          {
+              work_array[iwork] = epoch * nProc + iProc;
+          }
+
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_heartbeat (checkpoint_description, GASPI_BLOCK) );
+      }
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_active, GASPI_BLOCK) );
+
+      if (iProc == culprit)
+      {
+          _exit (-1);
+      }
+
+      // every survivor notices, be it from its partners or from GASPI
+      gaspi_return_t ret;
+
+      while ((ret = gpi_cp_heartbeat (checkpoint_description, 100)) != GASPI_ERROR)
+      {
+          ASSERT (ret == GASPI_SUCCESS || ret == GASPI_TIMEOUT);
+      }
+  }
+
+  gaspi_group_t g_new;
+
+  SUCCESS_OR_DIE ( gpi_cp_recover (checkpoint_description, &g_new, GASPI_BLOCK) );
+
+  if (gpi_cp_get_state_spare (checkpoint_description))
+  {
+      // released by the members
+      ASSERT (iProc > first_spare);
+  }
+  else
+  {
+      SUCCESS_OR_DIE ( gaspi_group_delete (g_active) );
+
+      if (iProc == first_spare)
+      {
+          // took the place of the culprit
+          for( int iwork = 0; iwork < num_work_elems; ++iwork)
+          {
+              ASSERT (work_array[iwork] == (num_epochs - 1) * nProc + culprit);
+          }
+      }
+
+      // checkpointing and the heartbeat work again
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = (num_epochs + 1) * nProc + iProc;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_heartbeat (checkpoint_description, GASPI_BLOCK) );
+
+      check_buddy (checkpoint_description, (num_epochs + 1) * nProc + iProc, num_work_elems);
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_new, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/*
+Copyright (c) Fraunhofer ITWM 
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+static void
+write_epochs ( gaspi_segment_id_t segment_id_checkpoint
+             , gaspi_size_t cp_data_size
+             , const char* path
+             , int num_epochs
+             )
+{
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+  const int num_work_elems = cp_data_size / sizeof(int);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_persistent_path (checkpoint_description, path) );
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 4
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  for (int epoch = 0; epoch < num_epochs; ++epoch)
+  {
+      for( int iwork = 0; iwork < num_work_elems; ++iwork)
+      {
+          work_array[iwork] = epoch * nProc + iProc;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  // waits for the last copy
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  free (checkpoint_description);
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  // a directory visible to all ranks
+  const char* const path = argc > 1 ? argv[1] : "/tmp";
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  // not a multiple of the chunk size
+  gaspi_size_t const cp_data_size = 5 * 1024 * 1024 + 4 * sizeof (int);
+  const int num_work_elems = cp_data_size / sizeof(int);
+  const int num_epochs = 5;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const work_array = (int *) checkpoint_seg_ptr;
+
+  write_epochs (segment_id_checkpoint, cp_data_size, path, num_epochs);
+
+  // the whole job lost its memory
+  memset (work_array, 0, cp_data_size);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  // persistent copies are required
+  ASSERT (gpi_cp_restart_from_files ( segment_id_checkpoint
+                                    , 0
+                                    , cp_data_size
+                                    , 4
+                                    , GPI_CP_POLICY_RING
+                                    , GASPI_GROUP_ALL
+                                    , checkpoint_description
+                                    , GASPI_BLOCK
+                                    ) == GASPI_ERROR
+          );
+
+  SUCCESS_OR_DIE ( gpi_cp_set_persistent_path (checkpoint_description, path) );
+
+  SUCCESS_OR_DIE ( gpi_cp_restart_from_files ( segment_id_checkpoint
+                                             , 0
+                                             , cp_data_size
+                                             , 4
+                                             , GPI_CP_POLICY_RING
+                                             , GASPI_GROUP_ALL
+                                             , checkpoint_description
+                                             , GASPI_BLOCK
+                                             )
+                 );
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (work_array[iwork] == (num_epochs - 1) * nProc + iProc);
+  }
+
+  // the mirrors are back as well
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (checkpoint_description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (checkpoint_description)
+    + gpi_cp_get_active_snapshot (checkpoint_description)
+    );
+
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT (buddy_data[iwork] == (num_epochs - 1) * nProc + iProc);
+  }
+
+  // checkpointing continues (the sender overwrites buddy_data)
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
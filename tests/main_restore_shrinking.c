@@ -0,0 +1,192 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of all ranks except avoid
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+
+  return group;
+}
+
+static void
+check_buddy (gpi_cp_description_t description, unsigned char expected, gaspi_size_t size)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  unsigned char const * const buddy_data = (unsigned char *)
+    gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description);
+
+  for (gaspi_size_t i = 0; i < size; ++i)
+  {
+      ASSERT (buddy_data[i] == expected);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // no spares: rank 1 fails, the others share its data in blocks
+  gaspi_rank_t const culprit = 1;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024 + 3;
+  gaspi_size_t const block = (cp_data_size + nProc - 2) / (nProc - 1);
+  const int num_epochs = 3;
+
+  // room for the block after the data
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, 2 * cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  unsigned char* const work_array = (unsigned char *) checkpoint_seg_ptr;
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 0
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  for (int epoch = 0; epoch < num_epochs; ++epoch)
+  {
+      memset (work_array, epoch * nProc + iProc, cp_data_size);
+
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  if (iProc == culprit)
+  {
+      _exit (-1);
+  }
+
+  gaspi_group_t const g_survivors = create_group (nProc, culprit);
+
+  // position among the survivors, in rank order
+  gaspi_number_t const position = (iProc < culprit) ? iProc : iProc - 1;
+
+  gpi_cp_part_t first_block;
+  first_block.segment_id = segment_id_checkpoint;
+  first_block.segment_offset = cp_data_size;
+
+  SUCCESS_OR_DIE ( gpi_cp_restore_shrinking ( segment_id_checkpoint
+                                            , 0
+                                            , cp_data_size + block
+                                            , 0
+                                            , g_survivors
+                                            , gpi_cp_block_redistribution
+                                            , &first_block
+                                            , checkpoint_description
+                                            , GASPI_BLOCK
+                                            )
+                 );
+
+  // our block of the last snapshot of the culprit
+  gaspi_offset_t const begin = position * block;
+  gaspi_offset_t const end = (begin + block < cp_data_size) ? begin + block : cp_data_size;
+
+  for (gaspi_offset_t i = begin; i < end; ++i)
+  {
+      ASSERT (work_array[cp_data_size + i - begin] == (unsigned char) ((num_epochs - 1) * nProc + culprit));
+  }
+
+  // the larger checkpoint with the new partners
+  memset (work_array, num_epochs * nProc + iProc, cp_data_size + block);
+
+  SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  check_buddy (checkpoint_description, num_epochs * nProc + iProc, cp_data_size + block);
+
+  SUCCESS_OR_DIE ( gaspi_barrier (g_survivors, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+static void
+check_buddy (gpi_cp_description_t description, const int* expected, size_t n)
+{
+  SUCCESS_OR_DIE ( gpi_cp_read_buddy (description, GASPI_BLOCK) );
+
+  int const * const buddy_data = (int *)
+    ((char *) gpi_cp_get_receiver_ptr (description)
+    + gpi_cp_get_active_snapshot (description)
+    );
+
+  for (size_t i = 0; i < n; ++i)
+  {
+      ASSERT (buddy_data[i] == expected[i]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  // a few chunks of the copy and a partial one
+  gaspi_size_t const cp_data_size = 9 * 1024 * 1024 + 4 * 3;
+  size_t const num_work_elems = cp_data_size / sizeof (int);
+  const int num_epochs = 3;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  int* const checkpoint_array = (int *) checkpoint_seg_ptr;
+
+  // the data of the application lives elsewhere
+  int* const work_array = malloc (cp_data_size);
+  ASSERT (work_array != NULL);
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  ASSERT (gpi_cp_set_copy_threads (checkpoint_description, 0) == GASPI_ERROR);
+  SUCCESS_OR_DIE ( gpi_cp_set_copy_threads (checkpoint_description, 3) );
+
+  SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                               , 0
+                               , cp_data_size
+                               , 0
+                               , GPI_CP_POLICY_RING
+                               , GASPI_GROUP_ALL
+                               , checkpoint_description
+                               , GASPI_BLOCK
+                               )
+                 );
+
+  ASSERT (gpi_cp_set_copy_threads (checkpoint_description, 2) == GASPI_ERROR);
+  ASSERT (gpi_cp_snapshot_copy (checkpoint_description, work_array, cp_data_size + 1, true, GASPI_BLOCK) == GASPI_ERROR);
+
+  // copied and sent together
+  for (int epoch = 0; epoch < num_epochs; ++epoch)
+  {
+      for (size_t i = 0; i < num_work_elems; ++i)
+      {
+          work_array[i] = (int) i * (epoch + 1) + iProc;
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_snapshot_copy (checkpoint_description, work_array, cp_data_size, true, GASPI_BLOCK) );
+
+      // not while our data is being sent
+      ASSERT (gpi_cp_snapshot_copy (checkpoint_description, work_array, cp_data_size, false, GASPI_BLOCK) == GASPI_ERROR);
+
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      ASSERT (memcmp (checkpoint_array, work_array, cp_data_size) == 0);
+      check_buddy (checkpoint_description, work_array, num_work_elems);
+
+      SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+  }
+
+  // only the first part changed, the rest is sent as it is
+  size_t const part = num_work_elems / 2 + 1;
+
+  for (size_t i = 0; i < part; ++i)
+  {
+      work_array[i] = -(int) i - iProc;
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_snapshot_copy (checkpoint_description, work_array, part * sizeof (int), true, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  ASSERT (memcmp (checkpoint_array, work_array, cp_data_size) == 0);
+  check_buddy (checkpoint_description, work_array, num_work_elems);
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // copied only, started as usual
+  for (size_t i = 0; i < num_work_elems; ++i)
+  {
+      work_array[i] = 7 * (int) i + iProc;
+  }
+
+  SUCCESS_OR_DIE ( gpi_cp_snapshot_copy (checkpoint_description, work_array, cp_data_size, false, GASPI_BLOCK) );
+  ASSERT (memcmp (checkpoint_array, work_array, cp_data_size) == 0);
+
+  SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+  check_buddy (checkpoint_description, work_array, num_work_elems);
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+
+  free (work_array);
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
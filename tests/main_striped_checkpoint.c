@@ -0,0 +1,214 @@
+/*
+Copyright (c) Fraunhofer ITWM 
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(r)                       \
+  do						\
+  {						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+static void
+check (volatile const int* work_array, int num_work_elems, gaspi_rank_t owner)
+{
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      ASSERT(work_array[iwork] == (int) owner * num_work_elems + iwork);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  // two stripes at least, and a spare
+  if (nProc < 4)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  const gaspi_rank_t spare = nProc-1;
+  const gaspi_rank_t culprit = nProc-2;
+  const gaspi_number_t stripes = (nProc - 2 < 3) ? nProc - 2 : 3;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  // not a multiple of the number of stripes
+  gaspi_size_t const cp_data_size = 1024 * 1024 + 4;
+  const int num_work_elems = cp_data_size / sizeof(int);
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_pointer_t checkpoint_seg_ptr;
+  SUCCESS_OR_DIE (gaspi_segment_ptr(segment_id_checkpoint, &checkpoint_seg_ptr) );
+  volatile int* const work_array = (int *) checkpoint_seg_ptr;
+
+  // init data
+  for( int iwork = 0; iwork < num_work_elems; ++iwork)
+  {
+      work_array[iwork] = iProc * num_work_elems + iwork;
+  }
+
+  // create group
+  gaspi_group_t g_active = GASPI_GROUP_ALL;
+  if ( iProc != spare)
+  {
+      SUCCESS_OR_DIE (gaspi_group_create(&g_active));
+      for(gaspi_rank_t i = 0; i < nProc; i++)
+      {
+          if(i != spare)
+              SUCCESS_OR_DIE(gaspi_group_add(g_active, i));
+      }
+      SUCCESS_OR_DIE(gaspi_group_commit(g_active, GASPI_BLOCK));
+  }
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  SUCCESS_OR_DIE ( gpi_cp_set_stripes (checkpoint_description, stripes) );
+  // survivors refill the spare from their copy of the committed epoch
+  SUCCESS_OR_DIE ( gpi_cp_set_local_copy (checkpoint_description, true) );
+
+  if ( iProc != spare)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                       , 0
+                                       , cp_data_size
+                                       , 4
+                                       , GPI_CP_POLICY_STRIPED
+                                       , g_active
+                                       , checkpoint_description
+                                       , GASPI_BLOCK
+                                    )
+          );
+
+      for (int epoch = 0; epoch < 3; ++epoch)
+      {
+          SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK));
+      }
+
+      // the stripes on the receivers make up the data again
+      SUCCESS_OR_DIE ( gpi_cp_read_buddy (checkpoint_description, GASPI_BLOCK) );
+      check ( (int*) ((char*) gpi_cp_get_receiver_ptr (checkpoint_description)
+                      + gpi_cp_get_active_snapshot (checkpoint_description))
+            , num_work_elems
+            , iProc
+            );
+
+      // the computation goes on after the commit
+      work_array[0] = -1;
+  }
+
+  if (iProc != culprit)
+  {  
+      if ( iProc != spare)
+      {
+          SUCCESS_OR_DIE(gaspi_group_delete(g_active));
+      }
+
+      SUCCESS_OR_DIE (gaspi_group_create(&g_active));
+      for(gaspi_rank_t i = 0; i < nProc; i++)
+      {
+          if(i != culprit)
+              SUCCESS_OR_DIE(gaspi_group_add(g_active, i));
+      }
+      SUCCESS_OR_DIE(gaspi_group_commit(g_active, GASPI_BLOCK));
+
+      SUCCESS_OR_DIE(gpi_cp_restore( segment_id_checkpoint
+                                       , 0
+                                       , cp_data_size
+                                       , 4
+                                       , GPI_CP_POLICY_STRIPED
+                                       , g_active
+                                       , checkpoint_description
+                                       , GASPI_BLOCK
+                         )
+      );
+
+      // the receivers hold the committed data, not the changed one
+      if (iProc != spare)
+      {
+          SUCCESS_OR_DIE ( gpi_cp_read_buddy (checkpoint_description, GASPI_BLOCK) );
+          check ( (int*) ((char*) gpi_cp_get_receiver_ptr (checkpoint_description)
+                          + gpi_cp_get_active_snapshot (checkpoint_description))
+                , num_work_elems
+                , iProc
+                );
+
+          work_array[0] = iProc * num_work_elems;
+      }
+
+      // read_buddy uses the slot the next checkpoint writes
+      SUCCESS_OR_DIE ( gaspi_barrier(g_active, GASPI_BLOCK) );
+
+      // the spare restored the data of the culprit from all stripes
+      check (work_array, num_work_elems, (iProc == spare) ? culprit : iProc);
+
+      // and takes part in the next checkpoint
+      SUCCESS_OR_DIE ( gpi_cp_start (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( gpi_cp_read_buddy (checkpoint_description, GASPI_BLOCK) );
+      check ( (int*) ((char*) gpi_cp_get_receiver_ptr (checkpoint_description)
+                      + gpi_cp_get_active_snapshot (checkpoint_description))
+            , num_work_elems
+            , (iProc == spare) ? culprit : iProc
+            );
+
+      // nobody reads from a mirror any more
+      SUCCESS_OR_DIE ( gaspi_barrier(g_active, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK) );
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}
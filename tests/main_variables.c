@@ -0,0 +1,304 @@
+/*
+Copyright (c) Fraunhofer ITWM
+
+This file is part of gpi_cp.
+
+gpi_cp is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+gpi_cp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with gpi_cp. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <GASPI.h>
+#include <gpi_cp.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define ASSERT(ec) assert (ec);
+
+#define ERROR(message)                          \
+  do                                            \
+  {                                             \
+    printf ( "Error[%s:%i]: %s\n"               \
+                 , __FILE__, __LINE__, message  \
+                 );                             \
+                                                \
+    exit (EXIT_FAILURE);                        \
+  } while (0)
+
+
+#define SUCCESS_OR_DIE(f...)                    \
+  do						\
+  {						\
+    gaspi_return_t const r = f;                 \
+						\
+    if (r != GASPI_SUCCESS)			\
+    {						\
+      ERROR (gaspi_error_str (r));		\
+    }						\
+  } while (0)
+
+// the group of the ranks below nProc, except avoid, committed by its
+// members
+static gaspi_group_t
+create_group (gaspi_rank_t nProc, gaspi_rank_t avoid, gaspi_rank_t iProc)
+{
+  gaspi_group_t group;
+  SUCCESS_OR_DIE (gaspi_group_create (&group));
+
+  for (gaspi_rank_t rank = 0; rank < nProc; ++rank)
+  {
+      if (rank != avoid)
+      {
+          SUCCESS_OR_DIE (gaspi_group_add (group, rank));
+      }
+  }
+
+  if (iProc < nProc && iProc != avoid)
+  {
+      SUCCESS_OR_DIE (gaspi_group_commit (group, GASPI_BLOCK));
+  }
+
+  return group;
+}
+
+// a static table, a field changed every epoch, one checkpointed every
+// second epoch and one changed in odd epochs only
+#define NUM_VARIABLES 4
+
+static const char* const names[NUM_VARIABLES] = { "table", "field", "slow", "odd" };
+static const int lengths[NUM_VARIABLES] = { 100000, 3000, 2000, 500 };
+
+static int
+value (gaspi_rank_t rank, int epoch, int k, int i)
+{
+  return rank * 1000000 + epoch * 100000 + k * 10000 + i % 10000;
+}
+
+static void
+fill (int* variable, gaspi_rank_t rank, int epoch, int k)
+{
+  for (int i = 0; i < lengths[k]; ++i)
+  {
+      variable[i] = value (rank, epoch, k, i);
+  }
+}
+
+static void
+check (const int* variable, gaspi_rank_t rank, int epoch, int k)
+{
+  for (int i = 0; i < lengths[k]; ++i)
+  {
+      ASSERT (variable[i] == value (rank, epoch, k, i));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  SUCCESS_OR_DIE (gaspi_proc_init( GASPI_BLOCK ));
+
+  gaspi_rank_t iProc;
+  gaspi_rank_t nProc;
+
+  SUCCESS_OR_DIE (gaspi_proc_rank( &iProc ));
+  SUCCESS_OR_DIE (gaspi_proc_num( &nProc ));
+
+  if (nProc < 3)
+  {
+      SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+      return EXIT_SUCCESS;
+  }
+
+  // the last rank joins in place of the one before it
+  gaspi_rank_t const joiner = nProc - 1;
+  gaspi_rank_t const culprit = nProc - 2;
+
+  gaspi_segment_id_t segment_id_checkpoint = 1;
+  gaspi_size_t const cp_data_size = 1024 * 1024;
+  const int num_epochs = 4;
+
+  SUCCESS_OR_DIE (gaspi_segment_create( segment_id_checkpoint, cp_data_size, GASPI_GROUP_ALL,
+					GASPI_BLOCK, GASPI_MEM_INITIALIZED ));
+
+  gaspi_group_t const g_members = create_group (joiner, joiner, iProc);
+  gaspi_group_t const g_new = create_group (nProc, culprit, iProc);
+
+  int* variables[NUM_VARIABLES];
+
+  for (int k = 0; k < NUM_VARIABLES; ++k)
+  {
+      variables[k] = malloc (lengths[k] * sizeof (int));
+      ASSERT (variables[k] != NULL);
+  }
+
+  gpi_cp_description_t checkpoint_description = GPI_CP_DESCRIPTION_INITIALIZER();
+
+  // no region yet
+  ASSERT (gpi_cp_register (checkpoint_description, "table", variables[0], sizeof (int), 0) == GASPI_ERROR);
+
+  if (iProc != joiner)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_init ( segment_id_checkpoint
+                                   , 0
+                                   , cp_data_size
+                                   , 0
+                                   , GPI_CP_POLICY_RING
+                                   , g_members
+                                   , checkpoint_description
+                                   , GASPI_BLOCK
+                                   )
+                     );
+
+      ASSERT (gpi_cp_checkpoint_variables (checkpoint_description, GASPI_BLOCK) == GASPI_ERROR);
+
+      for (int k = 0; k < NUM_VARIABLES; ++k)
+      {
+          SUCCESS_OR_DIE ( gpi_cp_register ( checkpoint_description
+                                           , names[k]
+                                           , variables[k]
+                                           , lengths[k] * sizeof (int)
+                                           , (k == 1 || k == 2) ? GPI_CP_VARIABLE_ALWAYS
+                                                                : GPI_CP_VARIABLE_MARKED
+                                           )
+                         );
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_set_variable_interval (checkpoint_description, "slow", 2) );
+
+      // taken, too long, no room, unknown flags or names
+      ASSERT (gpi_cp_register (checkpoint_description, "odd", variables[0], 4, 0) == GASPI_ERROR);
+      ASSERT (gpi_cp_register ( checkpoint_description
+                              , "a name of more than thirty-nine characters"
+                              , variables[0], 4, 0) == GASPI_ERROR);
+      ASSERT (gpi_cp_register (checkpoint_description, "huge", variables[0], cp_data_size, 0) == GASPI_ERROR);
+      ASSERT (gpi_cp_register (checkpoint_description, "flags", variables[0], 4, 2) == GASPI_ERROR);
+      ASSERT (gpi_cp_mark_dirty (checkpoint_description, "unknown") == GASPI_ERROR);
+      ASSERT (gpi_cp_set_variable_interval (checkpoint_description, "slow", 0) == GASPI_ERROR);
+      ASSERT (gpi_cp_get_variable_epoch (checkpoint_description, "table") == 0);
+
+      fill (variables[0], iProc, 0, 0);
+
+      for (int epoch = 0; epoch < num_epochs; ++epoch)
+      {
+          fill (variables[1], iProc, epoch, 1);
+          fill (variables[2], iProc, epoch, 2);
+
+          if (epoch % 2 == 1)
+          {
+              fill (variables[3], iProc, epoch, 3);
+              SUCCESS_OR_DIE ( gpi_cp_mark_dirty (checkpoint_description, "odd") );
+          }
+          else if (epoch == 0)
+          {
+              fill (variables[3], iProc, epoch, 3);
+          }
+
+          SUCCESS_OR_DIE ( gpi_cp_checkpoint_variables (checkpoint_description, GASPI_BLOCK) );
+
+          // packed: all at first, then the field, every second epoch
+          // the slow one and in odd epochs the odd one
+          gaspi_size_t expected = lengths[1];
+
+          if (epoch == 0)
+            expected = lengths[0] + lengths[1] + lengths[2] + lengths[3];
+          else if (epoch % 2 == 0)
+            expected += lengths[2];
+          else
+            expected += lengths[3];
+
+          ASSERT (gpi_cp_get_packed_size (checkpoint_description) == expected * sizeof (int));
+
+          SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+      }
+
+      ASSERT (gpi_cp_get_variable_epoch (checkpoint_description, "table") == 1);
+      ASSERT (gpi_cp_get_variable_epoch (checkpoint_description, "field") == (unsigned long) num_epochs);
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_members, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  // the culprit "failed", it keeps its mirror
+  if (iProc != culprit)
+  {
+      SUCCESS_OR_DIE ( gpi_cp_restore ( segment_id_checkpoint
+                                      , 0
+                                      , cp_data_size
+                                      , 0
+                                      , GPI_CP_POLICY_RING
+                                      , g_new
+                                      , checkpoint_description
+                                      , GASPI_BLOCK
+                                      )
+                     );
+
+      gaspi_rank_t const owner = (iProc == joiner) ? culprit : iProc;
+
+      // the joiner registers in another order
+      if (iProc == joiner)
+      {
+          for (int k = NUM_VARIABLES - 1; k >= 0; --k)
+          {
+              SUCCESS_OR_DIE ( gpi_cp_register ( checkpoint_description
+                                               , names[k]
+                                               , variables[k]
+                                               , lengths[k] * sizeof (int)
+                                               , GPI_CP_VARIABLE_ALWAYS
+                                               )
+                             );
+          }
+      }
+
+      for (int k = 0; k < NUM_VARIABLES; ++k)
+      {
+          fill (variables[k], iProc, -1, k);
+      }
+
+      SUCCESS_OR_DIE ( gpi_cp_restore_variables (checkpoint_description) );
+
+      // each from the epoch it was packed last
+      int const last = num_epochs - 1;
+
+      check (variables[0], owner, 0, 0);
+      check (variables[1], owner, last, 1);
+      check (variables[2], owner, last - last % 2, 2);
+      check (variables[3], owner, last - (last % 2 == 0), 3);
+
+      ASSERT (gpi_cp_get_variable_epoch (checkpoint_description, "table") == 1);
+      ASSERT (gpi_cp_get_variable_epoch (checkpoint_description, "slow") == (unsigned long) last - last % 2 + 1);
+
+      // a new one behind the restored ones
+      int extra = iProc;
+      SUCCESS_OR_DIE ( gpi_cp_register (checkpoint_description, "extra", &extra, sizeof (extra), 0) );
+
+      SUCCESS_OR_DIE ( gpi_cp_checkpoint_variables (checkpoint_description, GASPI_BLOCK) );
+      SUCCESS_OR_DIE ( gpi_cp_commit (checkpoint_description, GASPI_BLOCK) );
+
+      extra = -1;
+      SUCCESS_OR_DIE ( gpi_cp_restore_variables (checkpoint_description) );
+      ASSERT (extra == iProc);
+      check (variables[0], owner, 0, 0);
+
+      SUCCESS_OR_DIE ( gaspi_barrier (g_new, GASPI_BLOCK) );
+
+      SUCCESS_OR_DIE ( gpi_cp_finalize (checkpoint_description, GASPI_BLOCK) );
+  }
+
+  SUCCESS_OR_DIE ( gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK) );
+
+  SUCCESS_OR_DIE ( gaspi_proc_term(GASPI_BLOCK) );
+
+  return EXIT_SUCCESS;
+}